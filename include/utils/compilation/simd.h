@@ -0,0 +1,35 @@
+#pragma once
+
+#include "compiler.h"
+
+//Note: MSVC doesn't define __SSE2__, SSE2 is always available on x64 and with /arch:SSE2 or higher on x86.
+#if defined(__AVX2__)
+	#define utils_compilation_simd_avx2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define utils_compilation_simd_sse2
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+	#define utils_compilation_simd_neon
+#else
+	#define utils_compilation_simd_none
+#endif
+
+//Every AVX2 CPU has FMA3 as well, but GCC and Clang only enable it with -mfma (or -march).
+#if defined(utils_compilation_simd_avx2) && (defined(__FMA__) || defined(utils_compiler_msvc))
+	#define utils_compilation_simd_fma
+#endif
+
+namespace utils::compilation
+	{
+	enum class simd_t { none, sse2, avx2, neon };
+
+	inline constexpr simd_t simd
+#if defined(utils_compilation_simd_avx2)
+		{simd_t::avx2};
+#elif defined(utils_compilation_simd_sse2)
+		{simd_t::sse2};
+#elif defined(utils_compilation_simd_neon)
+		{simd_t::neon};
+#else
+		{simd_t::none};
+#endif
+	}
\ No newline at end of file
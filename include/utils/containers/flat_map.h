@@ -1,68 +1,223 @@
 #pragma once
 
+#include <span>
+#include <vector>
+#include <ranges>
+#include <utility>
+#include <compare>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+
 #include "flat_set.h"
 
-//TODO INSERTION CHECK
-//TODO finish this
-/*namespace utils::containers
+//TODO output operator
+namespace utils::containers
 	{
-	template <typename Key, typename T, class Allocator = std::allocator<std::pair<Key, T>>>
-	class tiny_map
+	/// <summary>
+	/// Map kept as two parallel vectors: the sorted keys and the values in the same order. Lookups only touch the keys array, with the same branchless search as flat_set.
+	/// Single insertions and removals shift the elements after them, use insert_range to add many elements with a single sort and merge.
+	/// Like std::map, inserting an existing key keeps the value already there (see insert_or_assign).
+	/// </summary>
+	template <typename Key, typename T, typename Compare = std::less<Key>, class KeyAllocator = std::allocator<Key>, class MappedAllocator = std::allocator<T>>
+	class flat_map
 		{
 		protected:
-			using inner_container_t = std::vector<std::pair<Key, T>, Allocator>;
-			using pair_t = std::pair<Key, T>;
+			using keys_container_t   = std::vector<Key, KeyAllocator   >;
+			using values_container_t = std::vector<T  , MappedAllocator>;
 
 		public:
-			using value_type             = inner_container_t::value_type;
-			using size_type              = inner_container_t::size_type;
-			using reference              = inner_container_t::reference;
-			using const_reference        = inner_container_t::const_reference;
-			using pointer                = inner_container_t::pointer;
-			using const_pointer          = inner_container_t::const_pointer;
-			using iterator               = inner_container_t::iterator;
-			using const_iterator         = inner_container_t::const_iterator;
-			using reverse_iterator       = inner_container_t::reverse_iterator;
-			using const_reverse_iterator = inner_container_t::const_reverse_iterator;
+			using key_type    = Key;
+			using mapped_type = T;
+			using key_compare = Compare;
+			using size_type   = size_t;
+
+			template <bool is_const>
+			class iterator_t
+				{
+				friend class flat_map;
+				template <bool> friend class iterator_t;
+				public:
+					using iterator_category = std::random_access_iterator_tag;
+					using difference_type   = std::ptrdiff_t;
+					using value_type        = std::pair<const key_type&, std::conditional_t<is_const, const mapped_type&, mapped_type&>>;
+					using reference         = value_type;
+
+					iterator_t() noexcept = default;
+					template <bool other_const>
+					iterator_t(const iterator_t<other_const>& other) noexcept requires(is_const && !other_const) : map{other.map}, index{other.index} {}
+
+					const key_type& key() const noexcept { return map->keys_container[index]; }
+					std::conditional_t<is_const, const mapped_type&, mapped_type&> value() const noexcept { return map->values_container[index]; }
+
+					reference operator* () const noexcept { return {key(), value()}; }
+					reference operator[](difference_type offset) const noexcept { return *(*this + offset); }
+
+					iterator_t& operator++() noexcept { index++; return *this; }
+					iterator_t& operator--() noexcept { index--; return *this; }
+					iterator_t  operator++(int) noexcept { auto tmp{*this}; ++(*this); return tmp; }
+					iterator_t  operator--(int) noexcept { auto tmp{*this}; --(*this); return tmp; }
+
+					iterator_t& operator+=(difference_type offset) noexcept { index = static_cast<size_t>(static_cast<difference_type>(index) + offset); return *this; }
+					iterator_t& operator-=(difference_type offset) noexcept { return (*this) += -offset; }
+					friend iterator_t operator+(iterator_t it, difference_type offset) noexcept { return it += offset; }
+					friend iterator_t operator+(difference_type offset, iterator_t it) noexcept { return it += offset; }
+					friend iterator_t operator-(iterator_t it, difference_type offset) noexcept { return it -= offset; }
+					friend difference_type operator-(const iterator_t& a, const iterator_t& b) noexcept { return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index); }
+
+					bool operator== (const iterator_t& other) const noexcept { return index == other.index; }
+					auto operator<=>(const iterator_t& other) const noexcept { return index <=> other.index; }
+
+					size_t get_index() const noexcept { return index; }
+
+				private:
+					using map_t = std::conditional_t<is_const, const flat_map, flat_map>;
+					iterator_t(map_t& map, size_t index) noexcept : map{&map}, index{index} {}
+
+					map_t* map{nullptr};
+					size_t index{0};
+				};
+			using iterator       = iterator_t<false>;
+			using const_iterator = iterator_t<true >;
+
+			flat_map() = default;
+			flat_map(std::initializer_list<std::pair<Key, T>> values) { insert_range(values); }
+
+			template <std::ranges::input_range range_t>
+			static flat_map from_range(range_t&& values) { flat_map ret; ret.insert_range(std::forward<range_t>(values)); return ret; }
+
+			size_t lower_bound_index(const Key& key) const noexcept { return details::lower_bound_index(keys_container.data(), keys_container.size(), key, compare); }
+
+			iterator       lower_bound(const Key& key)       noexcept { return {*this, lower_bound_index(key)}; }
+			const_iterator lower_bound(const Key& key) const noexcept { return {*this, lower_bound_index(key)}; }
+
+			iterator       find(const Key& key)       noexcept { return {*this, find_index(key)}; }
+			const_iterator find(const Key& key) const noexcept { return {*this, find_index(key)}; }
+			bool   contains(const Key& key) const noexcept { return find_index(key) != size(); }
+			size_t count   (const Key& key) const noexcept { return contains(key) ? 1 : 0; }
+
+			      T& at(const Key& key)       { return values_container[checked_index(key)]; }
+			const T& at(const Key& key) const { return values_container[checked_index(key)]; }
+
+			T& operator[](const Key& key) requires(std::is_default_constructible_v<T>) { return try_emplace(key).first.value(); }
 
 			template <typename ...Args>
-			T& emplace(Args&& ...args)
+			std::pair<iterator, bool> try_emplace(const Key& key, Args&& ...args)
+				{
+				const size_t index{lower_bound_index(key)};
+				if (index != size() && !compare(key, keys_container[index])) { return {iterator{*this, index}, false}; }
+
+				keys_container  .emplace(keys_container  .begin() + index, key);
+				values_container.emplace(values_container.begin() + index, std::forward<Args>(args)...);
+				return {iterator{*this, index}, true};
+				}
+			std::pair<iterator, bool> insert(const std::pair<Key, T>& pair) { return try_emplace(pair.first, pair.second); }
+			std::pair<iterator, bool> insert(std::pair<Key, T>&& pair) { return try_emplace(pair.first, std::move(pair.second)); }
+
+			template <typename value_t>
+			std::pair<iterator, bool> insert_or_assign(const Key& key, value_t&& value)
 				{
-				return inner_container.emplace_back(std::forward<Args>(args)...);
+				const size_t index{find_index(key)};
+				if (index != size())
+					{
+					values_container[index] = std::forward<value_t>(value);
+					return {iterator{*this, index}, false};
+					}
+				return try_emplace(key, std::forward<value_t>(value));
 				}
 
-			//template <typename ...Args>
-			//void insert(Args& ...args)
-			//	{
-			//	inner_container.push_back(args...);
-			//	}
-
-			      iterator find(const T& search)       noexcept { return std::find( begin(),  end(), search); }
-			const_iterator find(const T& search) const noexcept { return std::find(cbegin(), cend(), search); }
-			void remove(const T& search) noexcept { inner_container.erase(std::remove(begin(), end(), search)); }
-
-			void clear() { inner_container.clear(); }
-			size_t size() const noexcept { return inner_container.size(); }
-			bool empty() const noexcept { return inner_container.empty(); }
-
-			const auto begin()   const noexcept { return inner_container.begin(); }
-			      auto begin()         noexcept { return inner_container.begin(); }
-			const auto end()     const noexcept { return inner_container.end(); }
-			      auto end()           noexcept { return inner_container.end(); }
-			const auto cbegin()  const noexcept { return inner_container.cbegin(); }
-			      auto cbegin()        noexcept { return inner_container.cbegin(); }
-			const auto cend()    const noexcept { return inner_container.cend(); }
-			      auto cend()          noexcept { return inner_container.cend(); }
-			const auto rbegin()  const noexcept { return inner_container.rbegin(); }
-			      auto rbegin()        noexcept { return inner_container.rbegin(); }
-			const auto rend()    const noexcept { return inner_container.rend(); }
-			      auto rend()          noexcept { return inner_container.rend(); }
-			const auto crbegin() const noexcept { return inner_container.crbegin(); }
-			      auto crbegin()       noexcept { return inner_container.crbegin(); }
-			const auto crend()   const noexcept { return inner_container.crend(); }
-			      auto crend()         noexcept { return inner_container.crend(); }
-		
+			/// <summary>
+			/// Sorts the new pairs once and merges them with the existing ones in a single pass.
+			/// Keys already in the map keep their value, among repeated new keys the first one wins, same as inserting them one by one.
+			/// </summary>
+			template <std::ranges::input_range range_t>
+			void insert_range(range_t&& pairs)
+				{
+				std::vector<std::pair<Key, T>> incoming;
+				if constexpr (std::ranges::sized_range<range_t>) { incoming.reserve(std::ranges::size(pairs)); }
+				for (auto&& pair : pairs) { incoming.emplace_back(std::forward<decltype(pair)>(pair)); }
+				if (incoming.empty()) { return; }
+
+				std::stable_sort(incoming.begin(), incoming.end(), [this](const auto& a, const auto& b) { return compare(a.first, b.first); });
+
+				keys_container_t   merged_keys  ; merged_keys  .reserve(keys_container.size() + incoming.size());
+				values_container_t merged_values; merged_values.reserve(keys_container.size() + incoming.size());
+
+				size_t existing_index{0};
+				for (size_t incoming_index{0}; incoming_index < incoming.size(); incoming_index++)
+					{
+					auto& [key, value]{incoming[incoming_index]};
+					if (incoming_index > 0 && !compare(incoming[incoming_index - 1].first, key)) { continue; }
+
+					for (; existing_index < keys_container.size() && compare(keys_container[existing_index], key); existing_index++)
+						{
+						merged_keys  .emplace_back(std::move(keys_container  [existing_index]));
+						merged_values.emplace_back(std::move(values_container[existing_index]));
+						}
+					if (existing_index < keys_container.size() && !compare(key, keys_container[existing_index])) { continue; }
+
+					merged_keys  .emplace_back(std::move(key  ));
+					merged_values.emplace_back(std::move(value));
+					}
+				for (; existing_index < keys_container.size(); existing_index++)
+					{
+					merged_keys  .emplace_back(std::move(keys_container  [existing_index]));
+					merged_values.emplace_back(std::move(values_container[existing_index]));
+					}
+
+				keys_container   = std::move(merged_keys  );
+				values_container = std::move(merged_values);
+				}
+
+			iterator erase(const_iterator it)
+				{
+				keys_container  .erase(keys_container  .begin() + it.index);
+				values_container.erase(values_container.begin() + it.index);
+				return {*this, it.index};
+				}
+			size_t erase(const Key& key)
+				{
+				const size_t index{find_index(key)};
+				if (index == size()) { return 0; }
+				erase(const_iterator{*this, index});
+				return 1;
+				}
+
+			void clear() noexcept { keys_container.clear(); values_container.clear(); }
+			void reserve(size_t capacity) { keys_container.reserve(capacity); values_container.reserve(capacity); }
+			void shrink_to_fit() { keys_container.shrink_to_fit(); values_container.shrink_to_fit(); }
+			size_t size () const noexcept { return keys_container.size(); }
+			bool   empty() const noexcept { return keys_container.empty(); }
+
+			std::span<const Key> keys  () const noexcept { return keys_container  ; }
+			std::span<const T  > values() const noexcept { return values_container; }
+			/// <summary> Values can be modified in place, the keys never. </summary>
+			std::span<      T  > values()       noexcept { return values_container; }
+
+			iterator       begin ()       noexcept { return {*this, 0     }; }
+			iterator       end   ()       noexcept { return {*this, size()}; }
+			const_iterator begin () const noexcept { return {*this, 0     }; }
+			const_iterator end   () const noexcept { return {*this, size()}; }
+			const_iterator cbegin() const noexcept { return {*this, 0     }; }
+			const_iterator cend  () const noexcept { return {*this, size()}; }
+
 		protected:
-			inner_container_t inner_container;
+			keys_container_t   keys_container;
+			values_container_t values_container;
+			key_compare compare;
+
+			size_t find_index(const Key& key) const noexcept
+				{
+				const size_t index{lower_bound_index(key)};
+				return (index != size() && !compare(key, keys_container[index])) ? index : size();
+				}
+			size_t checked_index(const Key& key) const
+				{
+				const size_t index{find_index(key)};
+				if (index == size()) { throw std::out_of_range{"Flat map key not found."}; }
+				return index;
+				}
 		};
-	}*/
\ No newline at end of file
+	}
\ No newline at end of file
@@ -1,9 +1,25 @@
 #pragma once
+
+#include <bit>
+#include <span>
 #include <vector>
+#include <ranges>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
+
+#include "../compilation/simd.h"
+#include "../compilation/inline.h"
+
+#if defined(utils_compilation_simd_avx2) || defined(utils_compilation_simd_sse2)
+	#include <immintrin.h>
+#elif defined(utils_compilation_simd_neon)
+	#include <arm_neon.h>
+#endif
 
-//TODO actual flat set
 //TODO output operator
-//TODO INSERTION CHECK
 namespace utils::containers
 	{
 	/// <summary>
@@ -63,33 +79,199 @@ namespace utils::containers
 			      auto crbegin()       noexcept { return inner_container.crbegin(); }
 			const auto crend()   const noexcept { return inner_container.crend(); }
 			      auto crend()         noexcept { return inner_container.crend(); }
-		
+
 		protected:
 			inner_container_t inner_container;
 		};
-	
 
-	template <typename T, class Allocator = std::allocator<T>>
-	class flat_set : public tiny_set<T, Allocator>
+	namespace details
 		{
-		using parent_t          = tiny_set<T, Allocator>;
-		using inner_container_t = parent_t::inner_container_t;
+		/// <summary> 32 bits integers compared with std::less, the last steps of the search can compare a whole SIMD register of keys at once. </summary>
+		template <typename T, typename compare_t>
+		inline constexpr bool simd_searchable
+			{
+			std::is_integral_v<T> && sizeof(T) == 4 && (std::is_same_v<compare_t, std::less<T>> || std::is_same_v<compare_t, std::less<>>)
+			};
+
+		/// <summary> Amount of elements in data that are less than key. </summary>
+		template <typename T>
+		utils_force_inline inline size_t count_less_simd(const T* data, size_t size, T key) noexcept
+			{
+			size_t ret{0};
+			size_t index{0};
+
+#if defined(utils_compilation_simd_avx2) || defined(utils_compilation_simd_sse2)
+			//There are only signed comparisons, flipping the sign bit maps unsigned ordering onto signed ordering.
+			const int bias{std::is_signed_v<T> ? 0 : static_cast<int>(0x80000000u)};
+	#if defined(utils_compilation_simd_avx2)
+			const __m256i key_wide{_mm256_set1_epi32(static_cast<int>(key) ^ bias)};
+			const __m256i bias_wide{_mm256_set1_epi32(bias)};
+			for (; index + 8 <= size; index += 8)
+				{
+				const __m256i values{_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index)), bias_wide)};
+				const __m256i less  {_mm256_cmpgt_epi32(key_wide, values)};
+				ret += static_cast<size_t>(std::popcount(static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(less)))));
+				}
+	#endif
+			const __m128i key_narrow {_mm_set1_epi32(static_cast<int>(key) ^ bias)};
+			const __m128i bias_narrow{_mm_set1_epi32(bias)};
+			for (; index + 4 <= size; index += 4)
+				{
+				const __m128i values{_mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index)), bias_narrow)};
+				const __m128i less  {_mm_cmplt_epi32(values, key_narrow)};
+				ret += static_cast<size_t>(std::popcount(static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(less)))));
+				}
+#elif defined(utils_compilation_simd_neon)
+			for (; index + 4 <= size; index += 4)
+				{
+				uint32x4_t less;
+				if constexpr (std::is_signed_v<T>) { less = vcltq_s32(vld1q_s32(reinterpret_cast<const int32_t *>(data + index)), vdupq_n_s32(static_cast<int32_t >(key))); }
+				else                               { less = vcltq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(data + index)), vdupq_n_u32(static_cast<uint32_t>(key))); }
+				//Lanes that compare true are all ones, shifting keeps a single 1 per lane.
+				ret += static_cast<size_t>(vaddvq_u32(vshrq_n_u32(less, 31)));
+				}
+#endif
+
+			for (; index < size; index++) { ret += static_cast<size_t>(data[index] < key); }
+			return ret;
+			}
+
+		/// <summary>
+		/// Same result as std::lower_bound on sorted data, but the halving loop has no data dependent branch (the compiler emits a conditional move),
+		/// so there are no mispredictions on random lookups. For simd_searchable keys the last few elements are compared all together.
+		/// </summary>
+		template <typename T, typename compare_t>
+		size_t lower_bound_index(const T* data, size_t size, const T& key, const compare_t& compare) noexcept
+			{
+			if (size == 0) { return 0; }
+
+			//The answer always lies in [base, base + size].
+			const T* base{data};
+			if constexpr (simd_searchable<T, compare_t>)
+				{
+				constexpr size_t linear_threshold{16};
+				while (size > linear_threshold)
+					{
+					const size_t half{size / 2};
+					base = compare(base[half - 1], key) ? base + half : base;
+					size -= half;
+					}
+				return static_cast<size_t>(base - data) + count_less_simd(base, size, key);
+				}
+			else
+				{
+				while (size > 1)
+					{
+					const size_t half{size / 2};
+					base = compare(base[half - 1], key) ? base + half : base;
+					size -= half;
+					}
+				return static_cast<size_t>(base - data) + static_cast<size_t>(compare(*base, key));
+				}
+			}
+		}
+
+	/// <summary>
+	/// Set kept as a sorted contiguous vector. Lookups are a branchless binary search (see details::lower_bound_index), iteration is a plain vector walk.
+	/// Single insertions and removals shift the elements after them, use insert_range to add many elements with a single sort and merge.
+	/// Elements are exposed as const only, modifying them would break the ordering.
+	/// </summary>
+	template <typename T, typename Compare = std::less<T>, class Allocator = std::allocator<T>>
+	class flat_set
+		{
+		protected:
+			using inner_container_t = std::vector<T, Allocator>;
 
 		public:
-			using value_type             = parent_t::value_type;
-			using size_type              = parent_t::size_type;
-			using reference              = parent_t::reference;
-			using const_reference        = parent_t::const_reference;
-			using pointer                = parent_t::pointer;
-			using const_pointer          = parent_t::const_pointer;
-			using iterator               = parent_t::iterator;
-			using const_iterator         = parent_t::const_iterator;
-			using reverse_iterator       = parent_t::reverse_iterator;
-			using const_reverse_iterator = parent_t::const_reverse_iterator;
-
-			//TODO actual flat set (sorted insert, binary search, binary search to remove)
-		private:
-			inner_container_t vec;
+			using key_type               = T;
+			using value_type             = T;
+			using key_compare            = Compare;
+			using size_type              = inner_container_t::size_type;
+			using const_reference        = inner_container_t::const_reference;
+			using const_pointer          = inner_container_t::const_pointer;
+			using iterator               = inner_container_t::const_iterator;
+			using const_iterator         = inner_container_t::const_iterator;
+			using reverse_iterator       = inner_container_t::const_reverse_iterator;
+			using const_reverse_iterator = inner_container_t::const_reverse_iterator;
+
+			flat_set() = default;
+			flat_set(std::initializer_list<T> values) { insert_range(values); }
+
+			template <std::ranges::input_range range_t>
+			static flat_set from_range(range_t&& values) { flat_set ret; ret.insert_range(std::forward<range_t>(values)); return ret; }
+
+			const_iterator lower_bound(const T& key) const noexcept { return cbegin() + details::lower_bound_index(inner_container.data(), inner_container.size(), key, compare); }
+			const_iterator upper_bound(const T& key) const noexcept { return std::upper_bound(cbegin(), cend(), key, compare); }
+
+			const_iterator find(const T& key) const noexcept
+				{
+				const const_iterator it{lower_bound(key)};
+				return (it != cend() && !compare(key, *it)) ? it : cend();
+				}
+			bool   contains(const T& key) const noexcept { return find(key) != cend(); }
+			size_t count   (const T& key) const noexcept { return contains(key) ? 1 : 0; }
+
+			template <typename ...Args>
+			std::pair<iterator, bool> emplace(Args&& ...args)
+				{
+				return insert(T{std::forward<Args>(args)...});
+				}
+			std::pair<iterator, bool> insert(const T& value) { return insert(T{value}); }
+			std::pair<iterator, bool> insert(T&& value)
+				{
+				const const_iterator it{lower_bound(value)};
+				if (it != cend() && !compare(value, *it)) { return {it, false}; }
+				return {inner_container.insert(it, std::move(value)), true};
+				}
+
+			/// <summary> Appends all the values, sorts only the appended ones and merges them in place with the existing ones. Duplicates are dropped. </summary>
+			template <std::ranges::input_range range_t>
+			void insert_range(range_t&& values)
+				{
+				const size_t previous_size{inner_container.size()};
+				if constexpr (std::ranges::sized_range<range_t>) { inner_container.reserve(previous_size + std::ranges::size(values)); }
+				for (auto&& value : values) { inner_container.emplace_back(std::forward<decltype(value)>(value)); }
+
+				const auto middle{inner_container.begin() + previous_size};
+				std::sort(middle, inner_container.end(), compare);
+				std::inplace_merge(inner_container.begin(), middle, inner_container.end(), compare);
+				const auto duplicates{std::unique(inner_container.begin(), inner_container.end(), [this](const T& a, const T& b) { return !compare(a, b) && !compare(b, a); })};
+				inner_container.erase(duplicates, inner_container.end());
+				}
+
+			const_iterator erase(const_iterator it) { return inner_container.erase(it); }
+			const_iterator erase(const_iterator first, const_iterator last) { return inner_container.erase(first, last); }
+			size_t erase(const T& key)
+				{
+				const const_iterator it{find(key)};
+				if (it == cend()) { return 0; }
+				inner_container.erase(it);
+				return 1;
+				}
+
+			void   clear() noexcept { inner_container.clear(); }
+			void   reserve(size_t capacity) { inner_container.reserve(capacity); }
+			void   shrink_to_fit() { inner_container.shrink_to_fit(); }
+			size_t size    () const noexcept { return inner_container.size(); }
+			size_t capacity() const noexcept { return inner_container.capacity(); }
+			bool   empty   () const noexcept { return inner_container.empty(); }
+
+			std::span<const T> values() const noexcept { return inner_container; }
+			const T& operator[](size_t index) const noexcept { return inner_container[index]; }
+
+			const_iterator         begin  () const noexcept { return inner_container.cbegin (); }
+			const_iterator         end    () const noexcept { return inner_container.cend   (); }
+			const_iterator         cbegin () const noexcept { return inner_container.cbegin (); }
+			const_iterator         cend   () const noexcept { return inner_container.cend   (); }
+			const_reverse_iterator rbegin () const noexcept { return inner_container.crbegin(); }
+			const_reverse_iterator rend   () const noexcept { return inner_container.crend  (); }
+			const_reverse_iterator crbegin() const noexcept { return inner_container.crbegin(); }
+			const_reverse_iterator crend  () const noexcept { return inner_container.crend  (); }
+
+			bool operator==(const flat_set& other) const noexcept { return inner_container == other.inner_container; }
+
+		protected:
+			inner_container_t inner_container;
+			key_compare compare;
 		};
-	
 	}
\ No newline at end of file
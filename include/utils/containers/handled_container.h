@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <tuple>
+#include <memory>
 
 #include "../compilation/debug.h"
 #include "../id_pool.h"
@@ -19,6 +20,8 @@ namespace utils::containers
 		{
 		protected:
 			using inner_container_t = std::vector<T, Allocator>;
+			using handle_index_allocator_t    = typename std::allocator_traits<Allocator>::template rebind_alloc<id_pool_manual::value_type>;
+			using container_index_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<size_t>;
 
 		public:
 			class handle_raw 
@@ -131,6 +134,9 @@ namespace utils::containers
 			using const_iterator         = inner_container_t::const_iterator;
 			using reverse_iterator       = inner_container_t::reverse_iterator;
 			using const_reverse_iterator = inner_container_t::const_reverse_iterator;
+
+			handled_container() = default;
+			handled_container(const Allocator& allocator) : inner_container{allocator}, handle_to_container_index{allocator}, container_index_to_handle{allocator} {}
 	
 			template <typename ...Args>
 			handle_raw emplace(Args&& ...args)
@@ -214,7 +220,7 @@ namespace utils::containers
 
 			inner_container_t inner_container;
 			id_pool_manual id_pool;
-			std::vector<id_pool_manual::value_type> handle_to_container_index;
-			std::vector<size_t/*, Allocator*/> container_index_to_handle;
+			std::vector<id_pool_manual::value_type, handle_index_allocator_t   > handle_to_container_index;
+			std::vector<size_t                    , container_index_allocator_t> container_index_to_handle;
 		};
 	}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Low complexity jump-counting skipfield, the same pattern plf::hive uses for its element blocks (see skipfield.h), for a fixed amount of nodes.
+// Consecutive skipped nodes form a skipblock: its first and last node hold the block's length, the other nodes their position in the block plus one.
+// Iterating only visits unskipped nodes, each step is a single jump regardless of how many nodes are skipped in between.
+// Skipping or unskipping a node renumbers at most the nodes of the block on its right, so both are O(size) in the worst case and O(1) in the common ones.
+
+namespace utils::containers::hive
+	{
+	template <size_t size>
+	class jump_counting_skipfield
+		{
+		public:
+			using value_type = std::conditional_t<(size <= std::numeric_limits<std::uint8_t >::max()), std::uint8_t ,
+			                   std::conditional_t<(size <= std::numeric_limits<std::uint16_t>::max()), std::uint16_t,
+			                   std::conditional_t<(size <= std::numeric_limits<std::uint32_t>::max()), std::uint32_t, size_t>>>;
+
+			inline static constexpr size_t npos{std::numeric_limits<size_t>::max()};
+
+			/// <summary> Starts with every node skipped. </summary>
+			jump_counting_skipfield() noexcept { skip_all(); }
+
+			void skip_all() noexcept
+				{
+				nodes[0] = static_cast<value_type>(size);
+				for (size_t i{1}; i < size; i++) { nodes[i] = static_cast<value_type>(i + 1); }
+				nodes[size] = 0;
+				}
+
+			bool is_skipped(size_t index) const noexcept { return nodes[index] != 0; }
+
+			/// <returns> The first unskipped index at or after index, size if there's none. </returns>
+			size_t next_unskipped(size_t index) const noexcept
+				{
+				const size_t value{nodes[index]};
+				if (value == 0) { return index; }
+				if (is_block_start(index)) { return index + value; }
+				//Only reached when the node the caller was on got skipped in the meantime.
+				const size_t start{index + 1 - value};
+				return start + nodes[start];
+				}
+
+			/// <returns> The last unskipped index before index, npos if there's none. </returns>
+			size_t previous_unskipped(size_t index) const noexcept
+				{
+				if (index == 0) { return npos; }
+				const size_t last{index - 1};
+				const size_t value{nodes[last]};
+				if (value == 0) { return last; }
+				const size_t start{is_block_start(last) ? last : last + 1 - value};
+				return start == 0 ? npos : start - 1;
+				}
+
+			/// <summary> Undefined behaviour if the node is already skipped. </summary>
+			void skip(size_t index) noexcept
+				{
+				const size_t left {index > 0 ? static_cast<size_t>(nodes[index - 1]) : size_t{0}};
+				const size_t right{nodes[index + 1]};
+
+				if (left == 0 && right == 0) { nodes[index] = 1; return; }
+
+				//The block on the left, if any, keeps its start and numbering. Index and the block on the right are renumbered after it.
+				const size_t start {index - left};
+				const size_t length{left + 1 + right};
+				for (size_t i{left}; i < length; i++) { nodes[start + i] = static_cast<value_type>(i + 1); }
+				nodes[start] = static_cast<value_type>(length);
+				}
+
+			/// <summary> Undefined behaviour if the node isn't skipped. </summary>
+			void unskip(size_t index) noexcept
+				{
+				const size_t value{nodes[index]};
+				const size_t start {is_block_start(index) ? index : index + 1 - value};
+				const size_t length{nodes[start]};
+
+				const size_t left_length {index - start};
+				const size_t right_length{length - left_length - 1};
+
+				nodes[index] = 0;
+				if (left_length > 0)
+					{
+					nodes[start    ] = static_cast<value_type>(left_length);
+					nodes[index - 1] = static_cast<value_type>(left_length);
+					}
+				if (right_length > 0)
+					{
+					for (size_t i{1}; i < right_length; i++) { nodes[index + 1 + i] = static_cast<value_type>(i + 1); }
+					nodes[index + 1] = static_cast<value_type>(right_length);
+					}
+				}
+
+		private:
+			/// <summary> The last node is never skipped, jumps from a block that ends the range land there. </summary>
+			std::array<value_type, size + 1> nodes;
+
+			bool is_block_start(size_t index) const noexcept { return index == 0 || nodes[index - 1] == 0; }
+		};
+	}
\ No newline at end of file
@@ -6,8 +6,11 @@
 
 #include "../../memory.h"
 #include <array>
+#include <compare>
+#include <iterator>
+
+#include "jump_counting_skipfield.h"
 
-//TODO complete iterators
 namespace utils::containers
 	{
 	template <typename T, size_t inner_size>
@@ -20,6 +23,9 @@ namespace utils::containers::hive
 	/// Elements addresses never change. Valid iterators are only partially invalidated by insertions. 
 	/// After an operation that adds a new element to the container, existing iterators may be safely dereferenced. However incrementing or decrementing such iterators may skip newly added elements.
 	/// After an operation that removes an existing element container, existing iterators to other elements may be safely dereferenced. However incrementing or decrementing such iterators is UB.
+	/// Each segment keeps a jump-counting skipfield of its free slots, so iteration only visits existing elements.
+	/// Each segment also keeps its own free list, and the segments with free slots are linked together, so both insertion and erasure are O(1).
+	/// compact moves elements out of the last segments to release them, iterators to moved elements are reported through a callback.
 	/// </summary>
 	/// <typeparam name="T"></typeparam>
 	/// <typeparam name="Allocator"></typeparam>
@@ -31,6 +37,7 @@ namespace utils::containers::hive
 			union slot_t
 				{
 				T element; 
+				/// <summary> Index in the segment of the next free slot, inner_size for the last one. </summary>
 				size_t next_free;
 
 				//these are needed because the inner_container's array of slot_t needs to know an explicit constructor and destructor for slot_t when slot_t contains a non-trivially constructible/destructible type
@@ -39,15 +46,27 @@ namespace utils::containers::hive
 				};
 			template<typename iter_t>
 			struct base_iterator;
-			template<typename iter_t>
-			struct base_reverse_iterator;
 
 #pragma region segment 
-			using segment_t = std::array<slot_t, inner_size> ;
+			struct segment_t
+				{
+				std::array<slot_t, inner_size> slots;
+				jump_counting_skipfield<inner_size> skipfield;
+
+				/// <summary> First free slot, inner_size if the segment is full. </summary>
+				size_t free_head{0};
+				utils::observer_ptr<segment_t> prev_with_free{nullptr};
+				utils::observer_ptr<segment_t> next_with_free{nullptr};
+				/// <summary> Position in segments. </summary>
+				size_t index{0};
+
+				bool empty() const noexcept { return skipfield.next_unskipped(0) == inner_size; }
+				};
 #pragma endregion segment
 
 			using segment_ptr_t = utils::observer_ptr<segment_t>;
 			using segment_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_t>;
+			using segments_table_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_ptr_t>;
 
 #pragma region iterators
 			template<typename iter_T>
@@ -69,17 +88,17 @@ namespace utils::containers::hive
 					using const_reference   = const reference;
 					using pointer           = value_type* ;
 					using const_pointer     = const pointer;
-					using iterator_category = std::forward_iterator_tag;
+					using iterator_category = std::bidirectional_iterator_tag;
 					using difference_type   = ptrdiff_t ;
 
 					base_iterator() : container_ptr{nullptr} {}
-					base_iterator(size_t index, next& container, pointer element_ptr, size_t next_free) : index{index}, container_ptr{&container}, element_ptr{element_ptr}, next_free{next_free} { }
+					base_iterator(size_t index, next& container) : index{index}, container_ptr{&container}, element_ptr{container.element_at(index)} { }
 
 					operator utils::observer_ptr<T> () { return element_ptr; }
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
-					base_iterator(const base_iterator<rhs_T>& other) : index{other.index}, container_ptr{other.container_ptr}, element_ptr{const_cast<pointer>(other.element_ptr)}, next_free{other.next_free} {}
+					base_iterator(const base_iterator<rhs_T>& other) : index{other.index}, container_ptr{other.container_ptr}, element_ptr{const_cast<pointer>(other.element_ptr)} {}
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
@@ -110,26 +129,17 @@ namespace utils::containers::hive
 
 					self_type& operator+=(difference_type rhs) noexcept { *this = *this + rhs; return *this; }
 
-					self_type  operator++(   ) noexcept { self_type i = *this; increment_index(); return i; }
-					self_type& operator++(int) noexcept { increment_index(); return *this; }
-
-					template<typename rhs_T>
-						requires std::same_as < slot_t, std::remove_cv_t<rhs_T>>
-					self_type& operator=(const base_iterator<rhs_T>& other)
-						{
-						index         = other.index;
-						container_ptr = other.container_ptr;
-						element_ptr   = other.element_ptr;
-						next_free     = other.next_free;
-						return *this;
-						}
+					self_type& operator++(   ) noexcept { increment_index(); return *this; }
+					self_type  operator++(int) noexcept { self_type i = *this; increment_index(); return i; }
+					self_type& operator--(   ) noexcept { decrement_index(); return *this; }
+					self_type  operator--(int) noexcept { self_type i = *this; decrement_index(); return i; }
 
 					const_reference operator* () const noexcept                                  { return *element_ptr; }
-					reference       operator* ()       noexcept requires(!std::is_const<iter_T>) { return *element_ptr; }
+					reference       operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *element_ptr; }
 					const_pointer   operator->() const noexcept                                  { return  element_ptr; }
-					pointer         operator->()       noexcept requires(!std::is_const<iter_T>) { return  element_ptr; }
+					pointer         operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  element_ptr; }
 					bool operator== (const self_type& rhs) const noexcept { return element_ptr == rhs.element_ptr; }
-					bool operator<=>(const self_type& rhs) const noexcept { return index <=> rhs.index; }
+					std::strong_ordering operator<=>(const self_type& rhs) const noexcept { return index <=> rhs.index; }
 
 					//TODO: this seems enough to auto-generate the hash. Check if standard or accidentally working with this compiler
 					friend struct std::hash<utils::containers::hive::next<T, inner_size, Allocator>::base_iterator<iter_T>>;
@@ -137,18 +147,18 @@ namespace utils::containers::hive
 				private:
 					void increment_index()
 						{
-						while (++index == next_free)
-							{
-							if (index == container_ptr->capacity()) { element_ptr = nullptr; return; }
-							next_free = container_ptr->operator[](next_free).next_free;
-							}
-						element_ptr = std::addressof(container_ptr->address_at(index)->element);
+						index       = container_ptr->next_element_index(index + 1);
+						element_ptr = container_ptr->element_at(index);
+						}
+					void decrement_index()
+						{
+						index       = container_ptr->previous_element_index(index);
+						element_ptr = container_ptr->element_at(index);
 						}
 
 					size_t  index;
 					next*   container_ptr;
 					pointer element_ptr;
-					size_t  next_free;
 				};
 #pragma endregion iterators
 
@@ -163,13 +173,13 @@ namespace utils::containers::hive
 
 			using iterator               = base_iterator        <      T>;
 			using const_iterator         = base_iterator        <const T>;
-			using reverse_iterator       = base_reverse_iterator<      T>;
-			using const_reverse_iterator = base_reverse_iterator<const T>;
+			using reverse_iterator       = std::reverse_iterator<iterator      >;
+			using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
 			using handle_t = iterator;
 
 			next() {}
-			next(const Allocator& allocator) : segment_allocator{allocator} {}
+			next(const Allocator& allocator) : segments{allocator}, segment_allocator{allocator} {}
 
 			~next() { clear(); }
 			
@@ -177,41 +187,130 @@ namespace utils::containers::hive
 			bool   empty()    const noexcept { return !size(); }
 			size_t capacity() const noexcept { return segments.size() * inner_size; }
 
-			void shrink_to_fit() noexcept { /*Done because the standard says it's fine to do nothing lol :) */ } //TODO
+			/// <summary> Releases the trailing empty segments. Use compact first to empty them. </summary>
+			void shrink_to_fit() noexcept { while (release_last_segment_if_empty()) {} }
 
 			inline void clear()
 				{
 				//Detructions
-				size_t free{first_free};
-
-				for (size_t i{0}; i < capacity(); i++)
+				for (size_t i{next_element_index(0)}; i < capacity(); i = next_element_index(i + 1))
 					{
-					if (i != free)
-						{
-						auto& slot{*address_at(i)};
-						slot.element.~T();
-						}
-					else { free = address_at(free)->next_free; }
+					address_at(i)->element.~T();
 					}
 
-
 				//Deallocate segments
 				auto segments_it{segments.begin()};
 				for (; segments_it != segments.end(); segments_it++)
 					{
+					std::allocator_traits<segment_allocator_t>::destroy   (segment_allocator, *segments_it);
 					std::allocator_traits<segment_allocator_t>::deallocate(segment_allocator, *segments_it, 1);
 					}
 				segments.clear();
 
+				segments_with_free = {};
 				_size = 0;
 				}
 
 			template <typename ...Args>
 			inline iterator emplace(Args&&... args) 
 				{
-				auto index{first_free};
-				auto& slot{ get_free_slot() };
-				auto previous_next_free{ slot.next_free };
+				if (!segments_with_free.head) { grow(); }
+				return {emplace_in(*segments_with_free.head, std::forward<Args>(args)...), *this};
+				}
+
+			inline iterator push(const value_type& value)
+				{
+				return emplace(value);
+				}
+
+			void erase(const_iterator erased) { erase_at(erased.index); }
+
+			/// <summary>
+			/// Incremental defragmentation: moves up to budget elements from the last segments to free slots of earlier ones, releasing the trailing segments that end up empty.
+			/// After each move relocated(from, to) is called with iterators to the old and new location of the element. from no longer refers to an element, it's only meaningful for comparisons:
+			/// every iterator equal to from must be replaced by to before the next call, other iterators are left valid.
+			/// </summary>
+			/// <returns> False once there's nothing left to compact: every segment before the one holding the last element is full. </returns>
+			template <typename callback_t>
+			bool compact(size_t budget, callback_t&& relocated)
+				{
+				for (; budget > 0; budget--)
+					{
+					if (segments.empty()) { return false; }
+					if (release_last_segment_if_empty()) { continue; }
+
+					const size_t source_index{previous_element_index(capacity())};
+					const size_t source_segment_index{segment_index_containing_my_index(source_index)};
+
+					//Segments with free slots after the source one are empty, move them to the back so emplace and the next moves prefer earlier ones.
+					segment_ptr_t destination{segments_with_free.head};
+					for (size_t rotated{0}; destination && destination->index >= source_segment_index; rotated++)
+						{
+						if (rotated == segments_with_free.count) { return false; }
+						unlink_segment_with_free(destination);
+						link_segment_with_free(destination, true);
+						destination = segments_with_free.head;
+						}
+					if (!destination) { return false; }
+
+					const size_t destination_index{emplace_in(*destination, std::move(address_at(source_index)->element))};
+					erase_at(source_index);
+					relocated(iterator{source_index, *this}, iterator{destination_index, *this});
+					}
+				return true;
+				}
+
+			const_iterator         cbegin () const { return {next_element_index(0), const_cast<next&>(*this)}; }
+			const_iterator         begin  () const { return {next_element_index(0), const_cast<next&>(*this)}; }
+			iterator               begin  ()       { return {next_element_index(0),                   *this }; }
+			
+ 			const_iterator         cend   () const { return {capacity()           , const_cast<next&>(*this)}; }
+			const_iterator         end    () const { return {capacity()           , const_cast<next&>(*this)}; }
+			iterator               end    ()       { return {capacity()           ,                   *this }; }
+
+			const_reverse_iterator crbegin() const { return const_reverse_iterator{cend  ()}; }
+			const_reverse_iterator rbegin () const { return const_reverse_iterator{end   ()}; }
+			reverse_iterator       rbegin ()       { return reverse_iterator      {end   ()}; }
+			const_reverse_iterator crend  () const { return const_reverse_iterator{cbegin()}; }
+			const_reverse_iterator rend   () const { return const_reverse_iterator{begin ()}; }
+			reverse_iterator       rend   ()       { return reverse_iterator      {begin ()}; }
+
+		protected:
+			struct segments_with_free_t
+				{
+				segment_ptr_t head{nullptr};
+				segment_ptr_t tail{nullptr};
+				size_t count{0};
+				};
+
+			std::vector<segment_ptr_t, segments_table_allocator_t> segments;
+			segments_with_free_t segments_with_free;
+			size_t _size{0};
+			
+			segment_allocator_t segment_allocator;
+
+			void grow()
+				{
+				segment_ptr_t new_segment_ptr{ std::allocator_traits<segment_allocator_t>::allocate(segment_allocator, 1) };
+				std::allocator_traits<segment_allocator_t>::construct(segment_allocator, new_segment_ptr);
+				segments.push_back(new_segment_ptr);
+
+				auto& new_segment{*new_segment_ptr };
+				new_segment.index = segments.size() - 1;
+				for (size_t i{ 0 }; i < inner_size; i++)
+					{
+					new_segment.slots[i].next_free = i + 1;
+					}
+				link_segment_with_free(new_segment_ptr);
+				}
+
+			/// <returns> The index of the new element. The segment must have a free slot. </returns>
+			template <typename ...Args>
+			size_t emplace_in(segment_t& segment, Args&&... args)
+				{
+				const size_t inner_index{segment.free_head};
+				auto& slot{segment.slots[inner_index]};
+				const size_t previous_next_free{slot.next_free};
 
 				try
 					{
@@ -224,72 +323,104 @@ namespace utils::containers::hive
 					}
 
 				_size++;
+				segment.skipfield.unskip(inner_index);
 
-				first_free = previous_next_free;
-				return {index, *this, &(address_at(static_cast<size_t>(index))->element), previous_next_free};
+				segment.free_head = previous_next_free;
+				if (segment.free_head == inner_size) { unlink_segment_with_free(std::addressof(segment)); }
+				return segment.index * inner_size + inner_index;
 				}
 
-			inline iterator push(const value_type& value)
+			void erase_at(size_t index)
 				{
-				return emplace(value);
-				}
+				segment_t& segment{*segments[segment_index_containing_my_index(index)]};
+				const size_t inner_index{my_index_to_segment_index(index)};
 
-			void erase(const_iterator erased)
-				{
-				auto& my_slot{ *address_at(erased.index) };
+				auto& my_slot{segment.slots[inner_index]};
 				my_slot.element.~T();
+				segment.skipfield.skip(inner_index);
 
-				size_t* last_free_before_me{ &first_free };
-
-				//Increase until the first empty slot which next_free is greater than index
-				while (erased.index > *last_free_before_me) { last_free_before_me = &(address_at(*last_free_before_me)->next_free); }
-
-				auto previous_free{ *last_free_before_me };
-				*last_free_before_me = erased.index;
-
-				my_slot.next_free = previous_free;
+				const bool was_full{segment.free_head == inner_size};
+				my_slot.next_free = segment.free_head;
+				segment.free_head = inner_index;
+				if (was_full) { link_segment_with_free(std::addressof(segment)); }
 
 				_size--;
 				}
 
-			const_iterator         cbegin () const { return {0     , *this, std::addressof(address_at(static_cast<size_t>(0))->element), first_free}; }
-			const_iterator         begin  () const { return {0     , *this, std::addressof(address_at(static_cast<size_t>(0))->element), first_free}; }
-			iterator               begin  ()       { return {0     , *this, std::addressof(address_at(static_cast<size_t>(0))->element), first_free}; }
-			
- 			const_iterator         cend   () const { return {size(), *this, nullptr                                                    , 0         }; }
-			const_iterator         end    () const { return {size(), *this, nullptr                                                    , 0         }; }
-			iterator               end    ()       { return {size(), *this, nullptr                                                    , 0         }; }
-
-		protected:
-			std::vector<utils::observer_ptr<segment_t>> segments;
-			size_t first_free{0};
-			size_t _size     {0};
-			
-			segment_allocator_t segment_allocator;
-
-			slot_t& get_free_slot()
+			void link_segment_with_free(segment_ptr_t segment, bool at_back = false) noexcept
 				{
-				grow_if_full();
-				return *address_at(first_free);
+				if (at_back)
+					{
+					segment->prev_with_free = segments_with_free.tail;
+					segment->next_with_free = nullptr;
+					if (segments_with_free.tail) { segments_with_free.tail->next_with_free = segment; }
+					else { segments_with_free.head = segment; }
+					segments_with_free.tail = segment;
+					}
+				else
+					{
+					segment->prev_with_free = nullptr;
+					segment->next_with_free = segments_with_free.head;
+					if (segments_with_free.head) { segments_with_free.head->prev_with_free = segment; }
+					else { segments_with_free.tail = segment; }
+					segments_with_free.head = segment;
+					}
+				segments_with_free.count++;
 				}
-
-			void grow_if_full()
+			void unlink_segment_with_free(segment_ptr_t segment) noexcept
 				{
-				if (first_free >= capacity()) { grow(); }
+				if (segment->prev_with_free) { segment->prev_with_free->next_with_free = segment->next_with_free; }
+				else { segments_with_free.head = segment->next_with_free; }
+				if (segment->next_with_free) { segment->next_with_free->prev_with_free = segment->prev_with_free; }
+				else { segments_with_free.tail = segment->prev_with_free; }
+				segment->prev_with_free = segment->next_with_free = nullptr;
+				segments_with_free.count--;
 				}
 
-			void grow()
+			bool release_last_segment_if_empty() noexcept
 				{
-				segment_ptr_t new_segment_ptr{ std::allocator_traits<segment_allocator_t>::allocate(segment_allocator, 1) };
-				segments.push_back(new_segment_ptr);
-
-				auto& new_segment{*new_segment_ptr };
+				if (segments.empty() || !segments.back()->empty()) { return false; }
+				const segment_ptr_t segment{segments.back()};
+				unlink_segment_with_free(segment);
+				std::allocator_traits<segment_allocator_t>::destroy   (segment_allocator, segment);
+				std::allocator_traits<segment_allocator_t>::deallocate(segment_allocator, segment, 1);
+				segments.pop_back();
+				return true;
+				}
 
-				for (size_t i{ 0 }; i < inner_size; i++)
+			/// <returns> The index of the first element at or after index, capacity() if there's none. Jumps over free slots through the segments' skipfields. </returns>
+			size_t next_element_index(size_t index) const noexcept
+				{
+				size_t segment_index{segment_index_containing_my_index(index)};
+				size_t inner_index  {my_index_to_segment_index        (index)};
+				for (; segment_index < segments.size(); segment_index++, inner_index = 0)
+					{
+					inner_index = segments[segment_index]->skipfield.next_unskipped(inner_index);
+					if (inner_index < inner_size) { return segment_index * inner_size + inner_index; }
+					}
+				return capacity();
+				}
+			/// <returns> The index of the last element before index. Undefined behaviour if there's none. </returns>
+			size_t previous_element_index(size_t index) const noexcept
+				{
+				size_t segment_index{segment_index_containing_my_index(index)};
+				size_t inner_index  {my_index_to_segment_index        (index)};
+				while (true)
 					{
-					new_segment[i].next_free = i + 1;
+					if (segment_index < segments.size())
+						{
+						inner_index = segments[segment_index]->skipfield.previous_unskipped(inner_index);
+						if (inner_index != jump_counting_skipfield<inner_size>::npos) { return segment_index * inner_size + inner_index; }
+						}
+					segment_index--;
+					inner_index = inner_size;
 					}
 				}
+			/// <returns> The element at index, nullptr for capacity(). </returns>
+			pointer element_at(size_t index) noexcept
+				{
+				return index < capacity() ? std::addressof(address_at(index)->element) : nullptr;
+				}
 			
 			const segment_t& first_segment() const noexcept{ return *segments[0                  ]; }
 			      segment_t& first_segment()       noexcept{ return *segments[0                  ]; }
@@ -309,25 +440,25 @@ namespace utils::containers::hive
 				{
 				size_t segment_index{segment_index_containing_my_index(index)};
 				if (segment_index >= segments.size()) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				else { return &segments[segment_index]->slots[my_index_to_segment_index(index)]; }
 				}
 			slot_t const* address_at(size_t index) const noexcept
 				{
 				size_t segment_index{segment_index_containing_my_index(index)};
 				if (segment_index >= segments.size()) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				else { return &segments[segment_index]->slots[my_index_to_segment_index(index)]; }
 				}
 			slot_t address_at(ptrdiff_t  index) noexcept
 				{
 				size_t segment_index{segment_index_containing_my_index(index)};
 				if (segment_index >= segments.size() || segment_index < 0) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				else { return &segments[segment_index]->slots[my_index_to_segment_index(index)]; }
 				}
 			slot_t const* address_at(ptrdiff_t  index) const noexcept
 				{
 				size_t segment_index{segment_index_containing_my_index(index)};
 				if (segment_index >= segments.size() || segment_index < 0) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				else { return &segments[segment_index]->slots[my_index_to_segment_index(index)]; }
 				}
 
 			static size_t distance(segment_ptr_t leftmost, segment_ptr_t rightmost)
@@ -347,12 +478,12 @@ namespace utils::containers::hive
 				
 			const slot_t& operator[](const size_t index) const noexcept
 				{
-				return (*segments[segment_index_containing_my_index(index)])[my_index_to_segment_index(index)];
+				return segments[segment_index_containing_my_index(index)]->slots[my_index_to_segment_index(index)];
 				}
 
 			      slot_t& operator[](const size_t index)       noexcept
 				{
-				return (*segments[segment_index_containing_my_index(index)])[my_index_to_segment_index(index)];
+				return segments[segment_index_containing_my_index(index)]->slots[my_index_to_segment_index(index)];
 				}
 		};
 
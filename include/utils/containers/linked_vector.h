@@ -1,4 +1,6 @@
 #pragma once
+#include <bit>
+#include <span>
 #include <memory>
 #include <utility>
 #include <type_traits>
@@ -9,9 +11,15 @@
 
 namespace utils::containers
 	{
+	/// <summary>
+	/// Vector made of linked fixed size segments, elements never move when the container grows.
+	/// Besides the links, segments are listed in a contiguous table: random access and iterator jumps are a shift, a mask and a load instead of a walk along the links.
+	/// for_each_segment exposes the contiguous segments directly.
+	/// </summary>
 	template <typename T, size_t inner_size = 8, typename Allocator = std::allocator<T>>
 	class linked_vector
 		{
+		static_assert(std::has_single_bit(inner_size), "linked_vector inner_size must be a power of two.");
 
 		private:
 			template<typename iter_t>
@@ -79,9 +87,9 @@ namespace utils::containers
 							self_type& operator--(int) noexcept { ptr--; return *this; }
 
 							const_reference operator* () const noexcept                             { return *ptr; }
-								  reference operator* ()       noexcept requires(!std::is_const<iter_T>) { return *ptr; }
+								  reference operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *ptr; }
 							const_pointer   operator->() const noexcept                             { return  ptr; }
-								  pointer   operator->()       noexcept requires(!std::is_const<iter_T>) { return  ptr; }
+								  pointer   operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  ptr; }
 			
 							auto operator<=>(const self_type& rhs) const noexcept { return ptr <=> rhs.ptr; }
 							bool operator== (const self_type& rhs) const noexcept { return ptr ==  rhs.ptr; }
@@ -139,9 +147,9 @@ namespace utils::containers
 							self_type& operator--(int) noexcept { *this = ptr++; return *this; }
 
 							const_reference operator* () const noexcept                             { return *ptr; }
-								  reference operator* ()       noexcept requires(!std::is_const<iter_T>) { return *ptr; }
+								  reference operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *ptr; }
 							const_pointer   operator->() const noexcept                             { return  ptr; }
-								  pointer   operator->()       noexcept requires(!std::is_const<iter_T>) { return  ptr; }
+								  pointer   operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  ptr; }
 
 							bool operator==(const self_type& rhs) const noexcept { return ptr == rhs.ptr; }
 							bool operator!=(const self_type& rhs) const noexcept { return ptr != rhs.ptr; }
@@ -188,11 +196,14 @@ namespace utils::containers
 					utils::observer_ptr<segment_t> next;
 					utils::observer_ptr<segment_t> prev;
 					size_t size;
+					/// <summary> Position in the container's segments table. </summary>
+					size_t index;
 				};
 #pragma endregion segment
 
 			using segment_ptr_t = utils::observer_ptr<segment_t>;
 			using segment_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_t>;
+			using segments_table_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_ptr_t>;
 
 #pragma region iterators
 
@@ -216,12 +227,12 @@ namespace utils::containers
 					using iterator_category = std::random_access_iterator_tag;
 					using difference_type   = ptrdiff_t ;
 
-					base_iterator() : segment_iterator{ nullptr }, segment_ptr{ nullptr } { }
-					base_iterator(segment_iterator_t segment_iterator, const segment_ptr_t segment_ptr) : segment_iterator{ segment_iterator }, segment_ptr{ segment_ptr } { }
+					base_iterator() : segment_iterator{ nullptr }, segment_ptr{ nullptr }, container_ptr{ nullptr } { }
+					base_iterator(segment_iterator_t segment_iterator, const segment_ptr_t segment_ptr, const linked_vector* container_ptr) : segment_iterator{ segment_iterator }, segment_ptr{ segment_ptr }, container_ptr{ container_ptr } { }
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
-					base_iterator(const base_iterator<rhs_T>& other) : segment_iterator{ other.segment_iterator }, segment_ptr{ other.segment_ptr } {}
+					base_iterator(const base_iterator<rhs_T>& other) : segment_iterator{ other.segment_iterator }, segment_ptr{ other.segment_ptr }, container_ptr{ other.container_ptr } {}
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
@@ -229,102 +240,26 @@ namespace utils::containers
 						{
 						segment_iterator = other.segment_iterator;
 						segment_ptr      = other.segment_ptr;
+						container_ptr    = other.container_ptr;
 						return *this;
 						}
 
-					self_type  operator+ (difference_type rhs)
+					self_type  operator+ (difference_type rhs) const
 						{
-						auto ret{ *this };
-
-						auto to_end{ segment_ptr->end() - segment_iterator };
-						if (rhs < to_end)
+						const difference_type offset{ (segment_iterator - segment_ptr->begin()) + rhs };
+						if (offset >= 0 && offset < static_cast<difference_type>(inner_size))
 							{
+							auto ret{ *this };
 							ret.segment_iterator += rhs;
 							return ret;
 							}
-
-						auto leftover{ rhs - to_end };
-
-						while(true)
-							{
-							if (!ret.segment_ptr->next) { return { ret.segment_ptr->end(), ret.segment_ptr }; }
-
-							ret.segment_ptr = ret.segment_ptr->next;
-							if (leftover < inner_size) { break; }
-							
-							leftover -= inner_size;
-							}
-
-						ret.segment_iterator = ret.segment_ptr->begin() + leftover;
-
-						return ret;
-						}
-					self_type  operator- (difference_type rhs)
-						{
-						auto ret{ *this };
-
-						auto to_begin{ segment_iterator - segment_ptr->begin() };
-						if (rhs <= to_begin)
-							{
-							ret.segment_iterator -= rhs;
-							return ret;
-							}
-
-						auto leftover{ rhs - to_begin };
-						ret.segment_ptr = ret.segment_ptr->prev;
-
-						while (leftover > inner_size)
-							{
-							ret.segment_ptr = ret.segment_ptr->prev;
-							leftover -= inner_size;
-							}
-
-						ret.segment_iterator = ret.segment_ptr->end() - leftover;
-
-						return ret;
+						return container_ptr->template iterator_at<iter_T>(position() + rhs);
 						}
+					self_type  operator- (difference_type rhs) const { return *this + (-rhs); }
 
 					template<typename rhs_T>
 						requires std::same_as <T, std::remove_cv_t<rhs_T>>
-					difference_type operator- (const base_iterator<rhs_T>& rhs) const noexcept
-						{ 
-						if (segment_ptr == rhs.segment_ptr)
-							{
-							return segment_iterator - rhs.segment_iterator;
-							}
-
-						auto a{ this->segment_ptr };
-						auto b{ rhs  .segment_ptr };
-
-						size_t iterations{ 1 };
-						while(a->prev)
-							{
-							a = a->prev;
-
-							if (a == rhs.segment_ptr)
-								{
-								difference_type a_to_begin{ this->segment_iterator   - this->segment_ptr->begin() };
-								difference_type b_to_end  { rhs  .segment_ptr->end() - rhs  .segment_iterator     };
-								return  static_cast<difference_type>(a_to_begin + iterations + b_to_end);
-								}
-							iterations++;
-							}
-							
-						iterations = 1;
-						while (b->prev)
-							{
-							b = b->prev;
-
-							if (b == this->segment_ptr)
-								{
-								difference_type a_to_end  { this->segment_ptr->end() - this->segment_iterator};
-								difference_type b_to_begin{ rhs  .segment_iterator   - rhs.segment_ptr->begin()  };
-								return -static_cast<difference_type>(a_to_end + iterations + b_to_begin);
-								}
-							iterations++;
-							}
-						return {}; // this should not happen!
-						}
+					difference_type operator- (const base_iterator<rhs_T>& rhs) const noexcept { return position() - rhs.position(); }
 
 					self_type& operator+=(difference_type rhs) { *this = *this + rhs; return *this; }
 					self_type& operator-=(difference_type rhs) { *this = *this - rhs; return *this; }
@@ -348,44 +283,23 @@ namespace utils::containers
 					self_type& operator--(int) { operator--(); return *this; }
 					
 					const_reference operator* () const noexcept                                  { return *segment_iterator; }
-					reference       operator* ()       noexcept requires(!std::is_const<iter_T>) { return *segment_iterator; }
+					reference       operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *segment_iterator; }
 					const_pointer   operator->() const noexcept                                  { return  segment_iterator.operator->(); }
-					pointer         operator->()       noexcept requires(!std::is_const<iter_T>) { return  segment_iterator.operator->(); }
+					pointer         operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  segment_iterator.operator->(); }
 					bool operator==(const self_type& rhs) const noexcept 
 						{
 						if (!segment_ptr || !rhs.segment_ptr) { return segment_ptr == rhs.segment_ptr; }
 						return segment_iterator == rhs.segment_iterator; 
 						}
 					bool operator!=(const self_type& rhs) const noexcept { return !(segment_iterator == rhs.segment_iterator); }
-					bool operator< (const self_type& rhs) const noexcept 
-						{ 
-						if (segment_ptr == rhs.segment_ptr) { return segment_iterator < rhs.segment_iterator; }
-
-						segment_ptr_t this_backward{ segment_ptr }, rhs_backward{ rhs.segment_ptr };
-						while (true)
-							{
-							this_backward = this_backward->prev;
-							rhs_backward  = rhs_backward ->prev;
-							if (!this_backward) { return true  ;}
-							if (!rhs_backward ) { return false ;}
-							}
-						}
-					bool operator> (const self_type& rhs) const noexcept
-						{
-						if (segment_ptr == rhs.segment_ptr) { return segment_iterator > rhs.segment_iterator; }
-
-						segment_ptr_t this_backward{ segment_ptr }, rhs_backward{ rhs.segment_ptr };
-						while (true)
-							{
-							this_backward = this_backward->prev;
-							rhs_backward  = rhs_backward ->prev;
-							if (!this_backward) { return false ;}
-							if (!rhs_backward ) { return true  ;}
-							}
-						}
+					bool operator< (const self_type& rhs) const noexcept { return position() < rhs.position(); }
+					bool operator> (const self_type& rhs) const noexcept { return position() > rhs.position(); }
 				private:
-					segment_iterator_t segment_iterator;
-					segment_ptr_t      segment_ptr;
+					segment_iterator_t   segment_iterator;
+					segment_ptr_t        segment_ptr;
+					const linked_vector* container_ptr;
+
+					difference_type position() const noexcept { return static_cast<difference_type>(segment_ptr->index * inner_size) + (segment_iterator - segment_ptr->begin()); }
 				};
 
 			template<typename iter_T>
@@ -408,12 +322,12 @@ namespace utils::containers
 					using iterator_category = std::random_access_iterator_tag;
 					using difference_type   = ptrdiff_t ;
 
-					base_reverse_iterator() : segment_iterator{ nullptr }, segment_ptr{ nullptr } { }
-					base_reverse_iterator(segment_iterator_t segment_iterator, const segment_ptr_t segment_ptr) : segment_iterator{ segment_iterator }, segment_ptr{ segment_ptr } { }
+					base_reverse_iterator() : segment_iterator{ nullptr }, segment_ptr{ nullptr }, container_ptr{ nullptr } { }
+					base_reverse_iterator(segment_iterator_t segment_iterator, const segment_ptr_t segment_ptr, const linked_vector* container_ptr) : segment_iterator{ segment_iterator }, segment_ptr{ segment_ptr }, container_ptr{ container_ptr } { }
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
-					base_reverse_iterator(const base_reverse_iterator<rhs_T>& other) : segment_iterator{ other.segment_iterator }, segment_ptr{ other.segment_ptr } {}
+					base_reverse_iterator(const base_reverse_iterator<rhs_T>& other) : segment_iterator{ other.segment_iterator }, segment_ptr{ other.segment_ptr }, container_ptr{ other.container_ptr } {}
 
 					template<typename rhs_T>
 						requires std::same_as < T, std::remove_cv_t<rhs_T>>
@@ -421,102 +335,26 @@ namespace utils::containers
 						{
 						segment_iterator = other.segment_iterator;
 						segment_ptr      = other.segment_ptr;
+						container_ptr    = other.container_ptr;
 						return *this;
 						}
 
-					self_type  operator+ (difference_type rhs)
+					self_type  operator+ (difference_type rhs) const
 						{
-						auto ret{ *this };
-
-						auto to_end{ segment_ptr->rend() - segment_iterator };
-						if (rhs < to_end)
+						const difference_type offset{ (segment_iterator.ptr - segment_ptr->arr.data()) - rhs };
+						if (offset >= 0 && offset < static_cast<difference_type>(inner_size))
 							{
+							auto ret{ *this };
 							ret.segment_iterator += rhs;
 							return ret;
 							}
-
-						auto leftover{ rhs - to_end };
-
-						while (true)
-							{
-							if (!ret.segment_ptr->prev) { return { ret.segment_ptr->rend(), ret.segment_ptr }; }
-
-							ret.segment_ptr = ret.segment_ptr->prev;
-							if (leftover < inner_size) { break; }
-
-							leftover -= inner_size;
-							}
-
-						ret.segment_iterator = ret.segment_ptr->rbegin() + leftover;
-
-						return ret;
-						}
-					self_type  operator- (difference_type rhs)
-						{
-						auto ret{ *this };
-
-						auto to_begin{ segment_iterator - segment_ptr->rbegin() };
-						if (rhs <= to_begin)
-							{
-							ret.segment_iterator -= rhs;
-							return ret;
-							}
-
-						auto leftover{ rhs - to_begin };
-						ret.segment_ptr = ret.segment_ptr->next;
-
-						while (leftover > inner_size)
-							{
-							ret.segment_ptr = ret.segment_ptr->next;
-							leftover -= inner_size;
-							}
-
-						ret.segment_iterator = ret.segment_ptr->rend() - leftover;
-
-						return ret;
+						return container_ptr->template reverse_iterator_at<iter_T>(position() - rhs);
 						}
+					self_type  operator- (difference_type rhs) const { return *this + (-rhs); }
 
 					template<typename rhs_T>
 						requires std::same_as <T, std::remove_cv_t<rhs_T>>
-					difference_type operator- (const base_reverse_iterator<rhs_T>& rhs) const noexcept
-						{ 
-						if (segment_ptr == rhs.segment_ptr)
-							{
-							return segment_iterator - rhs.segment_iterator;
-							}
-
-						auto a{ this->segment_ptr };
-						auto b{ rhs  .segment_ptr };
-
-						size_t iterations{ 1 };
-						while(a->next)
-							{
-							a = a->next;
-
-							if (a == rhs.segment_ptr)
-								{
-								difference_type a_to_begin{ this->segment_iterator   - this->segment_ptr->rbegin() };
-								difference_type b_to_end  { rhs  .segment_ptr->rend() - rhs  .segment_iterator     };
-								return  static_cast<difference_type>(a_to_begin + iterations + b_to_end);
-								}
-							iterations++;
-							}
-							
-						iterations = 1;
-						while (b->next)
-							{
-							b = b->next;
-
-							if (b == this->segment_ptr)
-								{
-								difference_type a_to_end  { this->segment_ptr->rend() - this->segment_iterator};
-								difference_type b_to_begin{ rhs  .segment_iterator   - rhs.segment_ptr->rbegin()  };
-								return -static_cast<difference_type>(a_to_end + iterations + b_to_begin);
-								}
-							iterations++;
-							}
-						return {}; // this should not happen!
-						}
+					difference_type operator- (const base_reverse_iterator<rhs_T>& rhs) const noexcept { return rhs.position() - position(); }
 
 					self_type& operator+=(difference_type rhs) { *this = *this + rhs; return *this; }
 					self_type& operator-=(difference_type rhs) { *this = *this - rhs; return *this; }
@@ -540,44 +378,24 @@ namespace utils::containers
 					self_type& operator--(int) { operator--(); return *this; }
 					
 					const_reference operator* () const noexcept                                  { return *segment_iterator; }
-					reference       operator* ()       noexcept requires(!std::is_const<iter_T>) { return *segment_iterator; }
+					reference       operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *segment_iterator; }
 					const_pointer   operator->() const noexcept                                  { return  segment_iterator.operator->(); }
-					pointer         operator->()       noexcept requires(!std::is_const<iter_T>) { return  segment_iterator.operator->(); }
+					pointer         operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  segment_iterator.operator->(); }
 					bool operator==(const self_type& rhs) const noexcept
 						{
 						if (!segment_ptr || !rhs.segment_ptr) { return segment_ptr == rhs.segment_ptr; }
 						return segment_iterator == rhs.segment_iterator;
 						}
 					bool operator!=(const self_type& rhs) const noexcept { return !(segment_iterator == rhs.segment_iterator); }
-					bool operator< (const self_type& rhs) const noexcept 
-						{ 
-						if (segment_ptr == rhs.segment_ptr) { return segment_iterator < rhs.segment_iterator; }
-
-						segment_ptr_t this_backward{ segment_ptr }, rhs_backward{ rhs.segment_ptr };
-						while (true)
-							{
-							this_backward = this_backward->next;
-							rhs_backward  = rhs_backward ->next;
-							if (!this_backward) { return true  ;}
-							if (!rhs_backward ) { return false ;}
-							}
-						}
-					bool operator> (const self_type& rhs) const noexcept
-						{
-						if (segment_ptr == rhs.segment_ptr) { return segment_iterator > rhs.segment_iterator; }
-
-						segment_ptr_t this_backward{ segment_ptr }, rhs_backward{ rhs.segment_ptr };
-						while (true)
-							{
-							this_backward = this_backward->next;
-							rhs_backward  = rhs_backward ->next;
-							if (!this_backward) { return false ;}
-							if (!rhs_backward ) { return true  ;}
-							}
-						}
+					bool operator< (const self_type& rhs) const noexcept { return position() > rhs.position(); }
+					bool operator> (const self_type& rhs) const noexcept { return position() < rhs.position(); }
 				private:
-					segment_iterator_t segment_iterator;
-					segment_ptr_t      segment_ptr;
+					segment_iterator_t   segment_iterator;
+					segment_ptr_t        segment_ptr;
+					const linked_vector* container_ptr;
+
+					/// <summary> Index of the element in the container, -1 for rend. </summary>
+					difference_type position() const noexcept { return static_cast<difference_type>(segment_ptr->index * inner_size) + (segment_iterator.ptr - segment_ptr->arr.data()); }
 				};
 #pragma endregion iterators
 
@@ -594,17 +412,32 @@ namespace utils::containers
 			using const_reverse_iterator = base_reverse_iterator<const T>;
 
 			linked_vector() {}
-			linked_vector(const Allocator& allocator) : segment_allocator{allocator} {}
+			linked_vector(const Allocator& allocator) : segments{allocator}, segment_allocator{allocator} {}
 
 			~linked_vector() { clear(); }
 
-			inline size_t capacity() const noexcept { return _segments_count * inner_size; }
+			inline size_t capacity() const noexcept { return segments_count() * inner_size; }
 			inline size_t size()     const noexcept
 				{
 				if (segment_ptr_t segment = last_segment_ptr){ return (segments_count() - 1) * inner_size + segment->size; }
 				return 0;
 				}
 
+			const T& operator[](const size_t index) const noexcept { return segments[index >> segment_shift]->arr[index & segment_mask]; }
+			      T& operator[](const size_t index)       noexcept { return segments[index >> segment_shift]->arr[index & segment_mask]; }
+
+			/// <summary> Calls callback with a span over each segment's elements, in order. Every span but the last one holds inner_size elements. </summary>
+			template <typename callback_t>
+			void for_each_segment(callback_t&& callback)
+				{
+				for (const segment_ptr_t segment : segments) { callback(std::span<T>{segment->arr.data(), segment->size}); }
+				}
+			template <typename callback_t>
+			void for_each_segment(callback_t&& callback) const
+				{
+				for (const segment_ptr_t segment : segments) { callback(std::span<const T>{segment->arr.data(), segment->size}); }
+				}
+
 			inline T& front() { return first_segment->arr[0]; }
 			inline T& back()  { return last_segment_ptr ->arr[last_segment_ptr->size - 1];  }
 
@@ -628,7 +461,7 @@ namespace utils::containers
 					std::allocator_traits<segment_allocator_t>::deallocate(segment_allocator, segment_ptr, 1);
 					first_segment = nullptr;
 					last_segment_ptr  = nullptr;
-					_segments_count = 0;
+					segments.clear();
 					}
 				}
 
@@ -675,6 +508,7 @@ namespace utils::containers
 					auto delete_segment_ptr{ last_segment_ptr };
 					last_segment_ptr = last_segment_ptr->prev;
 					std::allocator_traits<segment_allocator_t>::deallocate(segment_allocator, delete_segment_ptr, 1);
+					segments.pop_back();
 					}
 				new_last_segment_ptr->size = new_end.segment_iterator - new_last_segment_ptr->begin();
 				new_last_segment_ptr->next = nullptr;
@@ -682,31 +516,51 @@ namespace utils::containers
 				return { erase_from };
 				}
 				
-			const_iterator         cbegin () const { if (first_segment) { return { first_segment->cbegin ()                                    , first_segment }; } else { return {}; } }
-			const_iterator         begin  () const { if (first_segment) { return { first_segment->cbegin ()                                    , first_segment }; } else { return {}; } }
-			iterator               begin  ()       { if (first_segment) { return { first_segment->begin  ()                                    , first_segment }; } else { return {}; } }
+			const_iterator         cbegin () const { if (first_segment) { return { first_segment->cbegin ()                                    , first_segment , this }; } else { return {}; } }
+			const_iterator         begin  () const { if (first_segment) { return { first_segment->cbegin ()                                    , first_segment , this }; } else { return {}; } }
+			iterator               begin  ()       { if (first_segment) { return { first_segment->begin  ()                                    , first_segment , this }; } else { return {}; } }
 
 
- 			const_iterator         cend   () const { if (first_segment) { return { last_segment_ptr ->cbegin () +  last_segment_ptr->size              , last_segment_ptr  }; } else { return {}; } }
-			const_iterator         end    () const { if (first_segment) { return { last_segment_ptr ->cbegin () +  last_segment_ptr->size              , last_segment_ptr  }; } else { return {}; } }
-			iterator               end    ()       { if (first_segment) { return { last_segment_ptr ->begin  () +  last_segment_ptr->size              , last_segment_ptr  }; } else { return {}; } }
+ 			const_iterator         cend   () const { if (first_segment) { return { last_segment_ptr ->cbegin () +  last_segment_ptr->size              , last_segment_ptr  , this }; } else { return {}; } }
+			const_iterator         end    () const { if (first_segment) { return { last_segment_ptr ->cbegin () +  last_segment_ptr->size              , last_segment_ptr  , this }; } else { return {}; } }
+			iterator               end    ()       { if (first_segment) { return { last_segment_ptr ->begin  () +  last_segment_ptr->size              , last_segment_ptr  , this }; } else { return {}; } }
 
-			const_reverse_iterator crbegin() const { if (first_segment) { return { last_segment_ptr ->crbegin() + (inner_size - last_segment_ptr->size), last_segment_ptr  }; } else { return {}; } }
-			const_reverse_iterator rbegin () const { if (first_segment) { return { last_segment_ptr ->crbegin() + (inner_size - last_segment_ptr->size), last_segment_ptr  }; } else { return {}; } }
-			reverse_iterator       rbegin ()       { if (first_segment) { return { last_segment_ptr ->rbegin () + (inner_size - last_segment_ptr->size), last_segment_ptr  }; } else { return {}; } }
+			const_reverse_iterator crbegin() const { if (first_segment) { return { last_segment_ptr ->crbegin() + (inner_size - last_segment_ptr->size), last_segment_ptr  , this }; } else { return {}; } }
+			const_reverse_iterator rbegin () const { if (first_segment) { return { last_segment_ptr ->crbegin() + (inner_size - last_segment_ptr->size), last_segment_ptr  , this }; } else { return {}; } }
+			reverse_iterator       rbegin ()       { if (first_segment) { return { last_segment_ptr ->rbegin () + (inner_size - last_segment_ptr->size), last_segment_ptr  , this }; } else { return {}; } }
 
-			const_reverse_iterator crend  () const { if (first_segment) { return { first_segment->crend  ()                                    , first_segment }; } else { return {}; } }
-			const_reverse_iterator rend   () const { if (first_segment) { return { first_segment->crend  ()                                    , first_segment }; } else { return {}; } }
-			reverse_iterator       rend   ()       { if (first_segment) { return { first_segment->rend   ()                                    , first_segment }; } else { return {}; } }
+			const_reverse_iterator crend  () const { if (first_segment) { return { first_segment->crend  ()                                    , first_segment , this }; } else { return {}; } }
+			const_reverse_iterator rend   () const { if (first_segment) { return { first_segment->crend  ()                                    , first_segment , this }; } else { return {}; } }
+			reverse_iterator       rend   ()       { if (first_segment) { return { first_segment->rend   ()                                    , first_segment , this }; } else { return {}; } }
 
 		protected:
+			inline static constexpr size_t segment_shift{static_cast<size_t>(std::countr_zero(inner_size))};
+			inline static constexpr size_t segment_mask {inner_size - 1};
+
 			segment_ptr_t  first_segment {nullptr};
 			segment_ptr_t  last_segment_ptr  {nullptr};
 
-			size_t              _segments_count{0};
+			std::vector<segment_ptr_t, segments_table_allocator_t> segments;
 			segment_allocator_t segment_allocator ;
 
-			inline size_t segments_count() const { return _segments_count; }
+			inline size_t segments_count() const { return segments.size(); }
+
+			/// <summary> Iterator to the element at position, end() past the last one. </summary>
+			template <typename iter_T>
+			base_iterator<iter_T> iterator_at(ptrdiff_t position) const noexcept
+				{
+				if (static_cast<size_t>(position) >= size()) { return { last_segment_ptr->begin() + last_segment_ptr->size, last_segment_ptr, this }; }
+				const segment_ptr_t segment{ segments[static_cast<size_t>(position) >> segment_shift] };
+				return { segment->begin() + (position & segment_mask), segment, this };
+				}
+			/// <summary> Reverse iterator to the element at position, rend() before the first one. </summary>
+			template <typename iter_T>
+			base_reverse_iterator<iter_T> reverse_iterator_at(ptrdiff_t position) const noexcept
+				{
+				if (position < 0) { return { first_segment->rend(), first_segment, this }; }
+				const segment_ptr_t segment{ segments[static_cast<size_t>(position) >> segment_shift] };
+				return { segment->rbegin() + (segment_mask - (position & segment_mask)), segment, this };
+				}
 
 			inline const segment_ptr_t get_first() const { return first_segment; }
 			inline       segment_ptr_t get_first()       { return first_segment; }
@@ -734,6 +588,8 @@ namespace utils::containers
 				new_segment->size = 0;
 				new_segment->prev = nullptr;
 				new_segment->next = nullptr;
+				new_segment->index = 0;
+				segments.push_back(new_segment);
 
 				first_segment = new_segment;
 				last_segment_ptr = new_segment;
@@ -748,6 +604,8 @@ namespace utils::containers
 				new_segment->size = 0;
 				new_segment->prev = last_segment_ptr;
 				new_segment->next = nullptr;
+				new_segment->index = segments.size();
+				segments.push_back(new_segment);
 				last_segment_ptr = new_segment;
 
 				return new_segment;
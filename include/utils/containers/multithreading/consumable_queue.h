@@ -93,7 +93,7 @@ namespace utils::containers::multithreading
 
 			void swap_and_consume() { consume_all(producer_consumer_queue<T>::swap_and_get()); }
 
-			void consume_producer() { consume_all(producer_consumer_queue<T>::producer_data); producer_consumer_queue<T>::producer_data.clear(); }
+			void consume_producer() { consume_all(producer_consumer_queue<T>::swap_and_get()); }
 
 			void consume_all(std::vector<T>& elements) 
 				{
@@ -1,48 +1,65 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
 #include <vector>
+#include <cstdint>
+#include <iterator>
 #include <optional>
 
+#include "../../third_party/concurrentqueue.h"
+
+// Multiple producers, single consumer. Producers never lock: elements go to moodycamel's per-producer sub-queues.
+// The consumer collects everything produced so far in one batch (swap_and_get), order is preserved per producer thread.
+
 namespace utils::containers::multithreading
 	{
 	template <typename T>
 	class producer_consumer_queue
 		{
 		public:
-			using value_type      = std::vector<T>::value_type     ; 
-			using allocator_type  = std::vector<T>::allocator_type ; 
-			using pointer         = std::vector<T>::pointer        ; 
-			using const_pointer   = std::vector<T>::const_pointer  ; 
-			using reference       = std::vector<T>::reference      ; 
-			using const_reference = std::vector<T>::const_reference; 
-			using size_type       = std::vector<T>::size_type      ; 
+			using value_type      = std::vector<T>::value_type     ;
+			using allocator_type  = std::vector<T>::allocator_type ;
+			using pointer         = std::vector<T>::pointer        ;
+			using const_pointer   = std::vector<T>::const_pointer  ;
+			using reference       = std::vector<T>::reference      ;
+			using const_reference = std::vector<T>::const_reference;
+			using size_type       = std::vector<T>::size_type      ;
 			using difference_type = std::vector<T>::difference_type;
 
 			template <typename ...Args>
-			void emplace(Args&&... args) 
+			void emplace(Args&&... args)
 				{
-				std::unique_lock lock{ queues_access_mutex };
-				producer_data.emplace_back(std::forward<Args>(args)...);
+				producer_data.enqueue(T(std::forward<Args>(args)...));
+				signal_consumer();
 				}
 
 			void push(const T& element)
 				{
-				std::unique_lock lock{ queues_access_mutex };
-				producer_data.push_back(element);
+				producer_data.enqueue(element);
+				signal_consumer();
+				}
+
+			void push(T&& element)
+				{
+				producer_data.enqueue(std::move(element));
+				signal_consumer();
 				}
 
+			/// <summary> Consumer only. </summary>
 			std::vector<T>& swap_and_get()
 				{
 				consumer_data.clear();
-				if (true)
+
+				// Stop after a partial bulk or once what was there at the beginning has been collected, so fast producers can't starve the consumer.
+				const size_t limit{producer_data.size_approx() + bulk_size};
+				for (size_t dequeued{bulk_size}; dequeued == bulk_size && consumer_data.size() < limit;)
 					{
-					std::unique_lock lock{queues_access_mutex};
-					std::swap(producer_data, consumer_data);
+					dequeued = producer_data.try_dequeue_bulk(std::back_inserter(consumer_data), bulk_size);
 					}
 				return consumer_data;
 				}
 
+			/// <summary> Consumer only. </summary>
 			std::optional<value_type> get()
 				{
 				if (consumer_data.empty()) { return std::nullopt; }
@@ -51,9 +68,45 @@ namespace utils::containers::multithreading
 				return std::move(ret);
 				}
 
+			/// <summary> Consumer only. Blocks until something is pushed or wake_consumer is called. May return spuriously. </summary>
+			void wait_for_work() noexcept
+				{
+				const std::uint32_t observed{signals.load()};
+				if (woken.exchange(false)) { return; }
+
+				consumer_waiting = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (producer_data.size_approx() == 0) { signals.wait(observed); }
+				consumer_waiting = false;
+				}
+
+			/// <summary> Wakes the consumer if it's inside wait_for_work, or makes the next call to wait_for_work return immediately. </summary>
+			void wake_consumer() noexcept
+				{
+				woken = true;
+				signals++;
+				signals.notify_one();
+				}
+
 		protected:
-			std::mutex queues_access_mutex;
-			std::vector<T> producer_data;
+			inline static constexpr size_t bulk_size{256};
+
+			moodycamel::ConcurrentQueue<T> producer_data;
 			std::vector<T> consumer_data;
+
+			std::atomic<std::uint32_t> signals{0};
+			std::atomic_bool consumer_waiting{false};
+			std::atomic_bool woken{false};
+
+			void signal_consumer() noexcept
+				{
+				// Pairs with the fence in wait_for_work: either the consumer sees the new element or this sees the consumer waiting.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (consumer_waiting.load())
+					{
+					signals++;
+					signals.notify_one();
+					}
+				}
 		};
 	}
\ No newline at end of file
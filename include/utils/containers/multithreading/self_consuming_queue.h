@@ -3,7 +3,6 @@
 #include <thread>
 #include <atomic>
 #include <functional>
-#include <condition_variable>
 #include "consumable_queue.h"
 
 namespace utils::containers::multithreading
@@ -43,19 +42,6 @@ namespace utils::containers::multithreading
 				inner_flush();
 				}
 
-			template <typename ...Args>
-			void emplace(Args&&... args) noexcept
-				{
-				consumable_queue_t::emplace(std::forward<Args>(args)...);
-				work_available.notify_one();
-				}
-
-			void push(const value_type& message) noexcept
-				{
-				consumable_queue_t::push(message);
-				work_available.notify_one();
-				}
-
 			void flush()
 				{
 				inner_flush();
@@ -69,7 +55,7 @@ namespace utils::containers::multithreading
 			void inner_flush()
 				{
 				running = false;
-				work_available.notify_one();
+				consumable_queue_t::wake_consumer();
 				thread.join();
 
 				consumable_queue_t::consume_producer();
@@ -79,21 +65,12 @@ namespace utils::containers::multithreading
 				{
 				while (running)
 					{
-					if (true)
-						{
-						std::unique_lock lock{producer_consumer_queue<T>::queues_access_mutex };
-						if (consumable_queue_t::producer_data.empty()) { work_available.wait(lock); }
-
-						consumable_queue_t::consumer_data.clear();
-						consumable_queue_t::consumer_data.swap(producer_consumer_queue<T>::producer_data);
-						}
-
-					consumable_queue_t::consume_all(producer_consumer_queue<T>::consumer_data);
+					consumable_queue_t::wait_for_work();
+					consumable_queue_t::consume_all(consumable_queue_t::swap_and_get());
 					}
 				}
 
 			std::atomic_bool running{ true };
-			std::condition_variable work_available;
 
 			std::thread thread;
 		};
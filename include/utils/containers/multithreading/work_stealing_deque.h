@@ -0,0 +1,135 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+// Chase-Lev work stealing deque, memory orderings as per Le, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+// The owner thread pushes and pops at the bottom (LIFO), any other thread steals from the top (FIFO).
+// Only trivially copyable elements are allowed since slots are read concurrently with a racing steal; in practice T is a pointer.
+
+namespace utils::containers::multithreading
+	{
+	template <typename T>
+		requires(std::is_trivially_copyable_v<T>)
+	class work_stealing_deque
+		{
+		private:
+			class ring_t
+				{
+				public:
+					ring_t(std::int64_t capacity) : capacity{capacity}, mask{capacity - 1}, slots{std::make_unique<std::atomic<T>[]>(static_cast<size_t>(capacity))} {}
+
+					std::int64_t size() const noexcept { return capacity; }
+
+					void store(std::int64_t index, T value) noexcept { slots[static_cast<size_t>(index & mask)].store(value, std::memory_order_relaxed); }
+					T    load (std::int64_t index) const noexcept { return slots[static_cast<size_t>(index & mask)].load(std::memory_order_relaxed); }
+
+					std::unique_ptr<ring_t> grow(std::int64_t bottom, std::int64_t top) const
+						{
+						auto ret{std::make_unique<ring_t>(capacity * 2)};
+						for (std::int64_t i = top; i != bottom; i++) { ret->store(i, load(i)); }
+						return ret;
+						}
+
+				private:
+					std::int64_t capacity;
+					std::int64_t mask;
+					std::unique_ptr<std::atomic<T>[]> slots;
+				};
+
+		public:
+			using value_type = T;
+			using size_type  = size_t;
+
+			/// <summary> Capacity is rounded up to a power of two. </summary>
+			work_stealing_deque(size_t initial_capacity = 256)
+				{
+				std::int64_t capacity{1};
+				while (capacity < static_cast<std::int64_t>(initial_capacity)) { capacity <<= 1; }
+				rings.emplace_back(std::make_unique<ring_t>(capacity));
+				ring.store(rings.back().get(), std::memory_order_relaxed);
+				}
+
+			work_stealing_deque(const work_stealing_deque& copy) = delete;
+			work_stealing_deque& operator=(const work_stealing_deque& copy) = delete;
+
+			/// <summary> Owner thread only. </summary>
+			void push(T value)
+				{
+				const std::int64_t b{bottom.load(std::memory_order_relaxed)};
+				const std::int64_t t{top   .load(std::memory_order_acquire)};
+				ring_t* r{ring.load(std::memory_order_relaxed)};
+
+				if (b - t > r->size() - 1)
+					{
+					// Old rings are kept alive until destruction since a concurrent thief may still be reading from them.
+					rings.emplace_back(r->grow(b, t));
+					r = rings.back().get();
+					ring.store(r, std::memory_order_release);
+					}
+
+				r->store(b, value);
+				std::atomic_thread_fence(std::memory_order_release);
+				bottom.store(b + 1, std::memory_order_relaxed);
+				}
+
+			/// <summary> Owner thread only. </summary>
+			std::optional<T> pop() noexcept
+				{
+				const std::int64_t b{bottom.load(std::memory_order_relaxed) - 1};
+				ring_t* r{ring.load(std::memory_order_relaxed)};
+				bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t t{top.load(std::memory_order_relaxed)};
+
+				if (t > b)
+					{
+					bottom.store(b + 1, std::memory_order_relaxed);
+					return std::nullopt;
+					}
+
+				std::optional<T> ret{r->load(b)};
+				if (t == b)
+					{
+					// Last element, race against thieves.
+					if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { ret = std::nullopt; }
+					bottom.store(b + 1, std::memory_order_relaxed);
+					}
+				return ret;
+				}
+
+			/// <summary> Any thread. May spuriously fail when racing against another thief or the owner. </summary>
+			std::optional<T> steal() noexcept
+				{
+				std::int64_t t{top.load(std::memory_order_acquire)};
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const std::int64_t b{bottom.load(std::memory_order_acquire)};
+
+				if (t >= b) { return std::nullopt; }
+
+				const ring_t* r{ring.load(std::memory_order_acquire)};
+				T ret{r->load(t)};
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) { return std::nullopt; }
+				return ret;
+				}
+
+			/// <summary> Approximate when called concurrently with push/pop/steal. </summary>
+			size_type size() const noexcept
+				{
+				const std::int64_t b{bottom.load(std::memory_order_relaxed)};
+				const std::int64_t t{top   .load(std::memory_order_relaxed)};
+				return b > t ? static_cast<size_type>(b - t) : 0;
+				}
+			bool empty() const noexcept { return size() == 0; }
+
+		private:
+			alignas(64) std::atomic<std::int64_t> top   {0};
+			alignas(64) std::atomic<std::int64_t> bottom{0};
+			alignas(64) std::atomic<ring_t*> ring{nullptr};
+			std::vector<std::unique_ptr<ring_t>> rings;
+		};
+	}
\ No newline at end of file
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <bit>
 #include <array>
+#include <limits>
+#include <mutex>
+#include <atomic>
 #include <bitset>
 #include <memory>
+#include <vector>
+#include <cassert>
+#include <cstdint>
 #include <concepts>
 #include <stdexcept>
+#include <algorithm>
 #include <type_traits>
 
 #include "../memory.h"
 #include "../flags.h"
 #include "../compilation/debug.h"
+#include "hive/jump_counting_skipfield.h"
 
 //TODO finish tests
 //TODO const, reverse and reverse const iterators
@@ -26,13 +35,56 @@ namespace utils::containers
 
 namespace utils::containers::details
 	{
+	/// <summary> The subset of std::bitset used by object_pool, setting and resetting different bits can happen concurrently. </summary>
+	template <size_t size>
+	class atomic_bitset
+		{
+		public:
+			bool operator[](size_t index) const noexcept { return (words[index / bits_per_word].load(std::memory_order_acquire) & bit(index)) != 0; }
+			void set  (size_t index) noexcept { words[index / bits_per_word].fetch_or ( bit(index), std::memory_order_acq_rel); }
+			void reset(size_t index) noexcept { words[index / bits_per_word].fetch_and(~bit(index), std::memory_order_acq_rel); }
+			bool none() const noexcept { return std::ranges::all_of(words, [](const std::atomic<std::uint64_t>& word) { return word.load(std::memory_order_acquire) == 0; }); }
+
+			/// <returns> The first set bit at or after index, size if there's none. </returns>
+			size_t find_next(size_t index) const noexcept
+				{
+				for (size_t word_index{index / bits_per_word}; word_index < words.size(); word_index++)
+					{
+					std::uint64_t word{words[word_index].load(std::memory_order_acquire)};
+					if (word_index == index / bits_per_word) { word &= ~std::uint64_t{0} << (index % bits_per_word); }
+					if (word) { return word_index * bits_per_word + std::countr_zero(word); }
+					}
+				return size;
+				}
+			/// <returns> The last set bit before index, npos if there's none. </returns>
+			size_t find_previous(size_t index) const noexcept
+				{
+				for (size_t word_index{(index + bits_per_word - 1) / bits_per_word}; word_index-- > 0;)
+					{
+					std::uint64_t word{words[word_index].load(std::memory_order_acquire)};
+					if (word_index == index / bits_per_word) { word &= bit(index) - 1; }
+					if (word) { return word_index * bits_per_word + (bits_per_word - 1 - std::countl_zero(word)); }
+					}
+				return npos;
+				}
+
+			inline static constexpr size_t npos{std::numeric_limits<size_t>::max()};
+
+		private:
+			inline static constexpr size_t bits_per_word{64};
+			static constexpr std::uint64_t bit(size_t index) noexcept { return std::uint64_t{1} << (index % bits_per_word); }
+
+			std::array<std::atomic<std::uint64_t>, (size + bits_per_word - 1) / bits_per_word> words{};
+		};
+
 	template
 		<
 		typename T,
 		size_t segment_size = 8,
 		flags<object_pool_handle_version> HANDLE_VERSION_FLAGS = flags<object_pool_handle_version>::full(),
 		std::unsigned_integral refcount_value_T = uint8_t,
-		typename Allocator = std::allocator<T>
+		typename Allocator = std::allocator<T>,
+		bool THREAD_SAFE = false
 		>
 	class object_pool_details //templated namespace, do not instantiate
 		{
@@ -49,6 +101,7 @@ namespace utils::containers::details
 			inline static constexpr const bool enabled_raw   {handle_version_flags.test(object_pool_handle_version::raw   )};
 			inline static constexpr const bool enabled_unique{handle_version_flags.test(object_pool_handle_version::unique)};
 			inline static constexpr const bool enabled_shared{handle_version_flags.test(object_pool_handle_version::shared)};
+			inline static constexpr const bool thread_safe   {THREAD_SAFE};
 
 			class first_segment_t;
 
@@ -58,8 +111,13 @@ namespace utils::containers::details
 			// raw    handles alone imply complete absence of refcount and unique bitsets
 			// unique handles alone imply complete absence of refcount and unique bitsets (if an element exists, an unique handle to it must exist somewhere in the program)
 			// raw and unique together require unique bitset to keep track of which elements are owned and which aren't
-			inline static constexpr const bool use_refcount      = enabled_shared;
-			inline static constexpr const bool use_unique_bitset = enabled_raw && enabled_unique && !enabled_shared;
+			// Thread safe pools use a refcount array instead of the unique bitset, different threads writing bits of the same word would race.
+			inline static constexpr const bool use_refcount      = enabled_shared || (thread_safe && enabled_raw && enabled_unique);
+			inline static constexpr const bool use_unique_bitset = enabled_raw && enabled_unique && !enabled_shared && !thread_safe;
+
+			using used_bitset_t = std::conditional_t<thread_safe, atomic_bitset<segment_size>, std::bitset<segment_size>>;
+			struct no_skipfield_t {};
+			using skipfield_t   = std::conditional_t<thread_safe, no_skipfield_t, hive::jump_counting_skipfield<segment_size>>;
 
 			using refcount_value_type = std::conditional_t<use_refcount, refcount_value_T, std::conditional_t<use_unique_bitset, typename std::bitset<segment_size>::reference, void>>;
 
@@ -71,6 +129,20 @@ namespace utils::containers::details
 				utils::observer_ptr<segment_t> segment_ptr{nullptr};
 				utils::observer_ptr<slot_t   > slot_ptr   {nullptr};
 				};
+
+			// Single threaded pools keep a free list per segment, and a list of the segments that have free slots.
+			// Compared to a single free list across segments, any segment's free slot can be taken in O(1), which is what compact needs.
+			struct segment_free_list_t
+				{
+				/// <summary> First free slot, its free_slot_handle chains the others. nullptr if the segment is full. </summary>
+				utils::observer_ptr<slot_t   > head{nullptr};
+				utils::observer_ptr<segment_t> prev_with_free{nullptr};
+				utils::observer_ptr<segment_t> next_with_free{nullptr};
+				/// <summary> Increasing along the segments, compact only moves elements to segments with a lower ordinal. </summary>
+				size_t ordinal{0};
+				};
+			struct no_segment_free_list_t {};
+			using segment_free_list_field_t = std::conditional_t<thread_safe, no_segment_free_list_t, segment_free_list_t>;
 			
 			// not a variant, information about which field is active is held in a bitset, achieving better cache friendliness when iterating on densely occupied slots.
 			union slot_t
@@ -111,33 +183,68 @@ namespace utils::containers::details
 			// bitset representing occupied slots
 			// refcount if needed
 			// has the information to manage new/delete on individual slot's element field
+			// Segments after the first one are allocated in contiguous blocks owned by the pool, see growth_policy_t.
+			// Iteration jumps over free slots: with a jump-counting skipfield in single threaded pools, scanning the bitset words in thread safe ones
+			// (a skipfield update touches the neighbouring nodes, so concurrent erases in the same segment would race).
 
 			struct segment_t
 				{
 				segment_t(utils::observer_ptr<segment_t> prev_segment = nullptr) : prev_segment{prev_segment}
 					{
-					for (size_t i = 0; i < segment_size - 1; i++)
-						{
-						arr[i].free_slot_handle = {this, std::addressof(arr[i + 1])};
-						if constexpr (use_refcount || use_unique_bitset) { refcount[i] = 0; }
-						}
-					arr[segment_size - 1].free_slot_handle = {this, nullptr};
+					link_free_slots();
 					}
 				~segment_t() { clear(); }
 				void clear() 
 					{
 					for (size_t i = 0; i < segment_size; i++)
 						{
-						if (used_bitset[i]) { arr[i].element.~T(); }
+						if (used_bitset[i]) 
+							{
+							arr[i].element.~T(); 
+							used_bitset.reset(i);
+							}
 						}
+					if constexpr (!thread_safe) { skipfield.skip_all(); }
+					}
+				bool empty() const noexcept { return used_bitset.none(); }
+
+				/// <returns> The index of the first element at or after index, segment_size if there's none. </returns>
+				size_t next_used(size_t index) const noexcept
+					{
+					if constexpr (thread_safe) { return used_bitset.find_next(index); }
+					else { return skipfield.next_unskipped(index); }
+					}
+				/// <returns> The index of the last element before index, npos if there's none. </returns>
+				size_t previous_used(size_t index) const noexcept
+					{
+					if constexpr (thread_safe) { return used_bitset.find_previous(index); }
+					else { return skipfield.previous_unskipped(index); }
+					}
+				inline static constexpr size_t npos{std::numeric_limits<size_t>::max()};
+
+				/// <summary> Chains all the slots in order as a free list ending with {this, nullptr}. Only valid on a segment without elements. </summary>
+				void link_free_slots() noexcept
+					{
+					for (size_t i = 0; i < segment_size - 1; i++)
+						{
+						arr[i].free_slot_handle = {this, std::addressof(arr[i + 1])};
+						if constexpr (use_refcount || use_unique_bitset) { refcount[i] = 0; }
+						}
+					arr[segment_size - 1].free_slot_handle = {this, nullptr};
+					if constexpr (use_refcount || use_unique_bitset) { refcount[segment_size - 1] = 0; }
+					if constexpr (!thread_safe) { free_list.head = arr.data(); }
 					}
 			
-				std::bitset<segment_size> used_bitset;
+				used_bitset_t used_bitset;
+				segment_free_list_field_t free_list;
 				refcount_t refcount;
+				skipfield_t skipfield;
 			
 				utils::observer_ptr<segment_t> prev_segment{nullptr};
 				std::array<slot_t, segment_size> arr;
-				utils::unique_deepcopy_ptr<segment_t> next_segment{nullptr};
+				utils::observer_ptr<segment_t> next_segment{nullptr};
+				/// <summary> Length of the block if this is the first segment of a block, 0 otherwise. </summary>
+				size_t block_segments{0};
 			
 				template <typename ...Args>
 				inline void emplace(utils::observer_ptr<slot_t> slot_ptr, Args&&... args)
@@ -152,7 +259,8 @@ namespace utils::containers::details
 						}
 			
 					new(std::addressof(slot_ptr->element)) T{std::forward<Args>(args)...}; //may throw
-					used_bitset[bitset_index] = true;
+					used_bitset.set(bitset_index);
+					if constexpr (!thread_safe) { skipfield.unskip(bitset_index); }
 					}
 
 				inline auto& get_refcount(utils::observer_ptr<slot_t> slot_ptr) noexcept
@@ -179,7 +287,8 @@ namespace utils::containers::details
 							}
 						}
 			
-					used_bitset[bitset_index] = false;
+					used_bitset.reset(bitset_index);
+					if constexpr (!thread_safe) { skipfield.skip(bitset_index); }
 					slot_ptr->element.~T();
 					slot_ptr->free_slot_handle = free_slot_handle;
 					return {this, slot_ptr};
@@ -276,6 +385,13 @@ namespace utils::containers::details
 
 					bool operator== (const handle_base& other) const noexcept { return handle_bare::slot_ptr == other.slot_ptr; }
 
+					/// <summary> Points this handle to the new location of its object after first_segment_t::compact moved it. Refcounts are left untouched. </summary>
+					void relocate(const handle_base& new_location) noexcept
+						{
+						handle_bare::segment_ptr = new_location.segment_ptr;
+						handle_bare::slot_ptr    = new_location.slot_ptr;
+						}
+
 				protected:
 					handle_base() = default;
 					handle_base(utils::observer_ptr<segment_t> segment_ptr, utils::observer_ptr<slot_t> slot_ptr) : handle_bare{segment_ptr, slot_ptr} {}
@@ -371,17 +487,179 @@ namespace utils::containers::details
 					inline static constexpr const bool enabled_raw   {object_pool_details::enabled_raw   };
 					inline static constexpr const bool enabled_unique{object_pool_details::enabled_unique};
 					inline static constexpr const bool enabled_shared{object_pool_details::enabled_shared};
+					inline static constexpr const bool thread_safe   {object_pool_details::thread_safe   };
 
-					first_segment_t()
+					first_segment_t() : first_segment_t{Allocator{}} {}
+					/// <summary> Segments after the first one are allocated through the allocator. Thread safe pools allocate from any thread that runs out of free slots, the allocator must be thread safe too. </summary>
+					first_segment_t(const Allocator& allocator) : segment_allocator{allocator}
+						{
+						if constexpr (thread_safe)
+							{
+							concurrent.last_segment = this;
+							concurrent.shared->batches.push_back({{this, this->arr.data()}, segment_size});
+							}
+						else { link_segment_with_free(this); }
+						}
+					first_segment_t(const first_segment_t&) = delete;
+					first_segment_t& operator=(const first_segment_t&) = delete;
+					~first_segment_t()
 						{
-						this->free_slot_handle.segment_ptr = this;
-						this->free_slot_handle.slot_ptr = this->arr.data();
+						if constexpr (thread_safe)
+							{
+							//Threads exiting after this point must not give their cached slots back.
+							std::scoped_lock lock{concurrent.shared->mutex};
+							concurrent.shared->alive = false;
+							}
+						release_segments_after(this);
 						}
 
+					/// <summary> Destroys all the elements and releases all the segments except the first one. Not thread safe, even in thread safe pools. </summary>
 					void clear()
 						{
 						segment_t::clear();
-						segment_t::next_segment.reset();
+						release_segments_after(this);
+						segment_t::link_free_slots();
+						next_block_segments = 1;
+
+						if constexpr (thread_safe)
+							{
+							std::scoped_lock lock{concurrent.shared->mutex};
+							concurrent.last_segment = this;
+							concurrent.shared->epoch++;
+							concurrent.shared->batches.clear();
+							concurrent.shared->batches.push_back({{this, this->arr.data()}, segment_size});
+							}
+						else
+							{
+							segments_with_free = {};
+							link_segment_with_free(this);
+							last_segment_ptr = this;
+							}
+						}
+
+					/// <summary>
+					/// How many segments are allocated together when the pool runs out of free slots. Segments of the same block are contiguous in memory,
+					/// the default doubles the block length on each allocation up to 64 segments.
+					/// </summary>
+					struct growth_policy_t
+						{
+						/// <summary> Each block has this many times the segments of the previous one, 1 allocates blocks of the same length. </summary>
+						size_t factor{2};
+						/// <summary> Upper bound for the segments of a single block, 1 allocates segments one at a time. </summary>
+						size_t max_segments{64};
+						};
+					/// <summary> Not thread safe, even in thread safe pools. </summary>
+					void set_growth_policy(const growth_policy_t& policy) noexcept
+						{
+						assert(policy.factor > 0 && policy.max_segments > 0);
+						growth_policy = policy;
+						}
+					const growth_policy_t& get_growth_policy() const noexcept { return growth_policy; }
+
+					/// <summary> Amount of slots, used or not. </summary>
+					size_t capacity() const noexcept { return segments_count * segment_size; }
+
+					/// <summary>
+					/// Makes sure the pool has at least new_capacity slots, the missing ones are allocated in a single block of contiguous segments regardless of the growth policy.
+					/// Can be called concurrently with emplace and erase in thread safe pools.
+					/// </summary>
+					void reserve(size_t new_capacity)
+						{
+						const size_t current_capacity{capacity()};
+						if (new_capacity <= current_capacity) { return; }
+
+						const size_t count{(new_capacity - current_capacity + segment_size - 1) / segment_size};
+						const utils::observer_ptr<segment_t> block{append_block(count)};
+
+						if constexpr (thread_safe)
+							{
+							const std::vector<free_chain_t> batches{split_in_batches(block, count)};
+							std::scoped_lock lock{concurrent.shared->mutex};
+							concurrent.shared->batches.insert(concurrent.shared->batches.end(), batches.rbegin(), batches.rend());
+							}
+						}
+
+					/// <summary>
+					/// Releases the trailing blocks whose segments are all empty. If any was released, free slots are relinked in iteration order so the next emplaces fill the earliest holes first.
+					/// Not thread safe, even in thread safe pools.
+					/// </summary>
+					void shrink_to_fit()
+						{
+						utils::observer_ptr<segment_t> last_kept{this};
+						for (utils::observer_ptr<segment_t> block{segment_t::next_segment}; block; )
+							{
+							const utils::observer_ptr<segment_t> block_last{block + (block->block_segments - 1)};
+							if (!std::all_of(block, block_last + 1, [](const segment_t& segment) { return segment.empty(); })) { last_kept = block_last; }
+							block = block_last->next_segment;
+							}
+						if (!last_kept->next_segment) { return; }
+
+						release_segments_after(last_kept);
+						if constexpr (thread_safe) { concurrent.last_segment.store(last_kept, std::memory_order_release); }
+						else { last_segment_ptr = last_kept; }
+						relink_free_slots();
+						}
+
+					/// <summary>
+					/// Incremental defragmentation: moves up to budget elements from the last segments to free slots of earlier ones, releasing trailing blocks that end up empty.
+					/// After each move relocated(from, to) is called, to refers to the element's new location, from to its old one which no longer holds an element and is only meaningful for comparisons.
+					/// Every handle equal to from must be pointed to the new location before the next move, owning handles included, through handle relocate.
+					/// Besides the moves, a call may walk over the empty segments of a partially released block. Not available in thread safe pools.
+					/// </summary>
+					/// <returns> False once there's nothing left to compact: every segment before the one holding the last element is full. </returns>
+					template <typename callback_t>
+					bool compact(size_t budget, callback_t&& relocated)
+						requires(!thread_safe)
+						{
+						for (; budget > 0; budget--)
+							{
+							if (release_last_block_if_empty()) { continue; }
+
+							utils::observer_ptr<segment_t> source_segment{last_segment_ptr};
+							size_t source_index;
+							while ((source_index = source_segment->previous_used(segment_size)) == segment_t::npos)
+								{
+								if (source_segment == this) { return false; }
+								source_segment = source_segment->prev_segment;
+								}
+
+							//Segments with free slots after the source are all empty, move them to the back so emplace and the next moves prefer earlier ones.
+							utils::observer_ptr<segment_t> destination{segments_with_free.head};
+							for (size_t rotated{0}; destination && destination->free_list.ordinal >= source_segment->free_list.ordinal; rotated++)
+								{
+								if (rotated == segments_with_free.count) { return false; }
+								unlink_segment_with_free(destination);
+								link_segment_with_free(destination, true);
+								destination = segments_with_free.head;
+								}
+							if (!destination) { return false; }
+
+							const utils::observer_ptr<slot_t> from{source_segment->arr.data() + source_index};
+							const utils::observer_ptr<slot_t> to  {destination->free_list.head};
+							const utils::observer_ptr<slot_t> next_free{to->free_slot_handle.slot_ptr};
+							try
+								{
+								destination->emplace(to, std::move(from->element));
+								}
+							catch (...)
+								{
+								to->free_slot_handle = {destination, next_free};
+								throw;
+								}
+							destination->free_list.head = next_free;
+							if (!next_free) { unlink_segment_with_free(destination); }
+
+							if constexpr (use_refcount || use_unique_bitset)
+								{
+								destination->get_refcount(to) = source_segment->get_refcount(from);
+								source_segment->get_refcount(from) = 0;
+								}
+
+							handle_bare moved_from{source_segment, from};
+							erase(moved_from);
+							relocated(handle_raw{this, handle_base{source_segment, from}}, handle_raw{this, handle_base{destination, to}});
+							}
+						return true;
 						}
 
 					/// <summary>
@@ -790,24 +1068,7 @@ namespace utils::containers::details
 					
 							iterator& operator++() noexcept
 								{
-								auto current_segment_end{handle_bare::segment_ptr->arr.data() + segment_size};
-								while (true)
-									{
-									handle_bare::slot_ptr++;
-
-									if (handle_bare::slot_ptr == current_segment_end)
-										{
-										if (handle_bare::segment_ptr->next_segment)
-											{
-											handle_bare::segment_ptr = handle_bare::segment_ptr->next_segment.get();
-											handle_bare::slot_ptr    = handle_bare::segment_ptr->arr.data();
-											current_segment_end = handle_bare::segment_ptr->arr.data() + segment_size;
-											}
-										else { break; }
-										}
-									if (handle_base::has_value()) { break; }
-									}
-					
+								seek_forward(handle_base::index_in_segment() + 1);
 								return *this;
 								}
 					
@@ -815,20 +1076,17 @@ namespace utils::containers::details
 					
 							iterator& operator--() noexcept
 								{
-								do
+								size_t index{handle_base::index_in_segment()};
+								while ((index = handle_bare::segment_ptr->previous_used(index)) == segment_t::npos)
 									{
-									handle_bare::slot_ptr--;
-									if (handle_bare::slot_ptr == (handle_bare::segment_ptr->arr.data() - 1))
+									if constexpr (utils::compilation::debug)
 										{
-										if constexpr (utils::compilation::debug)
-											{
-											if (!handle_bare::segment_ptr->prev_segment) { throw std::out_of_range{"Trying to access previous segment from the first segment."}; }
-											}
-										handle_bare::segment_ptr = handle_bare::segment_ptr->prev_segment;
-										handle_bare::slot_ptr = handle_bare::segment_ptr->arr.data() + (segment_size - 1);
+										if (!handle_bare::segment_ptr->prev_segment) { throw std::out_of_range{"Trying to access previous segment from the first segment."}; }
 										}
-									} while (!handle_base::has_value());
-					
+									handle_bare::segment_ptr = handle_bare::segment_ptr->prev_segment;
+									index = segment_size;
+									}
+								handle_bare::slot_ptr = handle_bare::segment_ptr->arr.data() + index;
 								return *this;
 								}
 
@@ -839,19 +1097,15 @@ namespace utils::containers::details
 						protected:
 							iterator(utils::observer_ptr<segment_t> segment_ptr, utils::observer_ptr<slot_t> slot_ptr) : handle_base{segment_ptr, slot_ptr} {}
 					
-							/// <returns> True if end of segment was reached. </returns>
-							bool advance_until_value_or_end_of_segment()
+							/// <summary> Moves to the first element at or after index in the current segment or the following ones, or to the end of the last segment if there's none. </summary>
+							void seek_forward(size_t index) noexcept
 								{
-								do
+								while ((index = handle_bare::segment_ptr->next_used(index)) == segment_size && handle_bare::segment_ptr->next_segment)
 									{
-									handle_bare::slot_ptr++;
-									if (handle_base::slot_ptr == (handle_bare::segment_ptr->arr.data() + segment_size))
-										{
-										return true;
-										}
-									} 
-								while (!handle_base::has_value());
-								return false;
+									handle_bare::segment_ptr = handle_bare::segment_ptr->next_segment;
+									index = 0;
+									}
+								handle_bare::slot_ptr = handle_bare::segment_ptr->arr.data() + index;
 								}
 						};
 
@@ -897,48 +1151,400 @@ namespace utils::containers::details
 					iterator begin()
 						{
 						iterator ret{this, segment_t::arr.data()};
-						if (!ret.has_value())
+						ret.seek_forward(0);
+						return ret;
+						}
+					
+					iterator end() 
+						{
+						const utils::observer_ptr<segment_t> last_segment{get_last_segment()};
+						return {last_segment, last_segment->arr.data() + segment_size}; 
+						}
+			
+				private:
+					utils::observer_ptr<segment_t> last_segment_ptr{this};
+
+					struct segments_with_free_t
+						{
+						utils::observer_ptr<segment_t> head{nullptr};
+						utils::observer_ptr<segment_t> tail{nullptr};
+						size_t count{0};
+						};
+					segments_with_free_t segments_with_free;
+
+					void link_segment_with_free(utils::observer_ptr<segment_t> segment, bool at_back = false) noexcept
+						requires(!thread_safe)
+						{
+						auto& node{segment->free_list};
+						if (at_back)
 							{
-							while (ret.advance_until_value_or_end_of_segment() && ret.segment_ptr->next_segment)
+							node.prev_with_free = segments_with_free.tail;
+							node.next_with_free = nullptr;
+							if (segments_with_free.tail) { segments_with_free.tail->free_list.next_with_free = segment; }
+							else { segments_with_free.head = segment; }
+							segments_with_free.tail = segment;
+							}
+						else
+							{
+							node.prev_with_free = nullptr;
+							node.next_with_free = segments_with_free.head;
+							if (segments_with_free.head) { segments_with_free.head->free_list.prev_with_free = segment; }
+							else { segments_with_free.tail = segment; }
+							segments_with_free.head = segment;
+							}
+						segments_with_free.count++;
+						}
+					void unlink_segment_with_free(utils::observer_ptr<segment_t> segment) noexcept
+						requires(!thread_safe)
+						{
+						auto& node{segment->free_list};
+						if (node.prev_with_free) { node.prev_with_free->free_list.next_with_free = node.next_with_free; }
+						else { segments_with_free.head = node.next_with_free; }
+						if (node.next_with_free) { node.next_with_free->free_list.prev_with_free = node.prev_with_free; }
+						else { segments_with_free.tail = node.prev_with_free; }
+						node.prev_with_free = node.next_with_free = nullptr;
+						segments_with_free.count--;
+						}
+
+					/// <summary> Releases the last block if none of its segments has elements. The first segment is never released. </summary>
+					bool release_last_block_if_empty() noexcept
+						requires(!thread_safe)
+						{
+						if (last_segment_ptr == this) { return false; }
+						utils::observer_ptr<segment_t> block{last_segment_ptr};
+						while (block->block_segments == 0) { block = block->prev_segment; }
+						if (!std::all_of(block, last_segment_ptr + 1, [](const segment_t& segment) { return segment.empty(); })) { return false; }
+
+						last_segment_ptr = block->prev_segment;
+						release_segments_after(last_segment_ptr);
+						return true;
+						}
+
+#pragma region segment blocks
+					using counter_t = std::conditional_t<thread_safe, std::atomic<size_t>, size_t>;
+
+					growth_policy_t growth_policy;
+					using segment_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_t>;
+
+					counter_t next_block_segments{1};
+					counter_t segments_count{1};
+					segment_allocator_t segment_allocator;
+
+					size_t take_next_block_segments() noexcept
+						{
+						//Concurrent refills may read the same value and allocate two blocks of the same length, which is harmless.
+						const size_t ret{std::min<size_t>(next_block_segments, growth_policy.max_segments)};
+						next_block_segments = std::min<size_t>(ret * growth_policy.factor, growth_policy.max_segments);
+						return ret;
+						}
+
+					/// <summary>
+					/// Allocates count contiguous segments after the last one. In thread safe pools their slots are chained in order as a single free list ending with a null slot,
+					/// otherwise the segments are added in order at the front of the segments with free slots.
+					/// </summary>
+					utils::observer_ptr<segment_t> append_block(size_t count)
+						{
+						const utils::observer_ptr<segment_t> block{std::allocator_traits<segment_allocator_t>::allocate(segment_allocator, count)};
+						for (size_t i{0}; i < count; i++) { std::allocator_traits<segment_allocator_t>::construct(segment_allocator, block + i); }
+						block->block_segments = count;
+						for (size_t i{1}; i < count; i++)
+							{
+							block[i    ].prev_segment = block + (i - 1);
+							block[i - 1].next_segment = block + i;
+							if constexpr (thread_safe) { block[i - 1].arr[segment_size - 1].free_slot_handle = {block + i, block[i].arr.data()}; }
+							}
+
+						if constexpr (thread_safe)
+							{
+							//Lock-free append: whoever wins the swap of the last segment is the only one that will write the previous last segment's next_segment.
+							utils::observer_ptr<segment_t> previous_last{concurrent.last_segment.load(std::memory_order_acquire)};
+							do { block->prev_segment = previous_last; }
+							while (!concurrent.last_segment.compare_exchange_weak(previous_last, block + (count - 1), std::memory_order_acq_rel, std::memory_order_acquire));
+							previous_last->next_segment = block;
+							}
+						else
+							{
+							block->prev_segment = last_segment_ptr;
+							last_segment_ptr->next_segment = block;
+							for (size_t i{count}; i-- > 0;)
+								{
+								block[i].free_list.ordinal = last_segment_ptr->free_list.ordinal + 1 + i;
+								link_segment_with_free(block + i);
+								}
+							last_segment_ptr = block + (count - 1);
+							}
+						segments_count += count;
+						return block;
+						}
+
+					/// <summary> Destroys the elements of the segments after last_kept and releases their blocks. last_kept must be the last segment of its block. </summary>
+					void release_segments_after(utils::observer_ptr<segment_t> last_kept) noexcept
+						{
+						utils::observer_ptr<segment_t> block{last_kept->next_segment};
+						last_kept->next_segment = nullptr;
+						while (block)
+							{
+							const size_t count{block->block_segments};
+							const utils::observer_ptr<segment_t> next_block{block[count - 1].next_segment};
+							if constexpr (!thread_safe)
+								{
+								for (size_t i{0}; i < count; i++) { if (block[i].free_list.head) { unlink_segment_with_free(block + i); } }
+								}
+							for (size_t i{0}; i < count; i++) { std::allocator_traits<segment_allocator_t>::destroy(segment_allocator, block + i); }
+							std::allocator_traits<segment_allocator_t>::deallocate(segment_allocator, block, count);
+							segments_count -= count;
+							block = next_block;
+							}
+						}
+
+					/// <summary> Rebuilds the free lists from the used bitsets, in iteration order. Thread safe pools also discard every thread's cache. </summary>
+					void relink_free_slots()
+						{
+						if constexpr (thread_safe)
+							{
+							std::vector<free_chain_t> chains;
+							free_chain_t current;
+							utils::observer_ptr<handle_bare> tail{std::addressof(current.head)};
+
+							for (utils::observer_ptr<segment_t> segment{this}; segment; segment = segment->next_segment)
+								{
+								for (size_t i{0}; i < segment_size; i++)
+									{
+									if (segment->used_bitset[i]) { continue; }
+									if (current.count == thread_cache_batch_size)
+										{
+										*tail = {nullptr, nullptr};
+										chains.push_back(current);
+										current = {};
+										tail = std::addressof(current.head);
+										}
+									*tail = {segment, std::addressof(segment->arr[i])};
+									tail  = std::addressof(segment->arr[i].free_slot_handle);
+									current.count++;
+									}
+								}
+							*tail = {nullptr, nullptr};
+							if (current.count > 0) { chains.push_back(current); }
+
+							std::scoped_lock lock{concurrent.shared->mutex};
+							concurrent.shared->epoch++;
+							//Batches are popped from the back, the earliest slots go first.
+							concurrent.shared->batches.assign(chains.rbegin(), chains.rend());
+							}
+						else
+							{
+							segments_with_free = {};
+							for (utils::observer_ptr<segment_t> segment{this}; segment; segment = segment->next_segment)
+								{
+								utils::observer_ptr<slot_t> head{nullptr};
+								for (size_t i{segment_size}; i-- > 0;)
+									{
+									if (segment->used_bitset[i]) { continue; }
+									segment->arr[i].free_slot_handle = {segment, head};
+									head = std::addressof(segment->arr[i]);
+									}
+								segment->free_list.head = head;
+								if (head) { link_segment_with_free(segment, true); }
+								}
+							}
+						}
+#pragma endregion segment blocks
+
+#pragma region thread safety
+					// Thread safe pools don't use the segments' free lists nor last_segment_ptr.
+					// Each thread pops and pushes free slots on its own cache, without synchronization. Caches exchange whole batches of free slots with a shared list under a mutex,
+					// which happens once every thread_cache_batch_size operations at most. When no batch is available a new segment is appended with a compare and swap on the last segment.
+					// Same scheme as the async_logger's thread rings: caches are thread_local and found through the pool's id, a new pool may be constructed where a destroyed one used to be.
+
+					inline static constexpr size_t thread_cache_batch_size{std::max<size_t>(segment_size, 64)};
+
+					struct free_chain_t
+						{
+						handle_bare head{nullptr, nullptr};
+						size_t count{0};
+						};
+
+					struct concurrent_shared_t
+						{
+						std::mutex mutex;
+						std::vector<free_chain_t> batches;
+						/// <summary> Incremented by clear, caches from a previous epoch point to released segments. </summary>
+						std::atomic<size_t> epoch{0};
+						std::atomic_bool alive{true};
+						};
+
+					struct thread_cache_t
+						{
+						std::shared_ptr<concurrent_shared_t> shared;
+						size_t epoch{0};
+						free_chain_t chain;
+
+						~thread_cache_t()
+							{
+							//The thread is exiting, give the cached slots back to the pool if it still exists.
+							if (chain.count == 0) { return; }
+							std::scoped_lock lock{shared->mutex};
+							if (shared->alive && epoch == shared->epoch) { shared->batches.push_back(chain); }
+							}
+						};
+
+					struct thread_cache_entry_t
+						{
+						std::uint64_t pool_id;
+						std::unique_ptr<thread_cache_t> cache;
+						};
+					inline static thread_local std::vector<thread_cache_entry_t> thread_caches;
+					inline static std::atomic<std::uint64_t> next_pool_id{0};
+
+					struct concurrent_state_t
+						{
+						const std::uint64_t id{next_pool_id++};
+						std::shared_ptr<concurrent_shared_t> shared{std::make_shared<concurrent_shared_t>()};
+						std::atomic<utils::observer_ptr<segment_t>> last_segment;
+						};
+					struct no_concurrent_state_t {};
+
+					std::conditional_t<thread_safe, concurrent_state_t, no_concurrent_state_t> concurrent;
+
+					thread_cache_t& local_cache()
+						requires(thread_safe)
+						{
+						for (auto& entry : thread_caches)
+							{
+							if (entry.pool_id == concurrent.id)
+								{
+								thread_cache_t& cache{*entry.cache};
+								if (cache.epoch != concurrent.shared->epoch)
+									{
+									cache.chain = {};
+									cache.epoch = concurrent.shared->epoch;
+									}
+								return cache;
+								}
+							}
+
+						// First operation on this pool from this thread. Drop the caches of pools that don't exist anymore while we're at it.
+						std::erase_if(thread_caches, [](const thread_cache_entry_t& entry) { return !entry.cache->shared->alive; });
+						thread_caches.push_back({concurrent.id, std::make_unique<thread_cache_t>(concurrent.shared, concurrent.shared->epoch.load())});
+						return *thread_caches.back().cache;
+						}
+
+					void refill(thread_cache_t& cache)
+						requires(thread_safe)
+						{
+						if (true)
+							{
+							std::scoped_lock lock{concurrent.shared->mutex};
+							if (!concurrent.shared->batches.empty())
 								{
-								ret.segment_ptr = ret.segment_ptr->next_segment.get();
+								cache.chain = concurrent.shared->batches.back();
+								concurrent.shared->batches.pop_back();
+								return;
 								}
 							}
+
+						const size_t count{take_next_block_segments()};
+						const std::vector<free_chain_t> batches{split_in_batches(append_block(count), count)};
+						cache.chain = batches.front();
+						if (batches.size() > 1)
+							{
+							std::scoped_lock lock{concurrent.shared->mutex};
+							concurrent.shared->batches.insert(concurrent.shared->batches.end(), batches.rbegin(), batches.rend() - 1);
+							}
+						}
+
+					/// <summary> Cuts the free list of a new block in batches of at most thread_cache_batch_size slots. </summary>
+					static std::vector<free_chain_t> split_in_batches(utils::observer_ptr<segment_t> block, size_t count)
+						requires(thread_safe)
+						{
+						constexpr size_t segments_per_batch{thread_cache_batch_size / segment_size};
+						std::vector<free_chain_t> ret;
+						ret.reserve((count + segments_per_batch - 1) / segments_per_batch);
+						for (size_t first{0}; first < count; first += segments_per_batch)
+							{
+							const size_t last{std::min(first + segments_per_batch, count)};
+							block[last - 1].arr[segment_size - 1].free_slot_handle = {nullptr, nullptr};
+							ret.push_back({{block + first, block[first].arr.data()}, (last - first) * segment_size});
+							}
 						return ret;
 						}
-					
-					iterator end() { return {last_segment_ptr, last_segment_ptr->arr.data() + segment_size}; }
-			
-				private:
-					handle_bare free_slot_handle;
-					utils::observer_ptr<segment_t> last_segment_ptr{this}; //TODO check if this is always == to free_slot_handle.segment_ptr
+
+					/// <summary> Moves the oldest thread_cache_batch_size slots of the cache to the shared list. </summary>
+					void give_back_batch(thread_cache_t& cache)
+						requires(thread_safe)
+						{
+						const free_chain_t batch{cache.chain.head, thread_cache_batch_size};
+
+						utils::observer_ptr<slot_t> last_in_batch{cache.chain.head.slot_ptr};
+						for (size_t i{1}; i < thread_cache_batch_size; i++) { last_in_batch = last_in_batch->free_slot_handle.slot_ptr; }
+						cache.chain.head   = last_in_batch->free_slot_handle;
+						cache.chain.count -= thread_cache_batch_size;
+						last_in_batch->free_slot_handle = {nullptr, nullptr};
+
+						std::scoped_lock lock{concurrent.shared->mutex};
+						concurrent.shared->batches.push_back(batch);
+						}
+#pragma endregion thread safety
+
+					utils::observer_ptr<segment_t> get_last_segment() const noexcept
+						{
+						if constexpr (thread_safe) { return concurrent.last_segment.load(std::memory_order_acquire); }
+						else { return last_segment_ptr; }
+						}
 
 					template <typename ...Args>
 					inline handle_raw emplace_inner(Args&&... args)
 						{
-						if (free_slot_handle.slot_ptr == nullptr)
+						if constexpr (thread_safe)
 							{
-							free_slot_handle.segment_ptr->next_segment = std::make_unique<segment_t>(free_slot_handle.segment_ptr);
-							
-							last_segment_ptr = free_slot_handle.segment_ptr->next_segment.get();
-							free_slot_handle = {last_segment_ptr, last_segment_ptr->arr.data()};
+							thread_cache_t& cache{local_cache()};
+							if (cache.chain.count == 0) { refill(cache); }
+
+							const handle_bare slot{cache.chain.head};
+							const handle_bare next_free_slot{slot.slot_ptr->free_slot_handle};
+
+							slot.segment_ptr->emplace(slot.slot_ptr, std::forward<Args>(args)...);
+
+							cache.chain.head = next_free_slot;
+							cache.chain.count--;
+
+							handle_base base{handle_base{slot.segment_ptr, slot.slot_ptr}};
+							return handle_raw{this, base};
 							}
-			
-						auto next_free_slot_it{free_slot_handle.slot_ptr->free_slot_handle};
-			
-						free_slot_handle.segment_ptr->emplace(free_slot_handle.slot_ptr, std::forward<Args>(args)...);
+						else
+							{
+							if (!segments_with_free.head) { append_block(take_next_block_segments()); }
 
-						handle_base base{handle_base{free_slot_handle.segment_ptr, free_slot_handle.slot_ptr}};
-						handle_raw ret{this, base};
-			
-						free_slot_handle = next_free_slot_it;
-			
-						return ret;
+							const utils::observer_ptr<segment_t> segment{segments_with_free.head};
+							const utils::observer_ptr<slot_t   > slot   {segment->free_list.head};
+							const utils::observer_ptr<slot_t   > next_free_slot{slot->free_slot_handle.slot_ptr};
+
+							segment->emplace(slot, std::forward<Args>(args)...);
+
+							segment->free_list.head = next_free_slot;
+							if (!next_free_slot) { unlink_segment_with_free(segment); }
+
+							handle_base base{handle_base{segment, slot}};
+							return handle_raw{this, base};
+							}
 						}
 			
 					inline void erase(handle_bare& handle_bare)
 						{
-						free_slot_handle = handle_bare.segment_ptr->erase(handle_bare.slot_ptr, free_slot_handle);
+						if constexpr (thread_safe)
+							{
+							thread_cache_t& cache{local_cache()};
+							cache.chain.head = handle_bare.segment_ptr->erase(handle_bare.slot_ptr, cache.chain.head);
+							cache.chain.count++;
+							if (cache.chain.count >= thread_cache_batch_size * 2) { give_back_batch(cache); }
+							}
+						else
+							{
+							segment_t& segment{*handle_bare.segment_ptr};
+							const bool was_full{!segment.free_list.head};
+							segment.free_list.head = segment.erase(handle_bare.slot_ptr, {std::addressof(segment), segment.free_list.head}).slot_ptr;
+							if (was_full) { link_segment_with_free(std::addressof(segment)); }
+							}
 						}
 			
 				};
@@ -957,7 +1563,8 @@ namespace utils::containers
 	/// <param name="T"> The type contained by the object pool</param>
 	/// <param name="Allocator"></param>
 	/// <param name="segment_size">
-	///		The size of sequential storage clusters for the type T. The first cluster is statically allocated.
+	///		The size of sequential storage clusters for the type T. The first cluster is statically allocated, the following ones are allocated in contiguous blocks of clusters
+	///		whose length is controlled by set_growth_policy. reserve allocates a block of the exact length needed, shrink_to_fit releases trailing blocks without elements.
 	/// </param>
 	/// <param name="refcount_value_T"> 
 	///		The type used for refcounts if shared handles are enabled. 
@@ -965,6 +1572,26 @@ namespace utils::containers
 	///		The last value is reserved as special value for unique handles if unique handles are enabled.
 	/// </param>
 	/// <param name="handle_version_flags"></param>
+	/// <param name="thread_safe">
+	///		Allows emplacing and erasing from multiple threads concurrently, see concurrent_object_pool.
+	/// </param>
+	template
+		<
+		typename T,
+		size_t segment_size = 8,
+		flags<object_pool_handle_version> handle_version_flags = flags<object_pool_handle_version>::full(),
+		std::unsigned_integral refcount_value_T = uint8_t,
+		typename Allocator = std::allocator<T>,
+		bool thread_safe = false
+		>
+	using object_pool = details::object_pool_details<T, segment_size, handle_version_flags, refcount_value_T, Allocator, thread_safe>::first_segment_t;
+
+	/// <summary>
+	///		An object_pool whose emplace and erase (including erasing through handles) can be called from multiple threads concurrently, with the same handle types.
+	///		Every thread keeps its own cache of free slots and only synchronizes to exchange batches of them with the pool or to append a new segment, which is lock-free.
+	///		Slots freed by a thread are reused by that same thread first.
+	///		Iteration and clear are not thread safe. Refcounts aren't atomic: copying or destroying shared handles to the same object from different threads needs external synchronization.
+	/// </summary>
 	template
 		<
 		typename T,
@@ -973,5 +1600,5 @@ namespace utils::containers
 		std::unsigned_integral refcount_value_T = uint8_t,
 		typename Allocator = std::allocator<T>
 		>
-	using object_pool = details::object_pool_details<T, segment_size, handle_version_flags, refcount_value_T, Allocator>::first_segment_t;
+	using concurrent_object_pool = object_pool<T, segment_size, handle_version_flags, refcount_value_T, Allocator, true>;
 	}
\ No newline at end of file
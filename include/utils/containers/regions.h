@@ -1,8 +1,11 @@
 #pragma once
 
+#include <span>
+#include <queue>
 #include <tuple>
 #include <vector>
 #include <ranges>
+#include <utility>
 #include <limits>
 #include <cassert>
 #include <algorithm>
@@ -51,6 +54,7 @@ namespace utils::containers
 	/// Container that represent a distribution of values along a 1d range of values with pseudo-indices from 0 to std::numeric_limits<size_t>::max().
 	/// Adding the same value in subsequent regions merges them in one region (add value X to 1-3, then add X to 4-8, will make a single region with value X in positions 1-8).
 	/// Adding the a different value in a sequential region will split that region (add X to 1-9, then add Y to 5-6, will split everything into: X 1-4, Y 5-6, X 7-9).
+	/// Point lookups are O(log n) in the number of slots, but add shifts the contiguous slots storage. For many updates on large distributions see regions_map.
 	///</summary>
 	template <typename T>
 	class regions
@@ -78,18 +82,64 @@ namespace utils::containers
 
 			inner_slots_t inner_slots;
 
+			/// <summary> Binary search over the slots' ends, which are sorted. Returns the index of the first slot with end > index. </summary>
 			size_t element_index_to_slot_index(const size_t& index, const size_t& inner_slots_starting_index = 0) const noexcept
 				{
-				for (size_t index_in_slots{inner_slots_starting_index}; index_in_slots < inner_slots.size(); index_in_slots++)
+				assert(inner_slots_starting_index <= inner_slots.size());
+				const auto it{std::upper_bound(inner_slots.begin() + inner_slots_starting_index, inner_slots.end(), index, [](const size_t& index, const inner_slot_t& inner_slot)
 					{
-					const inner_slot_t& inner_slot{inner_slots[index_in_slots]};
-					if (inner_slot.end > index) 
+					return index < inner_slot.end;
+					})};
+				return static_cast<size_t>(it - inner_slots.begin());
+				}
+
+			struct painted_region_t
+				{
+				size_t begin;
+				size_t end;
+				size_t update_index;
+				};
+
+			/// <summary> Sweeps the updates' boundaries keeping the latest update covering each elementary interval, returns sorted disjoint regions. </summary>
+			static std::vector<painted_region_t> resolve_updates(std::span<const std::pair<value_type, region>> updates)
+				{
+				std::vector<size_t> by_begin; by_begin.reserve(updates.size());
+				std::vector<size_t> boundaries; boundaries.reserve(updates.size() * 2);
+				for (size_t i{0}; i < updates.size(); i++)
+					{
+					const region& update_region{updates[i].second};
+					assert(update_region.begin != std::numeric_limits<size_t>::max());
+					if (update_region.empty()) { continue; }
+					by_begin.emplace_back(i);
+					boundaries.emplace_back(update_region.begin);
+					boundaries.emplace_back(update_region.end());
+					}
+				std::ranges::sort(by_begin, {}, [&updates](size_t i) { return updates[i].second.begin; });
+				std::ranges::sort(boundaries);
+				const auto duplicates{std::ranges::unique(boundaries)};
+				boundaries.erase(duplicates.begin(), duplicates.end());
+
+				std::vector<painted_region_t> ret;
+				std::priority_queue<size_t> active;
+				auto next_to_activate{by_begin.begin()};
+				for (size_t i{0}; i + 1 < boundaries.size(); i++)
+					{
+					const size_t begin{boundaries[i    ]};
+					const size_t end  {boundaries[i + 1]};
+					for (; next_to_activate != by_begin.end() && updates[*next_to_activate].second.begin <= begin; ++next_to_activate)
 						{
-						return index_in_slots;
+						active.push(*next_to_activate);
 						}
+					while (!active.empty() && updates[active.top()].second.end() <= begin) { active.pop(); }
+					if (active.empty()) { continue; }
+
+					const size_t update_index{active.top()};
+					if (!ret.empty() && ret.back().end == begin && ret.back().update_index == update_index) { ret.back().end = end; }
+					else { ret.emplace_back(painted_region_t{.begin{begin}, .end{end}, .update_index{update_index}}); }
 					}
-				return inner_slots.size();
+				return ret;
 				}
+
 			const inner_slot_t& inner_slot_for_value_at(const size_t& index) const noexcept { return inner_slots[element_index_to_slot_index(index)]; }
 			/***/ inner_slot_t& inner_slot_for_value_at(const size_t& index) /***/ noexcept { return inner_slots[element_index_to_slot_index(index)]; }
 
@@ -530,6 +580,53 @@ namespace utils::containers
 				{
 				return unsafe_slots_index_view().at(index);
 				}
+
+			/// <summary> Whole slots overlapping a region, they're not clipped to it. </summary>
+			class query_view_t
+				{
+				public:
+					/// <summary> Slot index of the first overlapping slot, for use with slot_index_view. </summary>
+					size_t first_slot_index() const noexcept { return _first_slot_index; }
+
+					size_t size() const noexcept { return _end_slot_index - _first_slot_index; }
+					bool empty() const noexcept { return size() == 0; }
+
+					forward_iterator<true> begin() const noexcept
+						{
+						const size_t region_begin{_first_slot_index == 0 ? static_cast<size_t>(0) : _regions.inner_slots[_first_slot_index - 1].end};
+						return {region_begin, _regions.inner_slots.begin() + _first_slot_index};
+						}
+					forward_iterator<true> end() const noexcept
+						{
+						const size_t region_begin{_end_slot_index == 0 ? static_cast<size_t>(0) : _regions.inner_slots[_end_slot_index - 1].end};
+						return {region_begin, _regions.inner_slots.begin() + _end_slot_index};
+						}
+
+				private:
+					friend class regions;
+					query_view_t(size_t first_slot_index, size_t end_slot_index, const regions<value_type>& regions) :
+						_first_slot_index{first_slot_index},
+						_end_slot_index  {end_slot_index  },
+						_regions         {regions         }
+						{
+						}
+
+					size_t _first_slot_index;
+					size_t _end_slot_index;
+					const regions<value_type>& _regions;
+				};
+			/// <summary> Slots overlapping in_region, found with two binary searches instead of walking from the first slot. </summary>
+			query_view_t query(const region& in_region) const noexcept
+				{
+				if (in_region.empty()) 
+					{
+					const size_t slot_index{element_index_to_slot_index(in_region.begin)};
+					return {slot_index, slot_index, *this};
+					}
+				const size_t first_slot_index{element_index_to_slot_index(in_region.begin)};
+				const size_t end_slot_index  {element_index_to_slot_index(in_region.end() - 1, first_slot_index) + 1};
+				return {first_slot_index, end_slot_index, *this};
+				}
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////// Views end ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -552,8 +649,9 @@ namespace utils::containers
 				std::vector<value_type> ret; ret.reserve(inner_slots.size());
 				for (const inner_slot_t& inner_slot : inner_slots)
 					{
-					ret.emplace(inner_slot.value);
+					ret.emplace_back(inner_slot.value);
 					}
+				return ret;
 				}
 
 			value_type last_value() const noexcept { return inner_slots.rbegin()->value; }
@@ -561,7 +659,7 @@ namespace utils::containers
 			void add(const value_type& new_value, const region& in_region)
 				{
 				assert(in_region.begin != std::numeric_limits<size_t>::max());
-
+				if (in_region.empty()) { return; }
 
 				const std::optional<size_t> index_of_slot_starting_before_begin_opt{in_region.begin > 0 ? std::optional<size_t>{element_index_to_slot_index(in_region.begin - 1)} : std::optional<size_t>{std::nullopt}};
 
@@ -599,6 +697,14 @@ namespace utils::containers
 							if (slot_starting_before_begin.value != new_value)
 								{
 								slot_starting_before_begin.end = in_region.begin;
+
+								//If the next slot has the same value it absorbs the new region.
+								const size_t index_of_next_slot{index_of_slot_starting_before_begin + 1};
+								if (index_of_next_slot < inner_slots.size() && inner_slots[index_of_next_slot].value == new_value)
+									{
+									return;
+									}
+
 								const inner_slot_t new_slot
 									{
 									.value{new_value},
@@ -696,6 +802,48 @@ namespace utils::containers
 					}
 				}
 
+			/// <summary>
+			/// Same result as calling add for each update in order, later updates win where they overlap.
+			/// The updates are resolved into disjoint regions first (O(k log k)), then merged with the existing slots in a single pass (O(n + k)).
+			/// </summary>
+			void add_batch(std::span<const std::pair<value_type, region>> updates)
+				{
+				if (updates.empty()) { return; }
+				if (updates.size() == 1) { add(updates[0].first, updates[0].second); return; }
+
+				const std::vector<painted_region_t> painted{resolve_updates(updates)};
+
+				inner_slots_t merged; merged.reserve(inner_slots.size() + (painted.size() * 2));
+				const auto emit{[&merged](const value_type& value, size_t end)
+					{
+					if (!merged.empty() && merged.back().value == value) { merged.back().end = end; }
+					else { merged.emplace_back(inner_slot_t{.value{value}, .end{end}}); }
+					}};
+
+				size_t slot_index{0};
+				for (const painted_region_t& painted_region : painted)
+					{
+					while (inner_slots[slot_index].end <= painted_region.begin)
+						{
+						emit(inner_slots[slot_index].value, inner_slots[slot_index].end);
+						slot_index++;
+						}
+
+					const size_t emitted_end{merged.empty() ? static_cast<size_t>(0) : merged.back().end};
+					if (emitted_end < painted_region.begin) { emit(inner_slots[slot_index].value, painted_region.begin); }
+
+					emit(updates[painted_region.update_index].first, painted_region.end);
+
+					while (slot_index < inner_slots.size() && inner_slots[slot_index].end <= painted_region.end) { slot_index++; }
+					}
+				for (; slot_index < inner_slots.size(); slot_index++)
+					{
+					emit(inner_slots[slot_index].value, inner_slots[slot_index].end);
+					}
+
+				inner_slots = std::move(merged);
+				}
+
 			size_t count_slots_if(auto callback) const noexcept
 				{
 				size_t count{0};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <map>
+#include <span>
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <utility>
+#include <iterator>
+
+#include "regions.h"
+
+#include "../details/warnings_pre.inline.h"
+
+// Same distribution of values along a 1d range as containers::regions, backed by an ordered tree keyed by each slot's end instead of a contiguous vector.
+// Point lookups and add are O(log n) in the number of slots (plus the slots an add covers, each of which is erased once), at the cost of node allocations
+// and no random access by slot index. Prefer regions for small or mostly read distributions, regions_map for large ones updated often.
+
+namespace utils::containers
+	{
+	/// <summary>
+	/// Same semantics as regions: adding the same value in subsequent regions merges them, adding a different value in a sequential region splits it.
+	/// Slots can only be walked in order, there's no slot index access.
+	///</summary>
+	template <typename T>
+	class regions_map
+		{
+		public:
+			using value_type = T;
+
+			template <bool is_const>
+			using read_slot = typename regions<value_type>::template read_slot<is_const>;
+
+		private:
+			using inner_slots_t = std::map<size_t, value_type>;
+
+			inner_slots_t inner_slots;
+
+			typename inner_slots_t::const_iterator element_index_to_slot(const size_t& index) const noexcept { return inner_slots.upper_bound(index); }
+			typename inner_slots_t::iterator       element_index_to_slot(const size_t& index)       noexcept { return inner_slots.upper_bound(index); }
+
+			size_t slot_begin(typename inner_slots_t::const_iterator it) const noexcept
+				{
+				if (it == inner_slots.begin()) { return 0; }
+				return std::prev(it)->first;
+				}
+
+			/// <summary> Makes sure a slot ends exactly at index, splitting the slot that contains it if needed. </summary>
+			void split_at(const size_t& index)
+				{
+				if (index == 0 || index == std::numeric_limits<size_t>::max()) { return; }
+
+				const auto it{inner_slots.lower_bound(index)};
+				if (it->first != index)
+					{
+					inner_slots.emplace_hint(it, index, it->second);
+					}
+				}
+
+		public:
+			regions_map(const value_type& starting_value) noexcept : inner_slots{{std::numeric_limits<size_t>::max(), starting_value}} {}
+
+			regions_map() noexcept
+				requires(std::is_default_constructible_v<value_type>)
+				: inner_slots{{std::numeric_limits<size_t>::max(), value_type{}}}
+				{
+				}
+
+			void reset(const value_type& starting_value) noexcept
+				{
+				inner_slots.clear();
+				inner_slots.emplace(std::numeric_limits<size_t>::max(), starting_value);
+				}
+			void reset() noexcept
+				{
+				inner_slots.clear();
+				inner_slots.emplace(std::numeric_limits<size_t>::max(), value_type{});
+				}
+
+			class forward_iterator
+				{
+				private:
+					friend class regions_map;
+
+					using inner_iterator_t = typename inner_slots_t::const_iterator;
+
+					size_t begin{0};
+					inner_iterator_t inner_it;
+
+					forward_iterator(size_t begin, inner_iterator_t inner_it) :
+						begin   {begin   },
+						inner_it{inner_it}
+						{
+						}
+
+				public:
+					using difference_type = std::ptrdiff_t;
+					using value_type      = read_slot<true>;
+
+					forward_iterator& operator++() noexcept
+						{
+						begin = inner_it->first;
+						++inner_it;
+						return *this;
+						}
+					forward_iterator operator++(int) noexcept
+						{
+						auto tmp{*this};
+						++(*this);
+						return tmp;
+						}
+
+					bool operator==(const forward_iterator& other) const noexcept
+						{
+						return inner_it == other.inner_it;
+						}
+
+					read_slot<true> operator*() const noexcept
+						{
+						const read_slot<true> ret
+							{
+							.region{region()},
+							.value {value ()}
+							};
+						return ret;
+						}
+
+					const regions_map::value_type& value() const noexcept { return inner_it->second; }
+
+					containers::region region() const noexcept
+						{
+						const auto ret{utils::containers::region::create::from_to(begin, inner_it->first)};
+						return ret;
+						}
+				};
+
+			forward_iterator begin() const noexcept { return {static_cast<size_t>(0), inner_slots.begin()}; }
+			forward_iterator end  () const noexcept { return {std::numeric_limits<size_t>::max(), inner_slots.end()}; }
+
+			/// <summary> Same accessors as regions::elements_index_view_t::at_t, resolved once on construction. </summary>
+			class at_t
+				{
+				friend class regions_map;
+				public:
+					const value_type& value       () const noexcept { return it->second; }
+					size_t            region_begin() const noexcept { return begin; }
+					size_t            region_end  () const noexcept { return it->first; }
+					containers::region region     () const noexcept { return containers::region::create::from_to(begin, it->first); }
+
+					read_slot<true> slot() const noexcept
+						{
+						const read_slot<true> ret
+							{
+							.region{region()},
+							.value {value ()}
+							};
+						return ret;
+						}
+
+				private:
+					at_t(size_t begin, typename inner_slots_t::const_iterator it) : begin{begin}, it{it} {}
+					size_t begin;
+					typename inner_slots_t::const_iterator it;
+				};
+
+			at_t at_element_index(const size_t& index) const noexcept
+				{
+				assert(index != std::numeric_limits<size_t>::max());
+				const auto it{element_index_to_slot(index)};
+				return {slot_begin(it), it};
+				}
+
+			/// <summary> Whole slots overlapping a region, they're not clipped to it. </summary>
+			struct query_view_t
+				{
+				forward_iterator first;
+				forward_iterator last;
+
+				forward_iterator begin() const noexcept { return first; }
+				forward_iterator end  () const noexcept { return last ; }
+				bool empty() const noexcept { return first == last; }
+				};
+			query_view_t query(const region& in_region) const noexcept
+				{
+				const auto first{element_index_to_slot(in_region.begin)};
+				const auto last {in_region.empty() ? first : std::next(element_index_to_slot(in_region.end() - 1))};
+				return
+					{
+					.first{slot_begin(first), first},
+					.last {slot_begin(last ), last }
+					};
+				}
+
+			/// <summary> Will never be 0, there's at least one slot.</summary>
+			size_t slots_count() const noexcept { return inner_slots.size(); }
+
+			std::vector<size_t> split_indices() const noexcept
+				{
+				std::vector<size_t> ret;
+				ret.reserve(inner_slots.size() - 1);
+				for (const auto& [end, value] : inner_slots)
+					{
+					if (end != std::numeric_limits<size_t>::max()) { ret.emplace_back(end); }
+					}
+				return ret;
+				}
+			std::vector<value_type> values() const noexcept
+				{
+				std::vector<value_type> ret; ret.reserve(inner_slots.size());
+				for (const auto& [end, value] : inner_slots)
+					{
+					ret.emplace_back(value);
+					}
+				return ret;
+				}
+
+			value_type last_value() const noexcept { return inner_slots.rbegin()->second; }
+
+			void add(const value_type& new_value, const region& in_region)
+				{
+				assert(in_region.begin != std::numeric_limits<size_t>::max());
+				if (in_region.empty()) { return; }
+
+				const size_t begin{in_region.begin };
+				const size_t end  {in_region.end()};
+
+				split_at(begin);
+				split_at(end);
+
+				//Slots ending in (begin, end] are now entirely covered by the new region.
+				const auto after   {inner_slots.erase(inner_slots.upper_bound(begin), inner_slots.upper_bound(end))};
+				const auto inserted{inner_slots.emplace_hint(after, end, new_value)};
+
+				if (inserted != inner_slots.begin())
+					{
+					const auto previous{std::prev(inserted)};
+					if (previous->second == new_value) { inner_slots.erase(previous); }
+					}
+				if (after != inner_slots.end() && after->second == new_value)
+					{
+					//The next slot keeps its end and absorbs the new one.
+					inner_slots.erase(inserted);
+					}
+				}
+
+			/// <summary> Same as calling add for each update in order, each one is already O(log n). </summary>
+			void add_batch(std::span<const std::pair<value_type, region>> updates)
+				{
+				for (const auto& [value, update_region] : updates) { add(value, update_region); }
+				}
+
+			size_t count_slots_if(auto callback) const noexcept
+				{
+				size_t count{0};
+				for (const auto& slot : *this)
+					{
+					if (callback(slot.value))
+						{
+						count++;
+						}
+					}
+				return count;
+				}
+			size_t count_values_if(auto callback) const noexcept
+				{
+				size_t count{0};
+				for (const auto& slot : *this)
+					{
+					if (callback(slot.value))
+						{
+						count += slot.region.count;
+						}
+					}
+				return count;
+				}
+		};
+	}
+
+#include "../details/warnings_post.inline.h"
\ No newline at end of file
@@ -8,7 +8,7 @@
 #include "object_pool.h"
 #include "../memory.h"
 #include "../thread_pool.h"
-#include "multithreading/producer_consumer_queue.h" //TODO replace with moodyycamel's non-blocking concurrentqueue, if it ever gets an std::optional<T> polling method
+#include "multithreading/producer_consumer_queue.h"
 
 namespace utils::containers
 	{
@@ -137,9 +137,10 @@ namespace utils::containers
 				loaded.emplace(identifier, result);
 				}
 
+			/// <summary> Loads run as background tasks: they never delay the pool's interactive tasks, and with worker groups they can be kept off the latency critical workers. </summary>
 			void add_loading_task(const identifier_t& identifier, loading_callable_t loading_callable)
 				{
-				thread_pool.get().push_task([this, identifier, loading_callable]() { execute_loading_task(identifier, loading_callable); });
+				thread_pool.get().push_task(utils::thread_pool::priority_t::background, [this, identifier, loading_callable]() { execute_loading_task(identifier, loading_callable); });
 				}
 		};
 	}
\ No newline at end of file
@@ -1,4 +1,7 @@
 #pragma once
+#include <bit>
+#include <span>
+#include <compare>
 #include <memory>
 #include <utility>
 #include <type_traits>
@@ -9,9 +12,14 @@
 
 namespace utils::containers
 	{
+	/// <summary>
+	/// Vector made of fixed size segments, elements never move when the container grows.
+	/// Segments are reached through a contiguous table, random access is a shift, a mask and a load. for_each_segment exposes the contiguous segments directly.
+	/// </summary>
 	template <typename T, size_t inner_size = 8, typename Allocator = std::allocator<T>>
 	class segmented_vector
 		{
+		static_assert(std::has_single_bit(inner_size), "segmented_vector inner_size must be a power of two.");
 
 		private:
 			template<typename iter_t>
@@ -25,6 +33,7 @@ namespace utils::containers
 
 			using segment_ptr_t = utils::observer_ptr<segment_t>;
 			using segment_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_t>;
+			using segments_table_allocator_t = typename std::allocator_traits<Allocator>::template rebind_alloc<segment_ptr_t>;
 
 #pragma region iterators
 
@@ -110,11 +119,11 @@ namespace utils::containers
 					self_type& operator--(int) { operator--(); return *this; }
 					
 					const_reference operator* () const noexcept                                  { return *element_ptr; }
-					reference       operator* ()       noexcept requires(!std::is_const<iter_T>) { return *element_ptr; }
+					reference       operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *element_ptr; }
 					const_pointer   operator->() const noexcept                                  { return  element_ptr; }
-					pointer         operator->()       noexcept requires(!std::is_const<iter_T>) { return  element_ptr; }
+					pointer         operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  element_ptr; }
 					bool operator== (const self_type& rhs) const noexcept { return index ==  rhs.index; }
-					bool operator<=>(const self_type& rhs) const noexcept { return index <=> rhs.index; }
+					std::strong_ordering operator<=>(const self_type& rhs) const noexcept { return index <=> rhs.index; }
 
 				private:
 					size_t            index;
@@ -179,7 +188,7 @@ namespace utils::containers
 						requires std::same_as <T, std::remove_cv_t<rhs_T>>
 					difference_type operator- (const base_reverse_iterator<rhs_T>& rhs) const noexcept
 						{ 
-						return static_cast<difference_type>(index) - static_cast<difference_type>(rhs.index);
+						return static_cast<difference_type>(rhs.index) - static_cast<difference_type>(index);
 						}
 
 					self_type& operator+=(difference_type rhs) { *this = *this + rhs; return *this; }
@@ -204,11 +213,11 @@ namespace utils::containers
 					self_type& operator--(int) { operator--(); return *this; }
 					
 					const_reference operator* () const noexcept                                  { return *element_ptr; }
-					reference       operator* ()       noexcept requires(!std::is_const<iter_T>) { return *element_ptr; }
+					reference       operator* ()       noexcept requires(!std::is_const_v<iter_T>) { return *element_ptr; }
 					const_pointer   operator->() const noexcept                                  { return  element_ptr; }
-					pointer         operator->()       noexcept requires(!std::is_const<iter_T>) { return  element_ptr; }
+					pointer         operator->()       noexcept requires(!std::is_const_v<iter_T>) { return  element_ptr; }
 					bool operator== (const self_type& rhs) const noexcept { return index ==  rhs.index; }
-					bool operator<=>(const self_type& rhs) const noexcept { return index <=> rhs.index; }
+					std::strong_ordering operator<=>(const self_type& rhs) const noexcept { return rhs.index <=> index; }
 				private:
 					ptrdiff_t         index;
 					segmented_vector* container_ptr;
@@ -229,7 +238,7 @@ namespace utils::containers
 			using const_reverse_iterator = base_reverse_iterator<const T>;
 
 			segmented_vector() {}
-			segmented_vector(const Allocator& allocator) : segment_allocator{allocator} {}
+			segmented_vector(const Allocator& allocator) : segments{allocator}, segment_allocator{allocator} {}
 
 			~segmented_vector() { clear(); }
 			
@@ -239,11 +248,13 @@ namespace utils::containers
 
 			void shrink_to_fit() noexcept { /*Done because the standard says it's fine to do nothing lol :) */ } //TODO
 
-			inline T& front() { return first_segment().arr[0]; }
-			inline T& back()  { return last_segment_ptr ().arr[last_segment_size() - 1];  } // TODO da fare modifica ricordamelo
+			inline T& front() { return first_segment()[0]; }
+			inline T& back()  { return last_segment_ptr ()[last_segment_size() - 1];  }
 
 			inline void clear()
 				{
+				if (segments.empty()) { return; }
+
 				auto segments_it{segments.begin()};
 				for (; segments_it != segments.end() - 1; segments_it++)
 					{
@@ -330,24 +341,39 @@ namespace utils::containers
 
 			const T& operator[](const size_t index) const noexcept
 				{
-				return segments[segment_index_containing_my_index(index)][my_index_to_segment_index(index)];
+				return (*segments[segment_index_containing_my_index(index)])[my_index_to_segment_index(index)];
 				}
 
 			      T& operator[](const size_t index)       noexcept
 				{
-				return segments[segment_index_containing_my_index(index)][my_index_to_segment_index(index)];
+				return (*segments[segment_index_containing_my_index(index)])[my_index_to_segment_index(index)];
+				}
+
+			/// <summary> Calls callback with a span over each segment's elements, in order. Every span but the last one holds inner_size elements. </summary>
+			template <typename callback_t>
+			void for_each_segment(callback_t&& callback)
+				{
+				for (size_t i{0}; i < segments.size(); i++) { callback(std::span<T>{segments[i]->data(), segment_size(i)}); }
+				}
+			template <typename callback_t>
+			void for_each_segment(callback_t&& callback) const
+				{
+				for (size_t i{0}; i < segments.size(); i++) { callback(std::span<const T>{segments[i]->data(), segment_size(i)}); }
 				}
 
 		protected:
+			inline static constexpr size_t segment_shift{static_cast<size_t>(std::countr_zero(inner_size))};
+			inline static constexpr size_t segment_mask {inner_size - 1};
+
 			size_t _size{0};
-			std::vector<utils::observer_ptr<segment_t>> segments;
+			std::vector<segment_ptr_t, segments_table_allocator_t> segments;
 			
 			segment_allocator_t segment_allocator ;
 
 			pointer get_free_slot()
 				{
 				segment_t& segment{grow_if_full()};
-				return segment.data() + (size() % inner_size);
+				return segment.data() + my_index_to_segment_index(size());
 				}
 
 			segment_t& grow_if_full()
@@ -368,40 +394,30 @@ namespace utils::containers
 			      segment_t& last_segment_ptr ()       noexcept{ return *segments[segments.size() - 1]; }
 
 			size_t last_segment_size() const noexcept { return size() - inner_size * (segments.size() - 1); }
+			size_t segment_size(size_t segment_index) const noexcept { return segment_index + 1 == segments.size() ? last_segment_size() : inner_size; }
 			
 			size_t segment_index_containing_my_index(size_t index) const noexcept
 				{
-				return index / inner_size;
+				return index >> segment_shift;
 				}
 			size_t my_index_to_segment_index(size_t index) const noexcept
 				{
-				return index % inner_size;
+				return index & segment_mask;
 				}
 			 
+			/// <returns> The address of the slot at index, nullptr past the last segment. </returns>
 			pointer address_at(size_t index) noexcept
 				{
-				size_t segment_index{segment_index_containing_my_index(index)};
-				if (segment_index >= segments.size()) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				if (index >= capacity()) { return nullptr; }
+				return segments[segment_index_containing_my_index(index)]->data() + my_index_to_segment_index(index);
 				}
 			const_pointer address_at(size_t index) const noexcept
 				{
-				size_t segment_index{segment_index_containing_my_index(index)};
-				if (segment_index >= segments.size()) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
-				}
-			pointer address_at(ptrdiff_t  index) noexcept
-				{
-				size_t segment_index{segment_index_containing_my_index(index)};
-				if (segment_index >= segments.size() || segment_index < 0) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
-				}
-			const_pointer address_at(ptrdiff_t  index) const noexcept
-				{
-				size_t segment_index{segment_index_containing_my_index(index)};
-				if (segment_index >= segments.size() || segment_index < 0) { return nullptr; }
-				else { return &(*segments[segment_index])[my_index_to_segment_index(index)]; }
+				if (index >= capacity()) { return nullptr; }
+				return segments[segment_index_containing_my_index(index)]->data() + my_index_to_segment_index(index);
 				}
+			pointer       address_at(ptrdiff_t index)       noexcept { return index < 0 ? nullptr : address_at(static_cast<size_t>(index)); }
+			const_pointer address_at(ptrdiff_t index) const noexcept { return index < 0 ? nullptr : address_at(static_cast<size_t>(index)); }
 
 			static size_t distance(segment_ptr_t leftmost, segment_ptr_t rightmost)
 				{
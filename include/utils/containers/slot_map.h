@@ -0,0 +1,189 @@
+#pragma once
+
+#include <span>
+#include <limits>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+// Generational slot map: values live in a dense vector, handles are an index into a sparse slots table plus the generation the slot had when the handle was made.
+// Erasing moves the last value into the hole and bumps the slot's generation, so handles to erased elements are detected as stale instead of aliasing new ones.
+// Compared to handled_container and multihandled, handles are trivially copyable (no refcount, no container pointer) and a lookup is one slot read plus one value read.
+
+namespace utils::containers
+	{
+	/// <summary>
+	/// Dense storage with stable 64 bits handles. Insert and erase are O(1), erase doesn't keep the order of the values.
+	/// Iteration walks the dense values vector directly.
+	/// </summary>
+	template <typename T, class Allocator = std::allocator<T>>
+	class slot_map
+		{
+		protected:
+			using inner_container_t = std::vector<T, Allocator>;
+
+		public:
+			using value_type             = inner_container_t::value_type;
+			using size_type              = inner_container_t::size_type;
+			using reference              = inner_container_t::reference;
+			using const_reference        = inner_container_t::const_reference;
+			using pointer                = inner_container_t::pointer;
+			using const_pointer          = inner_container_t::const_pointer;
+			using iterator               = inner_container_t::iterator;
+			using const_iterator         = inner_container_t::const_iterator;
+			using reverse_iterator       = inner_container_t::reverse_iterator;
+			using const_reverse_iterator = inner_container_t::const_reverse_iterator;
+
+			struct handle_t
+				{
+				inline static constexpr uint32_t invalid_index{std::numeric_limits<uint32_t>::max()};
+
+				uint32_t index     {invalid_index};
+				uint32_t generation{0};
+
+				bool has_value() const noexcept { return index != invalid_index; }
+				void reset() noexcept { index = invalid_index; generation = 0; }
+
+				bool operator==(const handle_t& other) const noexcept = default;
+				};
+			static_assert(std::is_trivially_copyable_v<handle_t> && sizeof(handle_t) == 8);
+
+			slot_map() = default;
+
+			template <typename ...Args>
+			handle_t emplace(Args&& ...args)
+				{
+				assert(values.size() < handle_t::invalid_index);
+
+				const uint32_t slot_index{acquire_slot()};
+				values.emplace_back(std::forward<Args>(args)...);
+
+				slot_t& slot{slots[slot_index]};
+				slot.dense_or_next_free = static_cast<uint32_t>(values.size() - 1);
+				dense_to_slot.push_back(slot_index);
+				return {slot_index, slot.generation};
+				}
+			handle_t push(const T& value) { return emplace(value); }
+			handle_t push(T&& value) { return emplace(std::move(value)); }
+
+			/// <summary> False if the handle was already stale. </summary>
+			bool erase(const handle_t& handle)
+				{
+				if (!contains(handle)) { return false; }
+
+				slot_t& slot{slots[handle.index]};
+				const uint32_t dense_index{slot.dense_or_next_free};
+				const uint32_t last_index {static_cast<uint32_t>(values.size() - 1)};
+				if (dense_index != last_index)
+					{
+					values[dense_index] = std::move(values[last_index]);
+					dense_to_slot[dense_index] = dense_to_slot[last_index];
+					slots[dense_to_slot[dense_index]].dense_or_next_free = dense_index;
+					}
+				values.pop_back();
+				dense_to_slot.pop_back();
+
+				release_slot(handle.index);
+				return true;
+				}
+
+			bool contains(const handle_t& handle) const noexcept
+				{
+				return handle.index < slots.size() && slots[handle.index].generation == handle.generation && slots[handle.index].occupied;
+				}
+
+			/// <summary> nullptr if the handle is stale. </summary>
+			      T* get(const handle_t& handle)       noexcept { return contains(handle) ? std::addressof(values[slots[handle.index].dense_or_next_free]) : nullptr; }
+			const T* get(const handle_t& handle) const noexcept { return contains(handle) ? std::addressof(values[slots[handle.index].dense_or_next_free]) : nullptr; }
+
+			      T& operator[](const handle_t& handle)       noexcept { assert(contains(handle)); return values[slots[handle.index].dense_or_next_free]; }
+			const T& operator[](const handle_t& handle) const noexcept { assert(contains(handle)); return values[slots[handle.index].dense_or_next_free]; }
+
+			      T& at(const handle_t& handle)       { if (!contains(handle)) { throw std::out_of_range{"slot_map stale or invalid handle."}; } return operator[](handle); }
+			const T& at(const handle_t& handle) const { if (!contains(handle)) { throw std::out_of_range{"slot_map stale or invalid handle."}; } return operator[](handle); }
+
+			/// <summary> Handle of the value currently at the given position of the dense storage, positions change on erase. </summary>
+			handle_t handle_at(size_t dense_index) const noexcept
+				{
+				const uint32_t slot_index{dense_to_slot[dense_index]};
+				return {slot_index, slots[slot_index].generation};
+				}
+
+			/// <summary> Invalidates every handle. </summary>
+			void clear() noexcept
+				{
+				for (const uint32_t slot_index : dense_to_slot) { release_slot(slot_index); }
+				values.clear();
+				dense_to_slot.clear();
+				}
+			void reserve(size_t capacity)
+				{
+				values.reserve(capacity);
+				dense_to_slot.reserve(capacity);
+				slots.reserve(capacity);
+				}
+
+			size_t size () const noexcept { return values.size (); }
+			bool   empty() const noexcept { return values.empty(); }
+
+			std::span<      T> span()       noexcept { return values; }
+			std::span<const T> span() const noexcept { return values; }
+
+			const auto begin  () const noexcept { return values.begin  (); }
+			      auto begin  ()       noexcept { return values.begin  (); }
+			const auto end    () const noexcept { return values.end    (); }
+			      auto end    ()       noexcept { return values.end    (); }
+			const auto cbegin () const noexcept { return values.cbegin (); }
+			const auto cend   () const noexcept { return values.cend   (); }
+			const auto rbegin () const noexcept { return values.rbegin (); }
+			      auto rbegin ()       noexcept { return values.rbegin (); }
+			const auto rend   () const noexcept { return values.rend   (); }
+			      auto rend   ()       noexcept { return values.rend   (); }
+			const auto crbegin() const noexcept { return values.crbegin(); }
+			const auto crend  () const noexcept { return values.crend  (); }
+
+		protected:
+			struct slot_t
+				{
+				/// <summary> Index in values while occupied, next free slot while free. </summary>
+				uint32_t dense_or_next_free;
+				uint32_t generation : 31;
+				uint32_t occupied   : 1;
+				};
+			inline static constexpr uint32_t max_generation{(1u << 31) - 1};
+
+			inner_container_t     values;
+			std::vector<uint32_t> dense_to_slot;
+			std::vector<slot_t  > slots;
+			uint32_t first_free_slot{handle_t::invalid_index};
+
+			uint32_t acquire_slot()
+				{
+				if (first_free_slot != handle_t::invalid_index)
+					{
+					const uint32_t ret{first_free_slot};
+					first_free_slot = slots[ret].dense_or_next_free;
+					slots[ret].occupied = 1;
+					return ret;
+					}
+				assert(slots.size() < handle_t::invalid_index);
+				slots.push_back(slot_t{.dense_or_next_free{0}, .generation{0}, .occupied{1}});
+				return static_cast<uint32_t>(slots.size() - 1);
+				}
+
+			void release_slot(uint32_t slot_index) noexcept
+				{
+				slot_t& slot{slots[slot_index]};
+				slot.occupied = 0;
+				//A slot whose generation would wrap around is retired, so an old handle can never match it again.
+				if (slot.generation == max_generation) { return; }
+				slot.generation++;
+				slot.dense_or_next_free = first_free_slot;
+				first_free_slot = slot_index;
+				}
+		};
+	}
\ No newline at end of file
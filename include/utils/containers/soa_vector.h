@@ -0,0 +1,410 @@
+#pragma once
+
+#include <span>
+#include <tuple>
+#include <memory>
+#include <cassert>
+#include <concepts>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include "../aggregate.h"
+
+// Structure of arrays vector: each member of T, as listed by an utils::aggregate::accessors_helper, lives in its own contiguous array.
+// Elements are accessed through proxy references which convert to and from T and expose each member by accessor index;
+// loops touching a single member should use the per-member spans (field<I>()) to stream only that member's array.
+// Accessors must be flat (no accessors_recursive_helper), list nested members directly instead: [](auto& instance) -> auto& { return instance.c.x; }.
+
+namespace utils::containers
+	{
+	template <typename T, typename ACCESSORS_HELPER>
+		requires(std::derived_from<ACCESSORS_HELPER, utils::aggregate::accessors_helper_flag>)
+	class soa_vector
+		{
+		public:
+			using accessors_helper = ACCESSORS_HELPER;
+			using value_type       = T;
+			using size_type        = size_t;
+			using difference_type  = ptrdiff_t;
+
+			inline static constexpr size_t fields_count{std::tuple_size_v<std::remove_cvref_t<decltype(accessors_helper::accessors)>>};
+
+			template <size_t field_index>
+			using field_t = std::remove_cvref_t<decltype(std::get<field_index>(accessors_helper::accessors)(std::declval<T&>()))>;
+
+		private:
+			template <size_t field_index>
+			static constexpr auto& accessor{std::get<field_index>(accessors_helper::accessors)};
+
+			using fields_indices = std::make_index_sequence<fields_count>;
+
+			template <typename indices>
+			struct columns_of;
+			template <size_t ...Is>
+			struct columns_of<std::index_sequence<Is...>>
+				{
+				using type = std::tuple<field_t<Is>*...>;
+				static_assert((std::is_nothrow_move_constructible_v<field_t<Is>> && ...), "soa_vector fields must be nothrow move constructible, growing moves every column.");
+				};
+			using columns_t = typename columns_of<fields_indices>::type;
+
+			template <typename callback_t>
+			static constexpr void for_each_field_index(callback_t&& callback)
+				{
+				[&]<size_t... Is>(std::index_sequence<Is...>) { (callback.template operator()<Is>(), ...); }(fields_indices{});
+				}
+
+#pragma region reference
+			template <bool is_const>
+			class reference_t
+				{
+				friend class soa_vector;
+				using container_t = std::conditional_t<is_const, const soa_vector, soa_vector>;
+
+				public:
+					reference_t(const reference_t& copy) noexcept = default;
+					operator reference_t<true>() const noexcept requires(!is_const) { return {*container, index}; }
+
+					template <size_t field_index>
+					auto& get() const noexcept { return std::get<field_index>(container->columns)[index]; }
+
+					operator value_type() const
+						{
+						value_type ret{};
+						for_each_field_index([&]<size_t field_index>() { accessor<field_index>(ret) = get<field_index>(); });
+						return ret;
+						}
+
+					const reference_t& operator=(const value_type& value) const requires(!is_const)
+						{
+						for_each_field_index([&]<size_t field_index>() { get<field_index>() = accessor<field_index>(value); });
+						return *this;
+						}
+					const reference_t& operator=(value_type&& value) const requires(!is_const)
+						{
+						for_each_field_index([&]<size_t field_index>() { get<field_index>() = std::move(accessor<field_index>(value)); });
+						return *this;
+						}
+					/// <summary> Assigns the referenced values, not the reference. </summary>
+					const reference_t& operator=(const reference_t& other) const requires(!is_const)
+						{
+						for_each_field_index([&]<size_t field_index>() { get<field_index>() = other.template get<field_index>(); });
+						return *this;
+						}
+					template <bool other_const>
+						requires(!is_const && other_const)
+					const reference_t& operator=(const reference_t<other_const>& other) const
+						{
+						for_each_field_index([&]<size_t field_index>() { get<field_index>() = other.template get<field_index>(); });
+						return *this;
+						}
+
+					friend void swap(const reference_t& a, const reference_t& b) noexcept requires(!is_const)
+						{
+						a.swap_values(b);
+						}
+
+				private:
+					reference_t(container_t& container, size_t index) noexcept : container{&container}, index{index} {}
+
+					void swap_values(const reference_t& other) const noexcept
+						{
+						for_each_field_index([&]<size_t field_index>() { std::ranges::swap(get<field_index>(), other.template get<field_index>()); });
+						}
+
+					container_t* container;
+					size_t index;
+				};
+#pragma endregion reference
+
+#pragma region iterator
+			template <bool is_const>
+			class iterator_t
+				{
+				friend class soa_vector;
+				using container_t = std::conditional_t<is_const, const soa_vector, soa_vector>;
+
+				public:
+					using self_type         = iterator_t<is_const>;
+					using value_type        = soa_vector::value_type;
+					using reference         = reference_t<is_const>;
+					using pointer           = void;
+					using iterator_category = std::random_access_iterator_tag;
+					using difference_type   = ptrdiff_t;
+
+					iterator_t() noexcept = default;
+					operator iterator_t<true>() const noexcept requires(!is_const) { return {*container, index}; }
+
+					reference operator* ()                      const noexcept { return {*container, index}; }
+					reference operator[](difference_type delta) const noexcept { return {*container, index + delta}; }
+
+					self_type& operator++() noexcept { index++; return *this; }
+					self_type& operator--() noexcept { index--; return *this; }
+					self_type  operator++(int) noexcept { self_type ret{*this}; index++; return ret; }
+					self_type  operator--(int) noexcept { self_type ret{*this}; index--; return ret; }
+
+					self_type& operator+=(difference_type delta) noexcept { index += delta; return *this; }
+					self_type& operator-=(difference_type delta) noexcept { index -= delta; return *this; }
+					self_type  operator+ (difference_type delta) const noexcept { return {*container, index + delta}; }
+					self_type  operator- (difference_type delta) const noexcept { return {*container, index - delta}; }
+					friend self_type operator+(difference_type delta, const self_type& iterator) noexcept { return iterator + delta; }
+
+					difference_type operator-(const self_type& other) const noexcept { return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); }
+
+					bool operator== (const self_type& other) const noexcept { return index ==  other.index; }
+					auto operator<=>(const self_type& other) const noexcept { return index <=> other.index; }
+
+					size_t get_index() const noexcept { return index; }
+
+				private:
+					iterator_t(container_t& container, size_t index) noexcept : container{&container}, index{index} {}
+
+					container_t* container{nullptr};
+					size_t index{0};
+				};
+#pragma endregion iterator
+
+		public:
+			using reference       = reference_t<false>;
+			using const_reference = reference_t<true >;
+			using iterator        = iterator_t <false>;
+			using const_iterator  = iterator_t <true >;
+
+			soa_vector() noexcept = default;
+			explicit soa_vector(size_t size) { resize(size); }
+
+			soa_vector(const soa_vector& copy)
+				{
+				reserve(copy.size());
+				for (const auto& element : copy) { push_back(element); }
+				}
+			soa_vector(soa_vector&& move) noexcept :
+				columns  {std::exchange(move.columns  , columns_t{})},
+				elements {std::exchange(move.elements , size_t{0})},
+				allocated{std::exchange(move.allocated, size_t{0})}
+				{}
+
+			soa_vector& operator=(soa_vector other) noexcept
+				{
+				std::swap(columns  , other.columns  );
+				std::swap(elements , other.elements );
+				std::swap(allocated, other.allocated);
+				return *this;
+				}
+
+			~soa_vector()
+				{
+				clear();
+				deallocate(columns, allocated);
+				}
+
+			size_t size    () const noexcept { return elements ; }
+			size_t capacity() const noexcept { return allocated; }
+			bool   empty   () const noexcept { return elements == 0; }
+
+			/// <summary> Contiguous array of the field_index-th member of every element. </summary>
+			template <size_t field_index> std::span<      field_t<field_index>> field()       noexcept { return {std::get<field_index>(columns), elements}; }
+			template <size_t field_index> std::span<const field_t<field_index>> field() const noexcept { return {std::get<field_index>(columns), elements}; }
+
+			reference       operator[](size_t index)       noexcept { assert(index < elements); return {*this, index}; }
+			const_reference operator[](size_t index) const noexcept { assert(index < elements); return {*this, index}; }
+			reference       at        (size_t index)       { if (index >= elements) { throw std::out_of_range{"soa_vector access out of bounds."}; } return {*this, index}; }
+			const_reference at        (size_t index) const { if (index >= elements) { throw std::out_of_range{"soa_vector access out of bounds."}; } return {*this, index}; }
+
+			reference       front()       noexcept { return operator[](0); }
+			const_reference front() const noexcept { return operator[](0); }
+			reference       back ()       noexcept { return operator[](elements - 1); }
+			const_reference back () const noexcept { return operator[](elements - 1); }
+
+			iterator       begin ()       noexcept { return {*this, 0       }; }
+			const_iterator begin () const noexcept { return {*this, 0       }; }
+			const_iterator cbegin() const noexcept { return {*this, 0       }; }
+			iterator       end   ()       noexcept { return {*this, elements}; }
+			const_iterator end   () const noexcept { return {*this, elements}; }
+			const_iterator cend  () const noexcept { return {*this, elements}; }
+
+			void reserve(size_t new_capacity)
+				{
+				if (new_capacity > allocated) { reallocate(new_capacity); }
+				}
+
+			void shrink_to_fit()
+				{
+				if (elements < allocated) { reallocate(elements); }
+				}
+
+			void resize(size_t new_size)
+				{
+				if (new_size < elements)
+					{
+					destroy_rows(new_size, elements);
+					elements = new_size;
+					return;
+					}
+				reserve(new_size);
+				while (elements < new_size) { construct_row([](auto& field) { ::new (static_cast<void*>(&field)) std::remove_cvref_t<decltype(field)>{}; }); }
+				}
+
+			void clear() noexcept
+				{
+				destroy_rows(0, elements);
+				elements = 0;
+				}
+
+			reference push_back(const value_type& value)
+				{
+				grow_if_full();
+				construct_row([&]<size_t field_index>(auto& field) { ::new (static_cast<void*>(&field)) field_t<field_index>{accessor<field_index>(value)}; });
+				return back();
+				}
+
+			reference push_back(value_type&& value)
+				{
+				grow_if_full();
+				construct_row([&]<size_t field_index>(auto& field) { ::new (static_cast<void*>(&field)) field_t<field_index>{std::move(accessor<field_index>(value))}; });
+				return back();
+				}
+
+			/// <summary> The element is copied out before growing, value may refer to an element of this vector. </summary>
+			reference push_back(const_reference value)
+				{
+				return push_back(static_cast<value_type>(value));
+				}
+
+			/// <summary> Without it push_back(v[i]) would be ambiguous between the value_type and const_reference overloads. </summary>
+			reference push_back(reference value)
+				{
+				return push_back(const_reference{value});
+				}
+
+			void pop_back() noexcept
+				{
+				assert(elements > 0);
+				destroy_rows(elements - 1, elements);
+				elements--;
+				}
+
+			/// <summary> Preserves the order of the remaining elements, O(n). </summary>
+			void erase(size_t index) noexcept
+				{
+				assert(index < elements);
+				for_each_field_index([&]<size_t field_index>()
+					{
+					auto* column{std::get<field_index>(columns)};
+					std::move(column + index + 1, column + elements, column + index);
+					});
+				pop_back();
+				}
+			iterator erase(const_iterator position) noexcept
+				{
+				erase(position.get_index());
+				return {*this, position.get_index()};
+				}
+
+			/// <summary> Moves the last element in place of the erased one, O(1). </summary>
+			void erase_swap_back(size_t index) noexcept
+				{
+				assert(index < elements);
+				if (index != elements - 1)
+					{
+					for_each_field_index([&]<size_t field_index>()
+						{
+						auto* column{std::get<field_index>(columns)};
+						column[index] = std::move(column[elements - 1]);
+						});
+					}
+				pop_back();
+				}
+
+		private:
+			columns_t columns{};
+			size_t elements {0};
+			size_t allocated{0};
+
+			template <size_t field_index>
+			using field_allocator_t = std::allocator<field_t<field_index>>;
+
+			static void deallocate(columns_t& columns, size_t capacity) noexcept
+				{
+				for_each_field_index([&]<size_t field_index>()
+					{
+					auto*& column{std::get<field_index>(columns)};
+					if (column) { field_allocator_t<field_index>{}.deallocate(column, capacity); column = nullptr; }
+					});
+				}
+
+			void reallocate(size_t new_capacity)
+				{
+				columns_t new_columns{};
+				try
+					{
+					for_each_field_index([&]<size_t field_index>()
+						{
+						if (new_capacity) { std::get<field_index>(new_columns) = field_allocator_t<field_index>{}.allocate(new_capacity); }
+						});
+					}
+				catch (...)
+					{
+					deallocate(new_columns, new_capacity);
+					throw;
+					}
+
+				for_each_field_index([&]<size_t field_index>()
+					{
+					auto* column{std::get<field_index>(columns)};
+					if (column)
+						{
+						std::uninitialized_move(column, column + elements, std::get<field_index>(new_columns));
+						std::destroy(column, column + elements);
+						}
+					});
+
+				deallocate(columns, allocated);
+				columns   = new_columns;
+				allocated = new_capacity;
+				}
+
+			void grow_if_full()
+				{
+				if (elements == allocated) { reallocate(allocated ? allocated * 2 : 8); }
+				}
+
+			/// <summary> Constructs every field of the row at index elements then increments elements. If a field constructor throws, the fields already constructed are destroyed. </summary>
+			template <typename construct_t>
+			void construct_row(construct_t&& construct)
+				{
+				size_t constructed{0};
+				try
+					{
+					for_each_field_index([&]<size_t field_index>()
+						{
+						auto& field{std::get<field_index>(columns)[elements]};
+						if constexpr (requires { construct.template operator()<field_index>(field); }) { construct.template operator()<field_index>(field); }
+						else { construct(field); }
+						constructed++;
+						});
+					}
+				catch (...)
+					{
+					for_each_field_index([&]<size_t field_index>()
+						{
+						if (field_index < constructed) { std::destroy_at(std::get<field_index>(columns) + elements); }
+						});
+					throw;
+					}
+				elements++;
+				}
+
+			void destroy_rows(size_t begin, size_t end) noexcept
+				{
+				for_each_field_index([&]<size_t field_index>()
+					{
+					auto* column{std::get<field_index>(columns)};
+					std::destroy(column + begin, column + end);
+					});
+				}
+		};
+	}
\ No newline at end of file
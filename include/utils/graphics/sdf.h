@@ -7,8 +7,10 @@
 
 #include "colour.h"
 #include "multisampling.h"
+#include "tiles.h"
 
 #include "../matrix.h"
+#include "../thread_pool.h"
 #include "../math/rect.h"
 #include "../math/vec.h"
 #include "../math/transform2.h"
@@ -16,6 +18,7 @@
 #include "../math/geometry/transform/aabb.h"
 #include "../math/geometry/transform/point.h"
 #include "../math/geometry/sdf/common.h"
+#include "../math/geometry/group.h"
 
 namespace utils::graphics::sdf
 	{
@@ -23,37 +26,29 @@ namespace utils::graphics::sdf
 	using per_pixel_signature = void(T&, const utils::math::vec2f& coords_f);
 	template <typename T>
 	using per_pixel_callback = std::function<per_pixel_signature<T>>;
-
-	template <typename T>
-	struct callback_at_coords
+	
+	namespace details
 		{
-		const utils::math::transform2 camera_transform{};
-		const float supersampling{1.f};
-		const per_pixel_callback<T>& per_pixel_callback;
-		utils::matrix<T>& image;
-
-		T& operator()(size_t index) noexcept
+		template <typename T, typename per_pixel_callback_t>
+		auto per_pixel_in_image(const per_pixel_callback_t& per_pixel_callback, utils::matrix<T>& image) noexcept
 			{
-			return operator()(image.sizes().index_to_coords(index));
+			return [&per_pixel_callback, &image](size_t index, const utils::math::vec2s&, const utils::math::vec2f& coords_f)
+				{
+				per_pixel_callback(image[index], coords_f);
+				};
 			}
-		T& operator()(const utils::math::vec2s coords_indices) noexcept
+
+		inline utils::math::rect<size_t> pixels_region(const utils::math::geometry::shape::aabb& pixels_region_f, const utils::math::vec2s& image_sizes) noexcept
 			{
-			const utils::math::vec2f coords_f
+			return utils::math::rect<size_t>
 				{
-				utils::math::vec2f
-					{
-					static_cast<float>(coords_indices.x()),
-					static_cast<float>(coords_indices.y())
-					}
-				.transform(camera_transform)
-				.scale(1.f / supersampling)
+				         utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.ll())),
+				         utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.up())),
+				std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.rr())), image_sizes.x()),
+				std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.dw())), image_sizes.y())
 				};
-
-			T& value_at_pixel{image[coords_indices]};
-			per_pixel_callback(value_at_pixel, coords_f);
-			return value_at_pixel;
 			}
-		};
+		}
 	
 	template <typename T, bool parallel = true>
 	constexpr utils::matrix<T>& evaluate_full_image
@@ -64,25 +59,25 @@ namespace utils::graphics::sdf
 		float supersampling = 1.f
 		) noexcept
 		{
-		const size_t indices_end{image.sizes().sizes_to_size()};
-		std::ranges::iota_view indices(size_t{0}, indices_end);
-
-		callback_at_coords<T> callback_at_coords
-			{
-			.camera_transform  {camera_transform  },
-			.supersampling     {supersampling     },
-			.per_pixel_callback{per_pixel_callback},
-			.image             {image}
-			};
+		const utils::graphics::tiles::tiled_region tiled_region{image.sizes(), utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+		tiled_region.execute<parallel>(details::per_pixel_in_image(per_pixel_callback, image));
+		return image;
+		}
 
-		if constexpr (parallel)
-			{
-			std::for_each(std::execution::par, indices.begin(), indices.end(), callback_at_coords);
-			}
-		else if constexpr (!parallel)
-			{
-			std::for_each(indices.begin(), indices.end(), callback_at_coords);
-			}
+	/// <summary> Same as evaluate_full_image, with the image's tiles scheduled on thread_pool. per_pixel_callback can be any callable with the per_pixel_signature, it's not wrapped in a std::function. </summary>
+	template <typename T, typename per_pixel_callback_t>
+	utils::matrix<T>& evaluate_full_image
+		(
+		utils::thread_pool& thread_pool,
+		const utils::math::transform2& camera_transform,
+		const per_pixel_callback_t& per_pixel_callback,
+		utils::matrix<T>& image,
+		float supersampling = 1.f
+		)
+		{
+		const utils::graphics::tiles::tiled_region tiled_region{image.sizes(), utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+		tiled_region.execute(thread_pool, details::per_pixel_in_image(per_pixel_callback, image));
+		return image;
 		}
 
 	template <typename T, bool parallel = true>
@@ -95,42 +90,35 @@ namespace utils::graphics::sdf
 		float supersampling = 1.f
 		) noexcept
 		{
-		const utils::math::rect<size_t> pixels_region
+		const utils::graphics::tiles::tiled_region tiled_region
 			{
-			utils::math::rect<size_t>
-				{
-				         utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.ll())),
-				         utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.up())),
-				std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.rr())), image.sizes().x()),
-				std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.dw())), image.sizes().y())
-				}
-			};
-		const size_t indices_end{pixels_region.size().sizes_to_size()};
-		std::ranges::iota_view indices(size_t{0}, indices_end);
-		
-		callback_at_coords<T> callback_at_coords
-			{
-			.camera_transform  {camera_transform  },
-			.supersampling     {supersampling     },
-			.per_pixel_callback{per_pixel_callback},
-			.image             {image}
+			image.sizes(),
+			details::pixels_region(pixels_region_f, image.sizes()),
+			utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)
 			};
+		tiled_region.execute<parallel>(details::per_pixel_in_image(per_pixel_callback, image));
+		return image;
+		}
 
-		const auto callback_at_coords_wrapper{[&](size_t index)
-			{
-			const utils::math::vec2s coords_indices{pixels_region.ul() + pixels_region.size().index_to_coords(index)};
-			callback_at_coords(coords_indices);
-			}};
-		
-		if constexpr (parallel)
-			{
-			std::for_each(std::execution::par, indices.begin(), indices.end(), callback_at_coords_wrapper);
-			}
-		else if constexpr (!parallel)
+	/// <summary> Same as evaluate_in_region, with the region's tiles scheduled on thread_pool. </summary>
+	template <typename T, typename per_pixel_callback_t>
+	utils::matrix<T>& evaluate_in_region
+		(
+		utils::thread_pool& thread_pool,
+		const utils::math::transform2& camera_transform,
+		const per_pixel_callback_t& per_pixel_callback,
+		const utils::math::geometry::shape::aabb& pixels_region_f,
+		utils::matrix<T>& image,
+		float supersampling = 1.f
+		)
+		{
+		const utils::graphics::tiles::tiled_region tiled_region
 			{
-			std::for_each(indices.begin(), indices.end(), callback_at_coords_wrapper);
-			}
-
+			image.sizes(),
+			details::pixels_region(pixels_region_f, image.sizes()),
+			utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)
+			};
+		tiled_region.execute(thread_pool, details::per_pixel_in_image(per_pixel_callback, image));
 		return image;
 		}
 
@@ -177,39 +165,18 @@ namespace utils::graphics::sdf
 		template <bool parallel = true>
 		constexpr utils::matrix<T> render(const utils::math::transform2& camera_transform, const utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& direction_signed_distance_field, float supersampling = 1.f)
 			{
-			const auto resolution{direction_signed_distance_field.sizes()};
-			utils::matrix<T, matrix_size::create::dynamic()> ret(resolution);
-
-			const auto callback{[&, this](size_t index)
-				{
-				const utils::math::vec2s coords_indices{ret.sizes().index_to_coords(index)};
-				const utils::math::vec2f coords_f
-					{
-					utils::math::vec2f
-						{
-						static_cast<float>(coords_indices.x()),
-						static_cast<float>(coords_indices.y())
-						}
-					.transform(camera_transform)
-					.scale    (1.f / supersampling)
-					};
-
-				auto& pixel{ret[index]};
-				const auto& direction_signed_distance{direction_signed_distance_field[index]};
-
-				pixel = sample(coords_f, direction_signed_distance);
-				}};
-
-			std::ranges::iota_view indices(size_t{0}, resolution.sizes_to_size());
-			if constexpr (parallel)
-				{
-				std::for_each(std::execution::par, indices.begin(), indices.end(), callback);
-				}
-			else if constexpr (!parallel)
-				{
-				std::for_each(indices.begin(), indices.end(), callback);
-				}
+			utils::matrix<T, matrix_size::create::dynamic()> ret(direction_signed_distance_field.sizes());
+			const utils::graphics::tiles::tiled_region tiled_region{ret.sizes(), utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+			tiled_region.execute<parallel>(sample_field_callback(direction_signed_distance_field, ret));
+			return ret;
+			}
 
+		/// <summary> Same as render with a precalculated direction signed distance field, with the image's tiles scheduled on thread_pool. </summary>
+		utils::matrix<T> render(utils::thread_pool& thread_pool, const utils::math::transform2& camera_transform, const utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& direction_signed_distance_field, float supersampling = 1.f)
+			{
+			utils::matrix<T, matrix_size::create::dynamic()> ret(direction_signed_distance_field.sizes());
+			const utils::graphics::tiles::tiled_region tiled_region{ret.sizes(), utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+			tiled_region.execute(thread_pool, sample_field_callback(direction_signed_distance_field, ret));
 			return ret;
 			}
 
@@ -226,39 +193,54 @@ namespace utils::graphics::sdf
 		constexpr utils::matrix<T> render(const utils::math::transform2& camera_transform, const utils::math::vec2s& resolution, sample_dsdf_callback sample_dsdf_callback, float supersampling = 1.f)
 			{
 			utils::matrix<T> ret(resolution);
+			const utils::graphics::tiles::tiled_region tiled_region{resolution, utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+			tiled_region.execute<parallel>(sample_dsdf_at_callback(sample_dsdf_callback, ret));
+			return ret;
+			}
 
-			const auto callback{[&, this](size_t index)
-				{
-				const utils::math::vec2s coords_indices{resolution.index_to_coords(index)};
-				const utils::math::vec2f coords_f
-					{
-					utils::math::vec2f
-						{
-						static_cast<float>(coords_indices.x()),
-						static_cast<float>(coords_indices.y())
-						}
-					.transform(camera_transform)
-					.scale    (1.f / supersampling)
-					};
+		/// <summary> Same as render sampling the direction distances for each pixel, with the image's tiles scheduled on thread_pool. sample_dsdf can be any callable with the sample_dsdf_signature, it's not wrapped in a std::function. </summary>
+		template <typename sample_dsdf_t>
+		utils::matrix<T> render(utils::thread_pool& thread_pool, const utils::math::transform2& camera_transform, const utils::math::vec2s& resolution, const sample_dsdf_t& sample_dsdf, float supersampling = 1.f)
+			{
+			utils::matrix<T> ret(resolution);
+			const utils::graphics::tiles::tiled_region tiled_region{resolution, utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+			tiled_region.execute(thread_pool, sample_dsdf_at_callback(sample_dsdf, ret));
+			return ret;
+			}
 
-				const utils::math::geometry::sdf::direction_signed_distance direction_signed_distance{sample_dsdf_callback(coords_f)};
+		/// <summary> Renders all the shapes in a group, each pixel only evaluates the shapes bvh can't rule out. bvh must be created from group, see `group::create_bvh`. </summary>
+		template <bool parallel = true, bool view>
+		utils::matrix<T> render(const utils::math::transform2& camera_transform, const utils::math::vec2s& resolution, const utils::math::geometry::group<view>& group, const utils::math::geometry::bvh& bvh, float supersampling = 1.f)
+			{
+			const auto sample_group{[&group, &bvh](const utils::math::vec2f& coords_f) { return group.direction_signed_distance(coords_f, bvh); }};
+			return render<parallel>(camera_transform, resolution, sample_dsdf_callback{sample_group}, supersampling);
+			}
 
-				T& pixel{ret[index]};
-				pixel = sample(coords_f, direction_signed_distance);
-				}};
+		template <bool view>
+		utils::matrix<T> render(utils::thread_pool& thread_pool, const utils::math::transform2& camera_transform, const utils::math::vec2s& resolution, const utils::math::geometry::group<view>& group, const utils::math::geometry::bvh& bvh, float supersampling = 1.f)
+			{
+			const auto sample_group{[&group, &bvh](const utils::math::vec2f& coords_f) { return group.direction_signed_distance(coords_f, bvh); }};
+			return render(thread_pool, camera_transform, resolution, sample_group, supersampling);
+			}
 
-			std::ranges::iota_view indices(size_t{0}, resolution.sizes_to_size());
-			if constexpr (parallel)
+		private:
+			auto sample_field_callback(const utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& direction_signed_distance_field, utils::matrix<T>& image) const noexcept
 				{
-				std::for_each(std::execution::par, indices.begin(), indices.end(), callback);
+				return [this, &direction_signed_distance_field, &image](size_t index, const utils::math::vec2s&, const utils::math::vec2f& coords_f)
+					{
+					image[index] = sample(coords_f, direction_signed_distance_field[index]);
+					};
 				}
-			else if constexpr (!parallel)
+
+			template <typename sample_dsdf_t>
+			auto sample_dsdf_at_callback(const sample_dsdf_t& sample_dsdf, utils::matrix<T>& image) const noexcept
 				{
-				std::for_each(indices.begin(), indices.end(), callback);
+				return [this, &sample_dsdf, &image](size_t index, const utils::math::vec2s&, const utils::math::vec2f& coords_f)
+					{
+					const utils::math::geometry::sdf::direction_signed_distance direction_signed_distance{sample_dsdf(coords_f)};
+					image[index] = sample(coords_f, direction_signed_distance);
+					};
 				}
-			
-			return ret;
-			}
 		};
 
 	struct debug : renderer<utils::graphics::colour::rgba_f>
@@ -338,72 +320,49 @@ namespace utils::graphics::sdf
 				float supersampling = 1.f
 				) const noexcept
 				{
-				const auto pixels_region_max{direction_signed_distance_field.sizes()};
-				const utils::math::rect<float> pixels_region_f{bounding_box.transform(camera_transform).scale(supersampling)};
-
-				if (pixels_region_f.rr() <  0.f                   || pixels_region_f.dw() <  0.f                  ) { return direction_signed_distance_field; }
-				if (pixels_region_f.ll() >= pixels_region_max.x() || pixels_region_f.up() >= pixels_region_max.y()) { return direction_signed_distance_field; }
-
-				const utils::math::rect<size_t> pixels_region_cast
-					{
-					utils::math::rect<size_t>
-						{
-								 utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.ll())),
-								 utils::math::cast_clamp<size_t>(std::floor(pixels_region_f.up())),
-						std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.rr())), direction_signed_distance_field.sizes().x()),
-						std::min(utils::math::cast_clamp<size_t>(std::ceil (pixels_region_f.dw())), direction_signed_distance_field.sizes().y())
-						}
-					};
-				const utils::math::rect<size_t> pixels_region
-					{
-					utils::math::rect<size_t>
-						{
-								 pixels_region_cast.ll(),
-								 pixels_region_cast.up(),
-						std::min(pixels_region_cast.rr(), pixels_region_max.x()),
-						std::min(pixels_region_cast.dw(), pixels_region_max.y())
-						}
-					};
-				const size_t indices_end{pixels_region.size().sizes_to_size()};
-
-				std::ranges::iota_view indices(size_t{0}, indices_end);
-				const auto callback{[&, this](size_t index)
-					{
-					const utils::math::vec2s coords_indices{pixels_region.ul() + pixels_region.size().index_to_coords(index)};
-					const utils::math::vec2f coords_f
-						{
-						utils::math::vec2f
-							{
-							static_cast<float>(coords_indices.x()),
-							static_cast<float>(coords_indices.y())
-							}
-						.transform(camera_transform)
-						.scale(1.f / supersampling)
-						};
-
-					utils::math::geometry::sdf::direction_signed_distance& value_at_pixel{direction_signed_distance_field[coords_indices]};
-
-					const utils::math::geometry::sdf::direction_signed_distance shape_direction_signed_distance{shape_ptr->sdf(coords_f).direction_signed_distance()};
-					value_at_pixel = merge_callback(value_at_pixel, shape_direction_signed_distance);
-					}};
-		
-				if constexpr (parallel)
-					{
-					std::for_each(std::execution::par, indices.begin(), indices.end(), callback);
-					}
-				else if constexpr (!parallel)
-					{
-					std::for_each(indices.begin(), indices.end(), callback);
-					}
-
+				const utils::graphics::tiles::tiled_region tiled_region{bounding_box_tiles(camera_transform, direction_signed_distance_field.sizes(), supersampling)};
+				tiled_region.execute<parallel>(merge_at_callback(merge_callback, direction_signed_distance_field));
 				return direction_signed_distance_field;
 				}
 
+			/// <summary> Same as evaluate_dsdf, with the tiles covering the shape's bounding box scheduled on thread_pool. </summary>
+			template <typename merge_t>
+			utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& evaluate_dsdf
+				(
+				utils::thread_pool& thread_pool,
+				const utils::math::transform2& camera_transform,
+				const merge_t& merge,
+				utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& direction_signed_distance_field,
+				float supersampling = 1.f
+				) const
+				{
+				const utils::graphics::tiles::tiled_region tiled_region{bounding_box_tiles(camera_transform, direction_signed_distance_field.sizes(), supersampling)};
+				tiled_region.execute(thread_pool, merge_at_callback(merge, direction_signed_distance_field));
+				return direction_signed_distance_field;
+				}
 			utils::math::geometry::shape::aabb get_bounding_box() const noexcept { return bounding_box; }
 			shape_t get_shape() const noexcept { return *shape_ptr; }
 		private:
 			const shape_t* shape_ptr;
 			const utils::math::geometry::shape::aabb bounding_box;
+
+			utils::graphics::tiles::tiled_region bounding_box_tiles(const utils::math::transform2& camera_transform, const utils::math::vec2s& image_sizes, float supersampling) const noexcept
+				{
+				// Bounding boxes entirely outside the image end up as an empty region once clamped.
+				const utils::math::rect<float> pixels_region_f{bounding_box.transform(camera_transform).scale(supersampling)};
+				return {image_sizes, details::pixels_region(pixels_region_f, image_sizes), utils::graphics::tiles::pixel_mapping::create(camera_transform, supersampling)};
+				}
+
+			template <typename merge_t>
+			auto merge_at_callback(const merge_t& merge, utils::matrix<utils::math::geometry::sdf::direction_signed_distance>& direction_signed_distance_field) const noexcept
+				{
+				return [this, &merge, &direction_signed_distance_field](size_t index, const utils::math::vec2s&, const utils::math::vec2f& coords_f)
+					{
+					utils::math::geometry::sdf::direction_signed_distance& value_at_pixel{direction_signed_distance_field[index]};
+					const utils::math::geometry::sdf::direction_signed_distance shape_direction_signed_distance{shape_ptr->sdf(coords_f).direction_signed_distance()};
+					value_at_pixel = merge(value_at_pixel, shape_direction_signed_distance);
+					};
+				}
 		};
 	
 
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <ranges>
+#include <cstddef>
+#include <algorithm>
+#include <execution>
+
+#include "../thread_pool.h"
+#include "../math/vec.h"
+#include "../math/rect.h"
+#include "../math/transform2.h"
+#include "../math/geometry/transform/point.h"
+
+// Tiled traversal of an image region. The region is split in square tiles which are visited one row at a time,
+// so consecutive pixels are consecutive in memory and the few cache lines touched by a tile stay hot until it's done.
+// Sampling coordinates advance by a constant step per pixel instead of transforming every pixel separately.
+
+namespace utils::graphics::tiles
+	{
+	inline constexpr size_t tile_size{32};
+
+	/// <summary> Affine mapping from pixel indices to sampling coordinates, same as transforming each pixel by camera_transform then scaling by 1 / supersampling. </summary>
+	struct pixel_mapping
+		{
+		utils::math::vec2f origin{0.f, 0.f};
+		utils::math::vec2f step_x{1.f, 0.f};
+		utils::math::vec2f step_y{0.f, 1.f};
+
+		static pixel_mapping create(const utils::math::transform2& camera_transform, float supersampling = 1.f) noexcept
+			{
+			const auto map{[&](float x, float y) -> utils::math::vec2f
+				{
+				return utils::math::vec2f{x, y}.transform(camera_transform).scale(1.f / supersampling);
+				}};
+
+			const utils::math::vec2f origin{map(0.f, 0.f)};
+			return pixel_mapping
+				{
+				.origin{origin},
+				.step_x{map(1.f, 0.f) - origin},
+				.step_y{map(0.f, 1.f) - origin}
+				};
+			}
+
+		utils::math::vec2f at(const utils::math::vec2s& coords_indices) const noexcept
+			{
+			return origin + (step_x * static_cast<float>(coords_indices.x())) + (step_y * static_cast<float>(coords_indices.y()));
+			}
+		};
+
+	/// <summary>
+	/// Visits every pixel of region (clamped to image_sizes) calling callback(size_t index, const utils::math::vec2s& coords_indices, const utils::math::vec2f& coords_f),
+	/// where index is the pixel's index in a row-major image of size image_sizes.
+	/// Distinct tiles may be processed concurrently, pixels of the same tile never are.
+	/// </summary>
+	class tiled_region
+		{
+		public:
+			tiled_region(const utils::math::vec2s& image_sizes, const pixel_mapping& mapping) noexcept :
+				tiled_region{image_sizes, utils::math::rect<size_t>{size_t{0}, size_t{0}, image_sizes.x(), image_sizes.y()}, mapping}
+				{}
+
+			tiled_region(const utils::math::vec2s& image_sizes, const utils::math::rect<size_t>& region, const pixel_mapping& mapping) noexcept :
+				image_sizes{image_sizes},
+				region
+					{
+					std::min(region.ll(), image_sizes.x()),
+					std::min(region.up(), image_sizes.y()),
+					std::min(region.rr(), image_sizes.x()),
+					std::min(region.dw(), image_sizes.y())
+					},
+				mapping{mapping},
+				tiles_x{tiles_in(this->region.ll(), this->region.rr())},
+				tiles_y{tiles_in(this->region.up(), this->region.dw())}
+				{}
+
+			size_t tiles_count() const noexcept { return tiles_x * tiles_y; }
+
+			template <typename callback_t>
+			void execute_tile(size_t tile_index, callback_t& callback) const
+				{
+				const size_t ll{region.ll() + ((tile_index % tiles_x) * tile_size)};
+				const size_t up{region.up() + ((tile_index / tiles_x) * tile_size)};
+				const size_t rr{std::min(ll + tile_size, region.rr())};
+				const size_t dw{std::min(up + tile_size, region.dw())};
+
+				for (size_t y{up}; y < dw; y++)
+					{
+					// Start of each row is computed from scratch so rounding errors don't accumulate past one tile width.
+					utils::math::vec2f coords_f{mapping.at({ll, y})};
+					size_t index{(y * image_sizes.x()) + ll};
+
+					for (size_t x{ll}; x < rr; x++, index++)
+						{
+						callback(index, utils::math::vec2s{x, y}, coords_f);
+						coords_f += mapping.step_x;
+						}
+					}
+				}
+
+			template <bool parallel = true, typename callback_t>
+			void execute(callback_t callback) const
+				{
+				const auto tiles_range{std::ranges::iota_view<size_t, size_t>(size_t{0}, tiles_count())};
+				const auto tile_callback{[&](size_t tile_index) { execute_tile(tile_index, callback); }};
+
+				if constexpr (parallel)
+					{
+					std::for_each(std::execution::par, tiles_range.begin(), tiles_range.end(), tile_callback);
+					}
+				else if constexpr (!parallel)
+					{
+					std::for_each(std::execution::seq, tiles_range.begin(), tiles_range.end(), tile_callback);
+					}
+				}
+
+			/// <summary> Schedules the tiles on thread_pool and waits for them. Called from one of thread_pool's own workers it runs inline instead, blocking a worker on its own pool could deadlock. </summary>
+			template <typename callback_t>
+			void execute(utils::thread_pool& thread_pool, callback_t callback) const
+				{
+				if (tiles_count() == 0) { return; }
+				if (thread_pool.is_worker_thread())
+					{
+					execute<false>(callback);
+					return;
+					}
+
+				// A few blocks per thread, rows of tiles can differ a lot in cost (empty space vs shapes edges).
+				const size_t blocks_count{std::min(tiles_count(), static_cast<size_t>(thread_pool.get_thread_count()) * 4)};
+				thread_pool.parallelize_loop(size_t{0}, tiles_count(), [this, &callback](size_t begin, size_t end)
+					{
+					for (size_t tile_index{begin}; tile_index < end; tile_index++) { execute_tile(tile_index, callback); }
+					}, blocks_count).wait();
+				}
+
+		private:
+			utils::math::vec2s image_sizes;
+			utils::math::rect<size_t> region;
+			pixel_mapping mapping;
+			size_t tiles_x;
+			size_t tiles_y;
+
+			static constexpr size_t tiles_in(size_t begin, size_t end) noexcept { return end > begin ? (end - begin + tile_size - 1) / tile_size : 0; }
+		};
+	}
\ No newline at end of file
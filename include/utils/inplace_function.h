@@ -0,0 +1,100 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+// Move-only callable wrapper that never allocates: the callable is stored inline and must fit in "capacity" bytes.
+// Oversized callables are a compile time error rather than a silent heap allocation.
+
+namespace utils
+	{
+	template <typename signature, size_t capacity = 64, size_t alignment = alignof(std::max_align_t)>
+	class inplace_function;
+
+	template <typename R, typename ...Args, size_t capacity, size_t alignment>
+	class inplace_function<R(Args...), capacity, alignment>
+		{
+		private:
+			struct vtable_t
+				{
+				R    (*invoke )(void* storage, Args&&... args);
+				void (*move   )(void* destination, void* source) noexcept;
+				void (*destroy)(void* storage) noexcept;
+				};
+
+			template <typename F>
+			inline static constexpr vtable_t vtable_for
+				{
+				.invoke  {[](void* storage, Args&&... args) -> R { return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...); }},
+				.move    {[](void* destination, void* source) noexcept { ::new (destination) F{std::move(*static_cast<F*>(source))}; static_cast<F*>(source)->~F(); }},
+				.destroy {[](void* storage) noexcept { static_cast<F*>(storage)->~F(); }}
+				};
+
+		public:
+			template <typename F>
+			inline static constexpr bool fits
+				{
+				sizeof (std::decay_t<F>) <= capacity  &&
+				alignof(std::decay_t<F>) <= alignment &&
+				std::is_nothrow_move_constructible_v<std::decay_t<F>>
+				};
+
+			inplace_function() noexcept = default;
+			inplace_function(std::nullptr_t) noexcept {}
+
+			template <typename F>
+				requires(!std::same_as<std::decay_t<F>, inplace_function> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+			inplace_function(F&& callable) { emplace(std::forward<F>(callable)); }
+
+			inplace_function(inplace_function&& move) noexcept { move_from(move); }
+			inplace_function& operator=(inplace_function&& move) noexcept
+				{
+				if (this != &move) { reset(); move_from(move); }
+				return *this;
+				}
+
+			inplace_function(const inplace_function& copy) = delete;
+			inplace_function& operator=(const inplace_function& copy) = delete;
+
+			inplace_function& operator=(std::nullptr_t) noexcept { reset(); return *this; }
+
+			~inplace_function() { reset(); }
+
+			template <typename F>
+			void emplace(F&& callable)
+				{
+				using callable_t = std::decay_t<F>;
+				static_assert(fits<callable_t>, "Callable does not fit in the inplace_function storage.");
+
+				reset();
+				::new (static_cast<void*>(&storage)) callable_t{std::forward<F>(callable)};
+				vtable = &vtable_for<callable_t>;
+				}
+
+			void reset() noexcept
+				{
+				if (vtable) { vtable->destroy(&storage); vtable = nullptr; }
+				}
+
+			R operator()(Args... args) { return vtable->invoke(&storage, std::forward<Args>(args)...); }
+
+			explicit operator bool() const noexcept { return vtable != nullptr; }
+
+		private:
+			const vtable_t* vtable{nullptr};
+			alignas(alignment) std::byte storage[capacity];
+
+			void move_from(inplace_function& other) noexcept
+				{
+				if (other.vtable)
+					{
+					other.vtable->move(&storage, &other.storage);
+					vtable = other.vtable;
+					other.vtable = nullptr;
+					}
+				}
+		};
+	}
\ No newline at end of file
@@ -0,0 +1,599 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <mutex>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <format>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <concepts>
+#include <string_view>
+#include <type_traits>
+#include <condition_variable>
+
+#include "message.h"
+#include "../console/colour.h"
+#include "../oop/disable_move_copy.h"
+
+// High throughput alternative to logger<message<...>>.
+// Producers never allocate nor lock: each thread serializes a compact binary record (timestamp, type, indent, format string, arguments)
+// into its own single producer single consumer ring buffer. The consumer thread merges the rings by timestamp, formats the records
+// and outputs them in large batches, flushing when the batch exceeds flush_size or every flush_interval.
+// Format strings are checked at compile time like std::format; string-like arguments are copied into the record, any other argument must be trivially copyable.
+
+namespace utils::logging
+	{
+	namespace details::async_logger
+		{
+		template <typename T>
+		concept stringlike_argument = std::convertible_to<const T&, std::string_view>;
+
+		template <typename T>
+		concept storable_argument = stringlike_argument<std::remove_cvref_t<T>> || std::is_trivially_copyable_v<std::remove_cvref_t<T>>;
+
+		template <typename T>
+		using stored_argument_t = std::conditional_t<stringlike_argument<std::remove_cvref_t<T>>, std::string_view, std::remove_cvref_t<T>>;
+
+		template <typename T>
+		size_t argument_size(const T& argument) noexcept
+			{
+			if constexpr (stringlike_argument<T>) { return sizeof(std::uint32_t) + std::string_view{argument}.size(); }
+			else { return sizeof(T); }
+			}
+
+		template <typename T>
+		std::byte* write_argument(std::byte* destination, const T& argument) noexcept
+			{
+			if constexpr (stringlike_argument<T>)
+				{
+				const std::string_view string{argument};
+				const std::uint32_t size{static_cast<std::uint32_t>(string.size())};
+				std::memcpy(destination, &size, sizeof(size));
+				std::memcpy(destination + sizeof(size), string.data(), size);
+				return destination + sizeof(size) + size;
+				}
+			else
+				{
+				std::memcpy(destination, std::addressof(argument), sizeof(T));
+				return destination + sizeof(T);
+				}
+			}
+
+		/// <summary> Strings are returned as views into the ring buffer, valid until the record is released. </summary>
+		template <typename T>
+		T read_argument(const std::byte*& source) noexcept
+			{
+			if constexpr (std::same_as<T, std::string_view>)
+				{
+				std::uint32_t size;
+				std::memcpy(&size, source, sizeof(size));
+				const std::string_view ret{reinterpret_cast<const char*>(source + sizeof(size)), size};
+				source += sizeof(size) + size;
+				return ret;
+				}
+			else
+				{
+				std::array<std::byte, sizeof(T)> bytes;
+				std::memcpy(bytes.data(), source, sizeof(T));
+				source += sizeof(T);
+				return std::bit_cast<T>(bytes);
+				}
+			}
+
+		using format_arguments_t = void(*)(std::string& output, std::string_view format, const std::byte* arguments);
+
+		template <typename ...stored_t>
+		void format_arguments(std::string& output, std::string_view format, const std::byte* arguments)
+			{
+			// Braced initialization guarantees left to right evaluation.
+			std::tuple<stored_t...> values{read_argument<stored_t>(arguments)...};
+			std::apply([&](const auto&... values) { std::vformat_to(std::back_inserter(output), format, std::make_format_args(values...)); }, values);
+			}
+
+		struct record_header
+			{
+			// Size of the whole record including the header, 0 marks the unused tail of the ring before it wraps around.
+			std::uint32_t size;
+			msg_t type;
+			std::uint16_t indent;
+			std::int64_t timestamp;
+			std::string_view format;
+			format_arguments_t format_arguments;
+			};
+
+		inline static constexpr size_t record_alignment{alignof(record_header)};
+		constexpr size_t aligned_record_size(size_t size) noexcept { return (size + record_alignment - 1) & ~(record_alignment - 1); }
+
+		class ring_t : utils::oop::non_copyable, utils::oop::non_movable
+			{
+			public:
+				ring_t(size_t capacity) : capacity{std::bit_ceil(std::max(capacity, record_alignment * 64))}, mask{this->capacity - 1}, data{std::make_unique<std::byte[]>(this->capacity)} {}
+
+				size_t size() const noexcept { return capacity; }
+
+				/// <summary> Producer only. Returns nullptr if the ring doesn't have enough free space at the moment. </summary>
+				std::byte* try_reserve(size_t record_size) noexcept
+					{
+					const size_t offset    {static_cast<size_t>(write_position) & mask};
+					const size_t contiguous{capacity - offset};
+					const size_t required  {record_size <= contiguous ? record_size : contiguous + record_size};
+
+					if (capacity - (write_position - cached_read_position) < required)
+						{
+						cached_read_position = read_position.load(std::memory_order_acquire);
+						if (capacity - (write_position - cached_read_position) < required) { return nullptr; }
+						}
+
+					if (record_size > contiguous)
+						{
+						const std::uint32_t wrap_marker{0};
+						std::memcpy(data.get() + offset, &wrap_marker, sizeof(wrap_marker));
+						write_position += contiguous;
+						}
+					return data.get() + (static_cast<size_t>(write_position) & mask);
+					}
+
+				/// <summary> Producer only. Returns the amount of bytes in use. </summary>
+				size_t commit(size_t record_size) noexcept
+					{
+					write_position += record_size;
+					published_write_position.store(write_position, std::memory_order_release);
+					return static_cast<size_t>(write_position - cached_read_position);
+					}
+
+				/// <summary> Consumer only. </summary>
+				std::uint64_t readable_end() const noexcept { return published_write_position.load(std::memory_order_acquire); }
+
+				/// <summary> Consumer only. Skips the wrap marker if there's one at position. </summary>
+				std::uint64_t skip_wrap(std::uint64_t position) const noexcept
+					{
+					const size_t offset{static_cast<size_t>(position) & mask};
+					std::uint32_t size;
+					std::memcpy(&size, data.get() + offset, sizeof(size));
+					return size == 0 ? position + (capacity - offset) : position;
+					}
+
+				/// <summary> Consumer only. position must not point to a wrap marker. </summary>
+				record_header header_at(std::uint64_t position) const noexcept
+					{
+					record_header ret;
+					std::memcpy(&ret, data.get() + (static_cast<size_t>(position) & mask), sizeof(ret));
+					return ret;
+					}
+				const std::byte* arguments_at(std::uint64_t position) const noexcept { return data.get() + (static_cast<size_t>(position) & mask) + sizeof(record_header); }
+
+				/// <summary> Consumer only. Gives the space up to position back to the producer. </summary>
+				void release(std::uint64_t position) noexcept { read_position.store(position, std::memory_order_release); }
+				std::uint64_t consumed() const noexcept { return read_position.load(std::memory_order_relaxed); }
+
+				/// <summary> Set by the logger's destructor, the producer thread then drops its reference the next time it registers a ring. </summary>
+				void orphan() noexcept { orphaned.store(true, std::memory_order_relaxed); }
+				bool is_orphaned() const noexcept { return orphaned.load(std::memory_order_relaxed); }
+
+			private:
+				size_t capacity;
+				size_t mask;
+				std::unique_ptr<std::byte[]> data;
+
+				alignas(64) std::uint64_t write_position{0};
+				std::uint64_t cached_read_position{0};
+				alignas(64) std::atomic<std::uint64_t> published_write_position{0};
+				alignas(64) std::atomic<std::uint64_t> read_position{0};
+				std::atomic_bool orphaned{false};
+			};
+		}
+
+	template <output_style_t OUTPUT_STYLE = output_style_t::on_line>
+	class async_logger : utils::oop::non_copyable, utils::oop::non_movable
+		{
+		public:
+			inline static constexpr output_style_t output_style = OUTPUT_STYLE;
+
+			struct create_info
+				{
+				std::string file_name{"log.txt"};
+				bool output_console{true};
+				/// <summary> Per producer thread, in bytes. A producer whose ring is full waits for the consumer. </summary>
+				size_t ring_size{size_t{1} << 20};
+				/// <summary> Formatted bytes accumulated before they're written out. </summary>
+				size_t flush_size{size_t{1} << 16};
+				std::chrono::milliseconds flush_interval{100};
+				};
+
+			async_logger() : async_logger(create_info{}) {}
+			async_logger(const create_info& create_info) :
+				file          {create_info.file_name     },
+				output_console{create_info.output_console},
+				ring_size     {create_info.ring_size     },
+				flush_size    {create_info.flush_size    },
+				flush_interval{create_info.flush_interval},
+				thread        {&async_logger::consumer, this}
+				{}
+
+			~async_logger()
+				{
+				running = false;
+				wake_consumer();
+				thread.join();
+
+				// Threads outliving the logger still hold its rings in thread_rings.
+				for (const auto& ring : consumer_rings) { ring->orphan(); }
+				std::scoped_lock lock{rings_mutex};
+				for (const auto& ring : registered_rings) { ring->orphan(); }
+				}
+
+#pragma region Push messages begin
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void raw(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::raw, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void inf(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::inf, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void log(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::log, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void dgn(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::dgn, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void err(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::err, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void wrn(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::wrn, format.get(), args...); }
+			template <typename ...Args> requires(details::async_logger::storable_argument<Args> && ...) void suc(std::format_string<Args...> format, Args&&... args) noexcept { push(msg_t::suc, format.get(), args...); }
+
+			/// <summary> Blocks until everything pushed before the call has been written out. </summary>
+			void flush()
+				{
+				std::unique_lock lock{mutex};
+				const std::uint64_t generation{++flush_requested};
+				consumer_wake_requested = true;
+				consumer_cv.notify_one();
+				flush_done_cv.wait(lock, [&] { return flush_completed >= generation; });
+				}
+
+			/// <summary> Records that didn't fit in an empty ring buffer. </summary>
+			size_t get_dropped_count() const noexcept { return dropped_count.load(); }
+#pragma endregion Push messages end
+
+#pragma region Indent management begin
+		private:
+			class section_marker : utils::oop::non_copyable, utils::oop::non_movable
+				{
+				private:
+					friend class async_logger<OUTPUT_STYLE>;
+					section_marker(async_logger<OUTPUT_STYLE>& logger, std::string_view name) : logger_ptr{&logger}, name{name}, time{std::chrono::system_clock::now()}
+						{
+						logger.push(msg_t::section_enter, "{}", name);
+						logger.indents_count++;
+						}
+
+					async_logger<OUTPUT_STYLE>* logger_ptr{nullptr};
+					std::string_view name;
+					std::chrono::time_point<std::chrono::system_clock> time;
+
+				public:
+					~section_marker() noexcept
+						{
+						const std::chrono::system_clock::duration delta_time{std::chrono::system_clock::now() - time};
+						logger_ptr->indents_count--;
+						logger_ptr->push(msg_t::section_leave, "{}, duration: {:%T}", name, delta_time);
+						}
+
+					operator bool() const noexcept { return true; }
+				};
+
+		public:
+			/// <summary> name must outlive the section. </summary>
+			[[nodiscard]] section_marker section(std::string_view name) noexcept { return section_marker{*this, name}; }
+#pragma endregion Indent management end
+
+		private:
+			using ring_t = details::async_logger::ring_t;
+			using header_t = details::async_logger::record_header;
+
+			struct thread_ring_t
+				{
+				std::uint64_t logger_id;
+				std::shared_ptr<ring_t> ring;
+				};
+			// Identified by id rather than address, a new logger may be constructed where a destroyed one used to be.
+			inline static thread_local std::vector<thread_ring_t> thread_rings;
+			inline static std::atomic<std::uint64_t> next_logger_id{0};
+
+			const std::uint64_t id{next_logger_id++};
+
+			std::ofstream file;
+			const bool output_console;
+			const size_t ring_size;
+			const size_t flush_size;
+			const std::chrono::milliseconds flush_interval;
+			size_t indents_count{0};
+
+			std::mutex rings_mutex;
+			std::vector<std::shared_ptr<ring_t>> registered_rings;
+			std::atomic_bool rings_changed{false};
+
+			std::atomic<size_t> dropped_count{0};
+
+			std::mutex mutex;
+			std::condition_variable consumer_cv;
+			std::condition_variable flush_done_cv;
+			std::atomic_bool consumer_sleeping{false};
+			bool consumer_wake_requested{false};
+			std::atomic<std::uint64_t> flush_requested{0};
+			std::uint64_t flush_completed{0};
+
+			std::atomic_bool running{true};
+
+#pragma region Producer
+			ring_t& local_ring()
+				{
+				for (const auto& thread_ring : thread_rings)
+					{
+					if (thread_ring.logger_id == id) { return *thread_ring.ring; }
+					}
+
+				// First message from this thread, the only allocations a producer thread ever does.
+				// Also the point where the thread lets go of the rings of loggers destroyed since.
+				std::erase_if(thread_rings, [](const thread_ring_t& thread_ring) { return thread_ring.ring->is_orphaned(); });
+				auto ring{std::make_shared<ring_t>(ring_size)};
+				if (true)
+					{
+					std::scoped_lock lock{rings_mutex};
+					registered_rings.push_back(ring);
+					rings_changed = true;
+					}
+				thread_rings.push_back({id, ring});
+				return *ring;
+				}
+
+			template <typename ...Args>
+			void push(msg_t type, std::string_view format, const Args&... args) noexcept
+				{
+				namespace record = details::async_logger;
+
+				const size_t record_size{record::aligned_record_size((sizeof(header_t) + ... + record::argument_size(args)))};
+
+				ring_t* ring_ptr{nullptr};
+				try { ring_ptr = &local_ring(); }
+				catch (...) { dropped_count++; return; }
+				ring_t& ring{*ring_ptr};
+
+				if (record_size > ring.size() / 2) { dropped_count++; return; }
+
+				std::byte* destination{nullptr};
+				while (!(destination = ring.try_reserve(record_size)))
+					{
+					wake_consumer();
+					std::this_thread::yield();
+					}
+
+				const header_t header
+					{
+					.size            {static_cast<std::uint32_t>(record_size)},
+					.type            {type},
+					.indent          {static_cast<std::uint16_t>(indents_count)},
+					.timestamp       {std::chrono::system_clock::now().time_since_epoch().count()},
+					.format          {format},
+					.format_arguments{&record::format_arguments<record::stored_argument_t<Args>...>}
+					};
+				std::memcpy(destination, &header, sizeof(header));
+
+				std::byte* arguments{destination + sizeof(header)};
+				((arguments = record::write_argument(arguments, args)), ...);
+
+				// The consumer polls every flush_interval anyway, it's only woken early when a ring is filling up.
+				if (ring.commit(record_size) > ring.size() / 2) { wake_consumer(); }
+				}
+
+			void wake_consumer() noexcept
+				{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (consumer_sleeping.load())
+					{
+					std::scoped_lock lock{mutex};
+					consumer_wake_requested = true;
+					consumer_cv.notify_one();
+					}
+				}
+#pragma endregion Producer
+
+#pragma region Consumer
+			struct cursor_t
+				{
+				ring_t* ring;
+				std::uint64_t position;
+				std::uint64_t end;
+				header_t header;
+
+				bool empty() const noexcept { return position == end; }
+				void load_header() noexcept
+					{
+					if (empty()) { return; }
+					position = ring->skip_wrap(position);
+					if (!empty()) { header = ring->header_at(position); }
+					}
+				};
+
+			std::vector<std::shared_ptr<ring_t>> consumer_rings;
+			std::vector<cursor_t> cursors;
+			std::string formatted;
+			std::array<std::string, 9> type_prefixes;
+			std::string timestamp_prefix;
+
+			void consumer()
+				{
+				std::string output;
+				output.reserve(flush_size * 2);
+				formatted.reserve(1024);
+				prepare_type_prefixes();
+
+				auto last_write{std::chrono::steady_clock::now()};
+
+				while (true)
+					{
+					const std::uint64_t flush_generation{flush_requested.load()};
+					const bool stopping{!running.load()};
+
+					drain(output);
+
+					const auto now{std::chrono::steady_clock::now()};
+					const bool flush_pending{flush_generation != flush_completed};
+					if (output.size() >= flush_size || now - last_write >= flush_interval || flush_pending || stopping)
+						{
+						write_out(output);
+						last_write = now;
+						}
+
+					if (flush_pending)
+						{
+						std::scoped_lock lock{mutex};
+						flush_completed = flush_generation;
+						flush_done_cv.notify_all();
+						}
+
+					if (stopping) { break; }
+
+					consumer_sleeping = true;
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (true)
+						{
+						std::unique_lock lock{mutex};
+						consumer_cv.wait_for(lock, flush_interval - (std::chrono::steady_clock::now() - last_write), [&]
+							{
+							return consumer_wake_requested || !running || flush_requested.load() != flush_completed;
+							});
+						consumer_wake_requested = false;
+						}
+					consumer_sleeping = false;
+					}
+				}
+
+			void drain(std::string& output)
+				{
+				if (rings_changed.exchange(false))
+					{
+					std::scoped_lock lock{rings_mutex};
+					for (auto& ring : registered_rings) { consumer_rings.push_back(std::move(ring)); }
+					registered_rings.clear();
+					}
+
+				cursors.clear();
+				for (const auto& ring : consumer_rings)
+					{
+					cursor_t cursor{.ring{ring.get()}, .position{ring->consumed()}, .end{ring->readable_end()}};
+					cursor.load_header();
+					if (!cursor.empty()) { cursors.push_back(cursor); }
+					}
+
+				// K-way merge by timestamp, the rings are individually sorted already.
+				while (!cursors.empty())
+					{
+					size_t oldest{0};
+					for (size_t i = 1; i < cursors.size(); i++)
+						{
+						if (cursors[i].header.timestamp < cursors[oldest].header.timestamp) { oldest = i; }
+						}
+
+					cursor_t& cursor{cursors[oldest]};
+					output_record(output, cursor.header, cursor.ring->arguments_at(cursor.position));
+
+					cursor.position += cursor.header.size;
+					cursor.ring->release(cursor.position);
+					cursor.load_header();
+					if (cursor.empty()) { cursors.erase(cursors.begin() + oldest); }
+					}
+
+				// Rings owned only by the logger belong to threads that terminated.
+				std::erase_if(consumer_rings, [](const std::shared_ptr<ring_t>& ring) { return ring.use_count() == 1 && ring->consumed() == ring->readable_end(); });
+				}
+
+			void write_out(std::string& output)
+				{
+				if (output.empty()) { return; }
+				if (output_console) { std::cout.write(output.data(), output.size()).flush(); }
+				file.write(output.data(), output.size()).flush();
+				output.clear();
+				}
+
+			void prepare_type_prefixes()
+				{
+				for (size_t i = 0; i < type_prefixes.size(); i++)
+					{
+					const msg_t type{static_cast<msg_t>(i)};
+					std::string& prefix{type_prefixes[i]};
+					prefix += utils::console::colour::to_string(utils::console::colour::background{utils::console::colour::colour_8::dark  (out_type_colour(type))});
+					prefix += utils::console::colour::to_string(utils::console::colour::foreground{utils::console::colour::colour_8::bright(utils::graphics::colour::base::white)});
+					prefix += output_style == output_style_t::on_line ? out_type(type) : out_type_verbose(type);
+					prefix += utils::console::colour::restore_defaults;
+					}
+				timestamp_prefix = utils::console::colour::to_string(utils::console::colour::foreground{utils::console::colour::colour_8::dark(utils::graphics::colour::base::white)});
+				}
+
+			static void output_indent(std::string& output, size_t indent) { output.append(indent * 4, ' '); }
+
+			// Same layout as message<output_style>'s operator<<.
+			void output_record(std::string& output, const header_t& header, const std::byte* arguments)
+				{
+				formatted.clear();
+				try { header.format_arguments(formatted, header.format, arguments); }
+				catch (const std::exception& exception) { formatted = "[Formatting failed: "; formatted += exception.what(); formatted += "]"; }
+
+				if (header.type == msg_t::raw) { output += formatted; return; }
+
+				constexpr size_t timestamp_digits{std::numeric_limits<std::int64_t>::digits10};
+				const std::string& prefix{type_prefixes[static_cast<size_t>(header.type)]};
+
+				if constexpr (output_style == output_style_t::tag_as_separator)
+					{
+					output_indent(output, header.indent);
+					output += "_________________________________\n";
+					output_indent(output, header.indent);
+					output += ' ';
+					output += prefix;
+					output.append(12 - out_type_verbose(header.type).length(), ' ');
+					std::format_to(std::back_inserter(output), " {:>{}}\n", header.timestamp, timestamp_digits);
+					}
+
+				bool first_line{true};
+				size_t index_beg{0};
+				while (index_beg < formatted.size())
+					{
+					size_t index_end{formatted.find_first_of('\n', index_beg)};
+					if (index_end == std::string::npos) { index_end = formatted.size(); }
+					else { index_end++; }
+
+					output_indent(output, header.indent);
+
+					if constexpr (output_style == output_style_t::on_line)
+						{
+						output += ' ';
+						output += prefix;
+						output += ' ';
+						if (first_line)
+							{
+							output += timestamp_prefix;
+							std::format_to(std::back_inserter(output), "{:>{}}", header.timestamp, timestamp_digits);
+							output += utils::console::colour::restore_defaults;
+							first_line = false;
+							}
+						else
+							{
+							output.append(timestamp_digits - 1, ' ');
+							output += '|';
+							}
+						}
+
+					output += ' ';
+					output.append(formatted, index_beg, index_end - index_beg);
+					index_beg = index_end;
+					}
+				output += '\n';
+				}
+#pragma endregion Consumer
+
+			// Last, the consumer thread must start after everything else has been constructed.
+			std::thread thread;
+		};
+	}
\ No newline at end of file
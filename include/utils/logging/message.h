@@ -16,6 +16,52 @@ namespace utils::logging
 	enum class output_style_t { on_line, tag_as_separator };
 	enum class msg_t { raw, log, dgn, inf, wrn, err, suc, section_enter, section_leave };
 
+	constexpr std::string_view out_type(msg_t type) noexcept
+		{
+		switch (type)
+			{
+			case msg_t::log          : return "[LOG]";
+			case msg_t::dgn          : return "[DGN]";
+			case msg_t::inf          : return "[INF]";
+			case msg_t::wrn          : return "[WRN]";
+			case msg_t::err          : return "[ERR]";
+			case msg_t::suc          : return "[SUC]";
+			case msg_t::section_enter: return " >>> ";
+			case msg_t::section_leave: return " <<< ";
+			default: return "[This error code should be impossible to get]";
+			}
+		}
+	constexpr std::string_view out_type_verbose(msg_t type) noexcept
+		{
+		switch (type)
+			{
+			case msg_t::log          : return "[LOG]"       ;
+			case msg_t::dgn          : return "[DIAGNOSTIC]";
+			case msg_t::inf          : return "[INFO]"      ;
+			case msg_t::wrn          : return "[WARNING]"   ;
+			case msg_t::err          : return "[ERROR]"     ;
+			case msg_t::suc          : return "[SUCCEEDED]" ;
+			case msg_t::section_enter: return " >>> ";
+			case msg_t::section_leave: return " <<< ";
+			default: return "[This error code should be impossible to get]";
+			}
+		}
+	constexpr utils::graphics::colour::base out_type_colour(msg_t type) noexcept
+		{
+		switch (type)
+			{
+			case msg_t::log          : return utils::graphics::colour::base::white  ;
+			case msg_t::dgn          : return utils::graphics::colour::base::magenta;
+			case msg_t::inf          : return utils::graphics::colour::base::cyan   ;
+			case msg_t::wrn          : return utils::graphics::colour::base::yellow ;
+			case msg_t::err          : return utils::graphics::colour::base::red    ;
+			case msg_t::suc          : return utils::graphics::colour::base::green  ;
+			case msg_t::section_enter: return utils::graphics::colour::base::green  ;
+			case msg_t::section_leave: return utils::graphics::colour::base::green  ;
+			default                  : return utils::graphics::colour::base::red    ;
+			}
+		}
+
 	template <output_style_t OUTPUT_STYLE>
 	class message
 		{
@@ -37,51 +83,9 @@ namespace utils::logging
 			static constexpr message section_enter(const string::concepts::stringlike auto& string = "", size_t indents_count = 0) noexcept { return {msg_t::section_enter, string, indents_count}; }
 			static constexpr message section_leave(const string::concepts::stringlike auto& string = "", size_t indents_count = 0) noexcept { return {msg_t::section_leave, string, indents_count}; }
 
-			constexpr std::string_view out_type() const noexcept
-				{
-				switch (type)
-					{
-					case msg_t::log          : return "[LOG]";
-					case msg_t::dgn          : return "[DGN]";
-					case msg_t::inf          : return "[INF]";
-					case msg_t::wrn          : return "[WRN]";
-					case msg_t::err          : return "[ERR]";
-					case msg_t::suc          : return "[SUC]";
-					case msg_t::section_enter: return " >>> ";
-					case msg_t::section_leave: return " <<< ";
-					default: return "[This error code should be impossible to get]";
-					}
-				}
-			constexpr std::string_view out_type_verbose() const noexcept
-				{
-				switch (type)
-					{
-					case msg_t::log          : return "[LOG]"       ;
-					case msg_t::dgn          : return "[DIAGNOSTIC]";
-					case msg_t::inf          : return "[INFO]"      ;
-					case msg_t::wrn          : return "[WARNING]"   ;
-					case msg_t::err          : return "[ERROR]"     ;
-					case msg_t::suc          : return "[SUCCEEDED]" ;
-					case msg_t::section_enter: return " >>> ";
-					case msg_t::section_leave: return " <<< ";
-					default: return "[This error code should be impossible to get]";
-					}
-				}
-			constexpr utils::graphics::colour::base out_type_colour() const noexcept
-				{
-				switch (type)
-					{
-					case msg_t::log          : return utils::graphics::colour::base::white  ;
-					case msg_t::dgn          : return utils::graphics::colour::base::magenta;
-					case msg_t::inf          : return utils::graphics::colour::base::cyan   ;
-					case msg_t::wrn          : return utils::graphics::colour::base::yellow ;
-					case msg_t::err          : return utils::graphics::colour::base::red    ;
-					case msg_t::suc          : return utils::graphics::colour::base::green  ;
-					case msg_t::section_enter: return utils::graphics::colour::base::green  ;
-					case msg_t::section_leave: return utils::graphics::colour::base::green  ;
-					default                  : return utils::graphics::colour::base::red    ;
-					}
-				}
+			constexpr std::string_view              out_type        () const noexcept { return utils::logging::out_type        (type); }
+			constexpr std::string_view              out_type_verbose() const noexcept { return utils::logging::out_type_verbose(type); }
+			constexpr utils::graphics::colour::base out_type_colour () const noexcept { return utils::logging::out_type_colour (type); }
 
 			constexpr std::chrono::time_point<std::chrono::system_clock> get_timestamp() const noexcept { return time; }
 
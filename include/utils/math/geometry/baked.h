@@ -0,0 +1,310 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "all.h"
+#include "bvh.h"
+#include "sdf/batch.h"
+
+// Opt-in cached form of mixed and polyline shapes, for shapes that are queried many more times than they are edited.
+// mixed::get_pieces and polyline::get_edges rebuild every piece from the raw vertices on each call, and the sdf then recomputes each piece's derived data per query.
+// baked keeps, per piece, the sdf::batch::prepared data, the bounding box and the length, plus a bvh over the pieces.
+// The cache is rebuilt on the first query after edit() or invalidate(). Rebuilding happens inside const queries, so call bake() before sharing a freshly edited shape across threads.
+
+namespace utils::math::geometry
+	{
+	template <typename SHAPE>
+		requires(shape::concepts::mixed<SHAPE> || shape::concepts::polyline<SHAPE>)
+	class baked
+		{
+		public:
+			using shape_t = SHAPE;
+			static_assert(shape_t::ends.is_finite(), "Baked shapes only support finite or closed ends.");
+
+			enum class piece_type_t : uint8_t { segment, bezier_3pt, bezier_4pt, bezier };
+			struct piece_t
+				{
+				piece_type_t type;
+				/// <summary> Index in the container of the piece's type. </summary>
+				size_t index;
+				size_t first_vertex_index;
+				size_t last_vertex_index;
+				};
+
+			baked(const shape_t& shape) : shape{shape} {}
+			baked(shape_t&& shape) noexcept : shape{std::move(shape)} {}
+
+			// The cached beziers don't refer to the shape's vertices, but rebuilding on copy keeps copies cheap and independent.
+			baked(const baked& copy) : shape{copy.shape} {}
+			baked& operator=(const baked& copy) { shape = copy.shape; invalidate(); return *this; }
+			baked(baked&& move) noexcept = default;
+			baked& operator=(baked&& move) noexcept = default;
+
+			const shape_t& get() const noexcept { return shape; }
+
+			/// <summary> Access to the shape for editing, the cache will be rebuilt by the next query. </summary>
+			shape_t& edit() noexcept { invalidate(); return shape; }
+
+			void invalidate() noexcept { dirty = true; }
+
+			/// <summary> Rebuilds the cache now if the shape was edited since it was last built. </summary>
+			const baked& bake() const
+				{
+				if (dirty) { rebuild(); }
+				return *this;
+				}
+
+			const std::vector<piece_t    >& get_pieces        () const { return bake().cache.pieces        ; }
+			const std::vector<shape::aabb>& get_bounding_boxes() const { return bake().cache.bounding_boxes; }
+			const std::vector<float      >& get_lengths       () const { return bake().cache.lengths       ; }
+			const geometry::bvh&            get_bvh           () const { return bake().cache.bvh           ; }
+
+			shape::aabb bounding_box() const { return bake().cache.bounding_box; }
+			float       length      () const { return bake().cache.length      ; }
+
+			struct sdf_proxy;
+			sdf_proxy sdf(const vec2f& point) const { bake(); return {*this, point}; }
+
+		private:
+			shape_t shape;
+
+			struct cache_t
+				{
+				std::vector<piece_t> pieces;
+				std::vector<sdf::batch::prepared<shape::segment   >> segments;
+				std::vector<sdf::batch::prepared<shape::bezier<3>>> beziers_3pt;
+				std::vector<sdf::batch::prepared<shape::bezier<4>>> beziers_4pt;
+				/// <summary> Parallel to pieces. </summary>
+				std::vector<shape::aabb> bounding_boxes;
+				/// <summary> Parallel to pieces. </summary>
+				std::vector<float> lengths;
+				shape::aabb bounding_box{shape::aabb::create::inverse_infinite()};
+				float length{0.f};
+				geometry::bvh bvh;
+				};
+			mutable cache_t cache;
+			mutable bool dirty{true};
+
+			void rebuild() const
+				{
+				cache = cache_t{};
+
+				const auto add{[this](const auto& piece, piece_type_t type, size_t index, size_t first_vertex_index, size_t last_vertex_index)
+					{
+					cache.pieces.push_back(piece_t{.type{type}, .index{index}, .first_vertex_index{first_vertex_index}, .last_vertex_index{last_vertex_index}});
+					cache.bounding_boxes.push_back(piece.bounding_box());
+					cache.lengths.push_back(piece.length());
+					cache.bounding_box.merge_self(cache.bounding_boxes.back());
+					cache.length += cache.lengths.back();
+					}};
+
+				if constexpr (shape::concepts::mixed<shape_t>)
+					{
+					shape.get_pieces().for_each([&](const auto& piece, size_t first_vertex_index, size_t last_vertex_index)
+						{
+						using piece_shape_t = std::remove_cvref_t<decltype(piece)>;
+						if constexpr (shape::concepts::ab<piece_shape_t>)
+							{
+							add(piece, piece_type_t::segment, cache.segments.size(), first_vertex_index, last_vertex_index);
+							cache.segments.emplace_back(piece);
+							}
+						else if constexpr (piece_shape_t::extent == 3)
+							{
+							add(piece, piece_type_t::bezier_3pt, cache.beziers_3pt.size(), first_vertex_index, last_vertex_index);
+							cache.beziers_3pt.emplace_back(piece);
+							}
+						else if constexpr (piece_shape_t::extent == 4)
+							{
+							add(piece, piece_type_t::bezier_4pt, cache.beziers_4pt.size(), first_vertex_index, last_vertex_index);
+							cache.beziers_4pt.emplace_back(piece);
+							}
+						else
+							{
+							// Arbitrary degree curves have nothing worth precomputing, they are rebuilt from the vertices on query like mixed::get_pieces does.
+							add(piece, piece_type_t::bezier, 0, first_vertex_index, last_vertex_index);
+							}
+						});
+					}
+				else
+					{
+					const size_t vertices_count{shape.vertices.size()};
+					shape.get_edges().for_each([&](const auto& edge, size_t index)
+						{
+						add(edge, piece_type_t::segment, cache.segments.size(), index, (index + 1) % vertices_count);
+						cache.segments.emplace_back(edge);
+						});
+					}
+
+				cache.bvh = geometry::bvh{cache.bounding_boxes};
+				dirty = false;
+				}
+
+			/// <summary> Calls callback with the prepared sdf data of the piece_index-th piece. </summary>
+			template <typename callback_t>
+			decltype(auto) visit_piece(size_t piece_index, callback_t callback) const
+				{
+				const piece_t& piece{cache.pieces[piece_index]};
+				switch (piece.type)
+					{
+					case piece_type_t::segment   : return callback(cache.segments   [piece.index]);
+					case piece_type_t::bezier_3pt: return callback(cache.beziers_3pt[piece.index]);
+					case piece_type_t::bezier_4pt: return callback(cache.beziers_4pt[piece.index]);
+					case piece_type_t::bezier    :
+						{
+						const shape::const_observer::bezier<std::dynamic_extent> curve{shape.vertices.storage.begin() + piece.first_vertex_index, piece.last_vertex_index - piece.first_vertex_index + 1};
+						return callback(sdf::batch::prepared{curve});
+						}
+					}
+				std::unreachable();
+				}
+		};
+
+	template <typename shape_t>
+	struct baked<shape_t>::sdf_proxy
+		{
+		const baked& baked_shape;
+		const vec2f point;
+
+		float minimum_distance() const noexcept
+			{
+			const auto& cache{baked_shape.cache};
+			return cache.bvh.for_each_candidate(point, [&](size_t piece_index, float)
+				{
+				return baked_shape.visit_piece(piece_index, [&](const auto& prepared) { return prepared.minimum_distance(point); });
+				});
+			}
+
+		vec2f closest_point() const noexcept { return closest_with_signed_distance().closest; }
+
+		geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance() const noexcept
+			{
+			if constexpr (shape::concepts::mixed<shape_t>) { return closest_with_signed_distance_mixed(); }
+			else { return closest_with_signed_distance_polyline(); }
+			}
+
+		geometry::sdf::direction_signed_distance direction_signed_distance() const noexcept
+			{
+			return geometry::sdf::direction_signed_distance::create(closest_with_signed_distance(), point);
+			}
+
+		geometry::sdf::side            side           () const noexcept { return closest_with_signed_distance().distance.side(); }
+		geometry::sdf::signed_distance signed_distance() const noexcept { return closest_with_signed_distance().distance; }
+
+		private:
+			/// <summary>
+			/// Closest piece, ties going to the lowest piece index like the sequential loop in the regular sdf_proxy.
+			/// The bvh visits pieces out of order and skips ties, so callers also handle a closest point on the first vertex of the piece.
+			/// </summary>
+			template <typename evaluate_t>
+			std::pair<size_t, geometry::sdf::closest_point_with_signed_distance> closest_piece(evaluate_t evaluate) const noexcept
+				{
+				size_t current_index{0};
+				geometry::sdf::closest_point_with_signed_distance current;
+				baked_shape.cache.bvh.for_each_candidate(point, [&](size_t piece_index, float)
+					{
+					const geometry::sdf::closest_point_with_signed_distance candidate{evaluate(piece_index)};
+					if (candidate.distance.absolute() < current.distance.absolute() || (candidate.distance.absolute() == current.distance.absolute() && piece_index < current_index))
+						{
+						current       = candidate;
+						current_index = piece_index;
+						}
+					return current.distance.absolute();
+					});
+				return {current_index, current};
+				}
+
+			/// <summary> Same as the sdf of the line closest to point between the two pieces meeting at the vertex. </summary>
+			geometry::sdf::side side_at_vertex(const vec2f& point_a, const vec2f& point_b, const vec2f& point_c) const noexcept
+				{
+				const shape::line line_a{point_a, point_b};
+				const shape::line line_b{point_b, point_c};
+
+				const float distance_a{line_a.sdf(point).minimum_distance()};
+				const float distance_b{line_b.sdf(point).minimum_distance()};
+
+				const bool return_first{distance_a > distance_b};
+				return (return_first ? line_a : line_b).sdf(point).side();
+				}
+
+			geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance_mixed() const noexcept
+				{
+				const auto& shape{baked_shape.shape};
+				if (baked_shape.cache.pieces.empty()) { return {}; }
+
+				auto [current_piece_index, current]{closest_piece([&](size_t piece_index)
+					{
+					return baked_shape.visit_piece(piece_index, [&](const auto& prepared) { return prepared.closest_with_signed_distance(point); });
+					})};
+
+				const piece_t& piece{baked_shape.cache.pieces[current_piece_index]};
+				bool   current_is_vertex{false};
+				size_t current_index    {0};
+				if (current.closest == shape.vertices.ends_aware_access(piece.last_vertex_index))
+					{
+					current_is_vertex = true;
+					current_index     = piece.last_vertex_index;
+					}
+				else if (current.closest == shape.vertices[piece.first_vertex_index])
+					{
+					current_is_vertex = true;
+					current_index     = piece.first_vertex_index;
+					}
+
+				if (current_is_vertex)
+					{
+					const bool closed_or_not_last_nor_first{shape.ends.is_closed() || (current_index < shape.vertices.size() - 1 && current_index > 0)};
+					if (closed_or_not_last_nor_first)
+						{
+						const geometry::sdf::side side{side_at_vertex
+							(
+							shape.vertices.ends_aware_access(current_index > 0 ? current_index - 1 : shape.vertices.size() - 1),
+							shape.vertices.ends_aware_access(current_index    ),
+							shape.vertices.ends_aware_access(current_index + 1)
+							)};
+						current.distance = geometry::sdf::signed_distance{current.distance.absolute() * side};
+						}
+					}
+				return current;
+				}
+
+			geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance_polyline() const noexcept
+				{
+				const auto& shape{baked_shape.shape};
+				const auto& segments{baked_shape.cache.segments};
+				const size_t edges_count{segments.size()};
+				if (edges_count == 0) { return {}; }
+
+				auto [current_index, current]{closest_piece([&](size_t edge_index)
+					{
+					const auto& edge{segments[edge_index]};
+					return geometry::sdf::closest_point_with_signed_distance{edge.closest_point(point), edge.minimum_distance(point)};
+					})};
+
+				float current_t{utils::math::clamp(segments[current_index].t(point), 0.f, 1.f)};
+				// A closest point on the first vertex of an edge is the last vertex of the previous one.
+				if (current_t == 0.f && (shape.ends.is_closed() || current_index > 0))
+					{
+					current_index = (current_index + edges_count - 1) % edges_count;
+					current_t     = 1.f;
+					}
+
+				const bool closed_or_not_last{shape.ends.is_closed() || (current_index < edges_count - 1)};
+				if (current_t >= 1.f && closed_or_not_last)
+					{
+					const geometry::sdf::side side{side_at_vertex
+						(
+						shape.vertices.ends_aware_access(current_index    ),
+						shape.vertices.ends_aware_access(current_index + 1),
+						shape.vertices.ends_aware_access(current_index + 2)
+						)};
+					return {segments[current_index].b, geometry::sdf::signed_distance{current.distance.absolute() * side}};
+					}
+
+				const auto& edge{segments[current_index]};
+				const vec2f closest{edge.a + (edge.delta * current_t)};
+				return {closest, current.distance.absolute() * geometry::sdf::side{edge.cross(point)}};
+				}
+		};
+	}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <span>
+#include <cmath>
+#include <array>
+#include <vector>
+#include <ranges>
+#include <cstdint>
+#include <algorithm>
+
+#include "shape/aabb.h"
+#include "bounds/all.h"
+
+// Bounding volume hierarchy over shapes' bounding boxes, for queries on many shapes without visiting all of them.
+// Built top down splitting each node at the median of the bounding boxes centres along its widest axis.
+// Nodes are stored depth first in a single vector: the left child of an internal node always immediately follows it.
+
+namespace utils::math::geometry
+	{
+	class bvh
+		{
+		public:
+			struct node_t
+				{
+				shape::aabb bounding_box;
+				/// <summary> Leaves: index of the first shape in the indices array. Internal nodes: index of the right child. </summary>
+				std::uint32_t first;
+				/// <summary> 0 for internal nodes. </summary>
+				std::uint32_t count;
+
+				bool is_leaf() const noexcept { return count > 0; }
+				};
+
+			bvh() = default;
+
+			/// <summary> The i-th bounding box is the bounding box of the i-th shape, queries report shapes by that index. </summary>
+			bvh(std::span<const shape::aabb> bounding_boxes, size_t leaf_size = 4) :
+				bounding_boxes{bounding_boxes.begin(), bounding_boxes.end()},
+				leaf_size{std::max(leaf_size, size_t{1})}
+				{
+				if (bounding_boxes.empty()) { return; }
+
+				indices.resize(bounding_boxes.size());
+				for (size_t i{0}; i < indices.size(); i++) { indices[i] = static_cast<std::uint32_t>(i); }
+
+				nodes.reserve(((bounding_boxes.size() / this->leaf_size) + 1) * 2);
+				build(0, static_cast<std::uint32_t>(indices.size()));
+				}
+
+			template <std::ranges::range shapes_t>
+			static bvh from_shapes(const shapes_t& shapes, size_t leaf_size = 4)
+				{
+				std::vector<shape::aabb> bounding_boxes;
+				for (const auto& shape : shapes) { bounding_boxes.emplace_back(shape.bounding_box()); }
+				return bvh{bounding_boxes, leaf_size};
+				}
+
+			size_t size () const noexcept { return indices.size(); }
+			bool   empty() const noexcept { return indices.empty(); }
+
+			const std::vector<node_t>& get_nodes() const noexcept { return nodes; }
+
+			/// <summary> Lower bound of the distance between point and any point inside bounding_box, 0 if it's inside. </summary>
+			static float distance_lower_bound(const shape::aabb& bounding_box, const utils::math::vec2f& point) noexcept
+				{
+				const float dx{std::max({bounding_box.ll() - point.x(), 0.f, point.x() - bounding_box.rr()})};
+				const float dy{std::max({bounding_box.up() - point.y(), 0.f, point.y() - bounding_box.dw()})};
+				return std::sqrt((dx * dx) + (dy * dy));
+				}
+
+			/// <summary>
+			/// Visits shapes that may be the closest to point, nearest bounding boxes first.
+			/// callback(size_t index, float best_distance) evaluates the shape and returns its absolute distance from point.
+			/// Subtrees whose bounding box is farther than the best distance found so far are skipped.
+			/// </summary>
+			/// <returns>The smallest distance returned by callback, or max_distance if none was closer.</returns>
+			template <typename callback_t>
+			float for_each_candidate(const utils::math::vec2f& point, callback_t callback, float max_distance = utils::math::constants::finf) const
+				{
+				if (nodes.empty()) { return max_distance; }
+
+				struct pending_t { std::uint32_t node_index; float distance; };
+				std::array<pending_t, max_depth> stack;
+				size_t stack_size{0};
+
+				float best{max_distance};
+				stack[stack_size++] = {0, distance_lower_bound(nodes[0].bounding_box, point)};
+
+				while (stack_size > 0)
+					{
+					const pending_t pending{stack[--stack_size]};
+					if (pending.distance >= best) { continue; }
+
+					const node_t& node{nodes[pending.node_index]};
+					if (node.is_leaf())
+						{
+						for (std::uint32_t i{node.first}; i < node.first + node.count; i++)
+							{
+							const std::uint32_t index{indices[i]};
+							if (distance_lower_bound(bounding_boxes[index], point) >= best) { continue; }
+							best = std::min(best, callback(static_cast<size_t>(index), best));
+							}
+						continue;
+						}
+
+					const std::uint32_t left_index {pending.node_index + 1};
+					const std::uint32_t right_index{node.first};
+					const float left_distance {distance_lower_bound(nodes[left_index ].bounding_box, point)};
+					const float right_distance{distance_lower_bound(nodes[right_index].bounding_box, point)};
+
+					// Push the farther child first so the nearer one is visited next and tightens best as early as possible.
+					if (left_distance < right_distance)
+						{
+						stack[stack_size++] = {right_index, right_distance};
+						stack[stack_size++] = {left_index , left_distance };
+						}
+					else
+						{
+						stack[stack_size++] = {left_index , left_distance };
+						stack[stack_size++] = {right_index, right_distance};
+						}
+					}
+				return best;
+				}
+
+			/// <summary> Calls callback(size_t index) for every shape whose bounding box intersects region. </summary>
+			template <typename callback_t>
+			void for_each_intersecting(const shape::aabb& region, callback_t callback) const
+				{
+				if (nodes.empty()) { return; }
+
+				std::array<std::uint32_t, max_depth> stack;
+				size_t stack_size{0};
+				stack[stack_size++] = 0;
+
+				while (stack_size > 0)
+					{
+					const std::uint32_t node_index{stack[--stack_size]};
+					const node_t& node{nodes[node_index]};
+					if (!intersects(node.bounding_box, region)) { continue; }
+
+					if (node.is_leaf())
+						{
+						for (std::uint32_t i{node.first}; i < node.first + node.count; i++)
+							{
+							const std::uint32_t index{indices[i]};
+							if (intersects(bounding_boxes[index], region)) { callback(static_cast<size_t>(index)); }
+							}
+						continue;
+						}
+
+					stack[stack_size++] = node.first;
+					stack[stack_size++] = node_index + 1;
+					}
+				}
+
+		private:
+			// Median splits keep the tree balanced: depth is at most log2(shapes count) + 1, one slot per level plus one sibling per level.
+			inline static constexpr size_t max_depth{2 * 64};
+
+			std::vector<shape::aabb> bounding_boxes;
+			std::vector<std::uint32_t> indices;
+			std::vector<node_t> nodes;
+			size_t leaf_size{4};
+
+			static bool intersects(const shape::aabb& a, const shape::aabb& b) noexcept
+				{
+				return a.ll() <= b.rr() && a.rr() >= b.ll() && a.up() <= b.dw() && a.dw() >= b.up();
+				}
+
+			void build(std::uint32_t begin, std::uint32_t end)
+				{
+				const size_t node_index{nodes.size()};
+				nodes.push_back({shape::aabb::create::inverse_infinite(), begin, end - begin});
+
+				shape::aabb centres{shape::aabb::create::inverse_infinite()};
+				for (std::uint32_t i{begin}; i < end; i++)
+					{
+					const shape::aabb& bounding_box{bounding_boxes[indices[i]]};
+					nodes[node_index].bounding_box.merge_self(bounding_box);
+
+					const utils::math::vec2f centre{bounding_box.centre()};
+					centres.merge_self(shape::aabb{centre.x(), centre.y(), centre.x(), centre.y()});
+					}
+
+				if (end - begin <= leaf_size) { return; }
+
+				const bool split_x{(centres.rr() - centres.ll()) >= (centres.dw() - centres.up())};
+				const auto centre_on_axis{[this, split_x](std::uint32_t index)
+					{
+					const shape::aabb& bounding_box{bounding_boxes[index]};
+					return split_x ? (bounding_box.ll() + bounding_box.rr()) : (bounding_box.up() + bounding_box.dw());
+					}};
+
+				const std::uint32_t middle{begin + ((end - begin) / 2)};
+				std::nth_element(indices.begin() + begin, indices.begin() + middle, indices.begin() + end, [&centre_on_axis](std::uint32_t a, std::uint32_t b)
+					{
+					return centre_on_axis(a) < centre_on_axis(b);
+					});
+
+				build(begin, middle);
+				const std::uint32_t right_index{static_cast<std::uint32_t>(nodes.size())};
+				build(middle, end);
+
+				nodes[node_index].first = right_index;
+				nodes[node_index].count = 0;
+				}
+		};
+	}
\ No newline at end of file
@@ -1,157 +1,165 @@
+#pragma once
+
+#include <span>
+#include <tuple>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
 #include "all.h"
+#include "bvh.h"
 
 namespace utils::math::geometry
 	{
+	/// <summary> Order matches group::shapes_t. </summary>
+	enum class shapes_enum : uint8_t { circle, segment, aabb, capsule, polygon, polyline, mixed_closed, mixed_open };
+
+	/// <summary>
+	/// Heterogeneous collection of shapes, one container per shape type plus the insertion order and bounding box of every element.
+	/// A view group (VIEW = true) refers to the containers of an owning group without copying them.
+	/// </summary>
 	template <bool VIEW>
 	struct group
 		{
 		inline static constexpr bool view{VIEW};
 
-		struct indices_t
-			{
-			size_t index_vertices;
-			size_t index_shape_metadata;
-			};
+		using shapes_t = std::tuple
+			<
+			shape::circle,
+			shape::segment,
+			shape::aabb,
+			shape::capsule,
+			shape::polyline<ends::closeable::create::closed()>,
+			shape::polyline<ends::closeable::create::open  ()>,
+			shape::mixed   <ends::closeable::create::closed()>,
+			shape::mixed   <ends::closeable::create::open  ()>
+			>;
+
+		template <shapes_enum shape_type>
+		using shape_t = std::tuple_element_t<static_cast<size_t>(shape_type), shapes_t>;
 
 		struct element_metadata
 			{
-			geometry::shapes_enum shape_type;
-			indices_t indices;
-			geometry::shape::aabb bounding_box;
+			shapes_enum shape_type;
+			/// <summary> Index in the container of the element's shape type. </summary>
+			size_t index;
 			};
 
 		template <typename T>
 		using container_t = std::conditional_t<view, std::span<const T>, std::vector<T>>;
 
-		container_t<utils::math::vec2f> vertices;
-
-		struct shapes_metadata_t
-			{
-			struct mixed_t
-				{
-				size_t pieces_metadata_begin;
-				size_t pieces_metadata_count;
-				size_t vertices_count;
-				};
-			struct circle_t
-				{
-				float radius;
-				};
+		template <typename T>
+		struct containers_of;
+		template <typename ...Ts>
+		struct containers_of<std::tuple<Ts...>> { using type = std::tuple<container_t<Ts>...>; };
 
-			container_t<mixed_t> mixed;
-			container_t<geometry::shape::details::pieces_metadata_t> mixed_pieces;
-			container_t<circle_t> circles;
-			};
-		shapes_metadata_t shapes_metadata;
+		typename containers_of<shapes_t>::type shapes;
 		container_t<element_metadata> elements_metadata;
+		/// <summary> Parallel to elements_metadata, kept contiguous for building spatial indices. </summary>
+		container_t<shape::aabb> bounding_boxes;
+
+		group() = default;
 
+		template <bool other_view>
+			requires(view && !other_view)
+		group(const group<other_view>& owner) :
+			shapes{std::apply([](const auto&... containers) { return typename containers_of<shapes_t>::type{containers...}; }, owner.shapes)},
+			elements_metadata{owner.elements_metadata},
+			bounding_boxes{owner.bounding_boxes}
+			{}
+
+		size_t size () const noexcept { return elements_metadata.size(); }
+		bool   empty() const noexcept { return elements_metadata.empty(); }
+
+		/// <summary> Calls callback with the element_index-th shape in insertion order. </summary>
 		template <typename callback_t>
-		utils_gpu_available void for_each(callback_t callback) const noexcept
+		void visit(size_t element_index, callback_t callback) const
 			{
-			for (const auto& element : elements_metadata)
+			const element_metadata& element{elements_metadata[element_index]};
+			[&]<size_t... Is>(std::index_sequence<Is...>)
 				{
-				switch (element.shape_type)
-					{
-					case shapes_enum::mixed: if (true)
-						{
-						const shapes_metadata_t::mixed_t& mixed_metadata_indices{shapes_metadata.mixed[element.indices.index_shape_metadata]};
-
-						const shape::view::mixed<true>::span_t          vertices{vertices.begin() + element.indices.index_vertices, mixed_metadata_indices.vertices_count};
-						const shape::view::mixed<true>::span_metadata_t metadata{shapes_metadata.mixed_pieces.begin() + mixed_metadata_indices.pieces_metadata_begin, mixed_metadata_indices.pieces_metadata_count};
-						const shape::view::mixed<true> mixed{vertices, metadata};
-
-						callback(mixed);
-						} break;
-					case shapes_enum::circle: if (true)
-						{
-						const shape::circle circle{vertices[element.indices.index_vertices], shapes_metadata.circles[element.indices.index_shape_metadata].radius};
-						callback(circle);
-						} break;
-					case shapes_enum::segment: if (true)
-						{
-						const shape::segment segment{vertices[element.indices.index_vertices], vertices[element.indices.index_vertices + 1]};
-						callback(segment);
-						} break;
-					}
-				}
+				((static_cast<size_t>(element.shape_type) == Is ? static_cast<void>(callback(std::get<Is>(shapes)[element.index])) : void()), ...);
+				}(std::make_index_sequence<std::tuple_size_v<shapes_t>>{});
 			}
 
-		void add(const utils::math::geometry::shape::concepts::mixed auto& mixed)
-			requires(!view)
+		template <typename callback_t>
+		void for_each(callback_t callback) const
 			{
-			element_metadata element_metadata
-				{
-				.shape_type{shapes_enum::mixed},
-				.indices
-					{
-					.index_vertices{vertices.size()},
-					.index_shape_metadata{shapes_metadata.mixed.size()}
-					}
-				};
-			shapes_metadata.mixed.push_back(typename shapes_metadata_t::mixed_t
-				{
-				.pieces_metadata_begin{shapes_metadata.mixed_pieces.size()},
-				.pieces_metadata_count{mixed.metadata.size()},
-				.vertices_count{mixed.vertices.size()}
-				});
-
-			vertices.insert(vertices.begin(), mixed.vertices.begin(), mixed.vertices.end());
-			shapes_metadata.mixed_pieces.insert(shapes_metadata.mixed_pieces.begin(), mixed.metadata.begin(), mixed.metadata.end());
-
-			//element_metadata.bounding_box = mixed.bounding_box();
-			elements_metadata.push_back(element_metadata);
+			for (size_t i{0}; i < size(); i++) { visit(i, callback); }
 			}
 
-		void add(const utils::math::geometry::shape::concepts::circle auto& circle)
-			requires(!view)
+		/// <summary> Spatial index over the elements' bounding boxes, to be rebuilt after adding shapes. </summary>
+		geometry::bvh create_bvh(size_t leaf_size = 4) const
 			{
-			element_metadata element_metadata
-				{
-				.shape_type{shapes_enum::circle},
-				.indices
-					{
-					.index_vertices{vertices.size()},
-					.index_shape_metadata{shapes_metadata.circles.size()}
-					}
-				};
-			shapes_metadata.circles.push_back({circle.radius});
-
-			vertices.push_back(circle.centre);
+			return geometry::bvh{std::span<const shape::aabb>{bounding_boxes.data(), bounding_boxes.size()}, leaf_size};
+			}
 
-			//element_metadata.bounding_box = mixed.bounding_box();
-			elements_metadata.push_back(element_metadata);
+		/// <summary> Evaluates every shape. </summary>
+		geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const utils::math::vec2f& point) const noexcept
+			{
+			geometry::sdf::closest_point_with_signed_distance result;
+			for_each([&](const auto& shape) { result.set_to_closest(shape.sdf(point).closest_with_signed_distance()); });
+			return result;
 			}
 
-		void add(const utils::math::geometry::shape::concepts::aabb auto& aabb)
-			requires(!view)
+		/// <summary> Only evaluates shapes whose bounding box is closer than the closest shape found so far. bvh must be created from this group. </summary>
+		geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const utils::math::vec2f& point, const geometry::bvh& bvh) const noexcept
 			{
-			element_metadata element_metadata
+			geometry::sdf::closest_point_with_signed_distance result;
+			bvh.for_each_candidate(point, [&](size_t element_index, float)
 				{
-				.shape_type{shapes_enum::aabb},
-				.indices{.index_vertices{vertices.size()}},
-				.bounding_box{aabb}
-				};
+				visit(element_index, [&](const auto& shape) { result.set_to_closest(shape.sdf(point).closest_with_signed_distance()); });
+				return result.distance.absolute();
+				});
+			return result;
+			}
 
-			vertices.push_back(aabb.ul());
-			vertices.push_back(aabb.dr());
+		geometry::sdf::direction_signed_distance direction_signed_distance(const utils::math::vec2f& point) const noexcept
+			{
+			return geometry::sdf::direction_signed_distance::create(closest_with_signed_distance(point), point);
+			}
 
-			elements_metadata.push_back(element_metadata);
+		geometry::sdf::direction_signed_distance direction_signed_distance(const utils::math::vec2f& point, const geometry::bvh& bvh) const noexcept
+			{
+			return geometry::sdf::direction_signed_distance::create(closest_with_signed_distance(point, bvh), point);
 			}
 
-		void add(const utils::math::geometry::shape::concepts::segment auto& segment)
+		template <typename shape_t>
+		void add(shape_t&& shape)
 			requires(!view)
 			{
-			element_metadata element_metadata
-				{
-				.shape_type{shapes_enum::segment},
-				.indices{.index_vertices{vertices.size()}},
-				//.bounding_box{segment}
-				};
+			using value_t = std::remove_cvref_t<shape_t>;
+			constexpr size_t type_index{index_of<value_t>()};
+			static_assert(type_index < std::tuple_size_v<shapes_t>, "Shape type is not currently supported in groups.");
 
-			vertices.push_back(segment.a);
-			vertices.push_back(segment.b);
+			auto& container{std::get<type_index>(shapes)};
+			elements_metadata.push_back(element_metadata
+				{
+				.shape_type{static_cast<shapes_enum>(type_index)},
+				.index{container.size()}
+				});
+			bounding_boxes.push_back(shape.bounding_box());
+			container.emplace_back(std::forward<shape_t>(shape));
+			}
 
-			elements_metadata.push_back(element_metadata);
+		void clear() requires(!view)
+			{
+			std::apply([](auto&... containers) { (containers.clear(), ...); }, shapes);
+			elements_metadata.clear();
+			bounding_boxes.clear();
 			}
+
+		private:
+			template <typename value_t>
+			static consteval size_t index_of() noexcept
+				{
+				return []<size_t... Is>(std::index_sequence<Is...>)
+					{
+					size_t ret{std::tuple_size_v<shapes_t>};
+					((std::same_as<value_t, std::tuple_element_t<Is, shapes_t>> && ret == std::tuple_size_v<shapes_t> ? (ret = Is, 0) : 0), ...);
+					return ret;
+					}(std::make_index_sequence<std::tuple_size_v<shapes_t>>{});
+				}
 		};
 	}
\ No newline at end of file
@@ -11,4 +11,5 @@
 #include "mixed.h"
 #include "arc.h"
 
-#include "composite.h"
\ No newline at end of file
+#include "composite.h"
+#include "batch.h"
\ No newline at end of file
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <span>
+#include <cmath>
+#include <cassert>
+#include <concepts>
+
+#include "common.h"
+#include "ab.h"
+#include "circle.h"
+#include "bezier.h"
+#include "../../simd.h"
+
+// Batched queries of one shape against many points.
+// shape.sdf(point) rebuilds everything it needs from the shape's vertices for every point; batch::prepared does that work once per shape
+// (segment direction and length, bezier power basis and cubic/quintic coefficients) and then only evaluates the per-point part.
+// Circles and lines/rays/segments also evaluate several points per instruction when the points are given as a simd::vec2f_batch;
+// every other shape falls back to the regular sdf_proxy, one point at a time.
+
+namespace utils::math::geometry::sdf::batch
+	{
+#pragma region prepared
+	/// <summary> Per-shape data shared by every point query. Fallback for shapes without a dedicated preparation: forwards to shape.sdf(point). </summary>
+	template <typename shape_t>
+	struct prepared
+		{
+		prepared(const shape_t& shape) noexcept : shape{shape} {}
+		const shape_t& shape;
+
+		utils_gpu_available constexpr float                                         minimum_distance            (const vec2f& point) const noexcept { return shape.sdf(point).minimum_distance            (); }
+		utils_gpu_available constexpr geometry::sdf::signed_distance                signed_distance             (const vec2f& point) const noexcept { return shape.sdf(point).signed_distance             (); }
+		utils_gpu_available constexpr vec2f                                         closest_point               (const vec2f& point) const noexcept { return shape.sdf(point).closest_point               (); }
+		utils_gpu_available constexpr geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const vec2f& point) const noexcept { return shape.sdf(point).closest_with_signed_distance(); }
+		};
+
+	template <typename shape_t>
+		requires(shape::concepts::circle<shape_t>)
+	struct prepared<shape_t>
+		{
+		prepared(const shape_t& shape) noexcept : centre{shape.centre}, radius{shape.radius} {}
+		vec2f centre;
+		float radius;
+
+		utils_gpu_available constexpr geometry::sdf::signed_distance signed_distance (const vec2f& point) const noexcept { return {vec2f::distance(centre, point) - radius}; }
+		utils_gpu_available constexpr float                         minimum_distance(const vec2f& point) const noexcept { return signed_distance(point).absolute(); }
+		utils_gpu_available constexpr vec2f                          closest_point   (const vec2f& point) const noexcept { return closest_with_signed_distance(point).closest; }
+
+		utils_gpu_available constexpr geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const vec2f& point) const noexcept
+			{
+			const vec2f point_to_centre{point - centre};
+			const float point_to_centre_distance{point_to_centre.get_length()};
+			return {centre + (point_to_centre / point_to_centre_distance * radius), point_to_centre_distance - radius};
+			}
+
+		template <typename pack_t>
+		utils_force_inline pack_t signed_distance(pack_t x, pack_t y) const noexcept
+			{
+			const pack_t dx{x - pack_t::broadcast(centre.x())};
+			const pack_t dy{y - pack_t::broadcast(centre.y())};
+			return pack_t::sqrt(pack_t::fma(dx, dx, dy * dy)) - pack_t::broadcast(radius);
+			}
+		template <typename pack_t>
+		utils_force_inline pack_t minimum_distance(pack_t x, pack_t y) const noexcept
+			{
+			const pack_t distance{signed_distance(x, y)};
+			return pack_t::max(distance, pack_t::broadcast(0.f) - distance);
+			}
+		template <typename pack_t>
+		utils_force_inline void closest_point(pack_t x, pack_t y, pack_t& out_x, pack_t& out_y) const noexcept
+			{
+			const pack_t dx{x - pack_t::broadcast(centre.x())};
+			const pack_t dy{y - pack_t::broadcast(centre.y())};
+			const pack_t scale{pack_t::broadcast(radius) / pack_t::sqrt(pack_t::fma(dx, dx, dy * dy))};
+			out_x = pack_t::fma(dx, scale, pack_t::broadcast(centre.x()));
+			out_y = pack_t::fma(dy, scale, pack_t::broadcast(centre.y()));
+			}
+		};
+
+	/// <summary> Lines, rays and segments. </summary>
+	template <typename shape_t>
+		requires(shape::concepts::ab_ends_aware<shape_t>)
+	struct prepared<shape_t>
+		{
+		inline static constexpr ends::ab ends{shape_t::optional_ends.value()};
+
+		prepared(const shape_t& shape) noexcept :
+			a{shape.a}, b{shape.b}, delta{shape.b - shape.a},
+			inverse_length2{1.f / (delta.x() * delta.x() + delta.y() * delta.y())},
+			inverse_length{std::sqrt(inverse_length2)}
+			{}
+		vec2f a;
+		vec2f b;
+		vec2f delta;
+		float inverse_length2;
+		float inverse_length;
+
+		/// <summary> Same as ab::projected_percent for infinite ends. </summary>
+		utils_gpu_available constexpr float t(const vec2f& point) const noexcept { return ((point.x() - a.x()) * delta.x() + (point.y() - a.y()) * delta.y()) * inverse_length2; }
+		/// <summary> Same as ab::some_significant_name_ive_yet_to_figure_out, positive on the right. </summary>
+		utils_gpu_available constexpr float cross(const vec2f& point) const noexcept { return ((point.x() - a.x()) * delta.y()) - (delta.x() * (point.y() - a.y())); }
+
+		utils_gpu_available constexpr vec2f closest_point(const vec2f& point) const noexcept
+			{
+			const float t{this->t(point)};
+			if constexpr (ends.is_a_finite()) { if (t <= 0.f) { return a; } }
+			if constexpr (ends.is_b_finite()) { if (t >= 1.f) { return b; } }
+			return {a.x() + t * delta.x(), a.y() + t * delta.y()};
+			}
+
+		utils_gpu_available constexpr float minimum_distance(const vec2f& point) const noexcept
+			{
+			if constexpr (ends.is_a_finite() || ends.is_b_finite())
+				{
+				const float t{this->t(point)};
+				if constexpr (ends.is_a_finite()) { if (t <= 0.f) { return vec2f::distance(a, point); } }
+				if constexpr (ends.is_b_finite()) { if (t >= 1.f) { return vec2f::distance(b, point); } }
+				}
+			return std::abs(cross(point) * inverse_length);
+			}
+
+		utils_gpu_available constexpr geometry::sdf::signed_distance signed_distance(const vec2f& point) const noexcept
+			{
+			const float cross{this->cross(point)};
+			if constexpr (ends.is_a_finite() || ends.is_b_finite())
+				{
+				const float t{this->t(point)};
+				if constexpr (ends.is_a_finite()) { if (t <= 0.f) { return {vec2f::distance(a, point) * geometry::sdf::side{cross}.sign()}; } }
+				if constexpr (ends.is_b_finite()) { if (t >= 1.f) { return {vec2f::distance(b, point) * geometry::sdf::side{cross}.sign()}; } }
+				}
+			return {cross * inverse_length};
+			}
+
+		utils_gpu_available constexpr geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const vec2f& point) const noexcept
+			{
+			return {closest_point(point), signed_distance(point)};
+			}
+
+		template <typename pack_t>
+		utils_force_inline void closest_point(pack_t x, pack_t y, pack_t& out_x, pack_t& out_y) const noexcept
+			{
+			const pack_t dx{pack_t::broadcast(delta.x())};
+			const pack_t dy{pack_t::broadcast(delta.y())};
+			pack_t t{pack_t::fma(x - pack_t::broadcast(a.x()), dx, (y - pack_t::broadcast(a.y())) * dy) * pack_t::broadcast(inverse_length2)};
+			if constexpr (ends.is_a_finite()) { t = pack_t::max(t, pack_t::broadcast(0.f)); }
+			if constexpr (ends.is_b_finite()) { t = pack_t::min(t, pack_t::broadcast(1.f)); }
+			out_x = pack_t::fma(t, dx, pack_t::broadcast(a.x()));
+			out_y = pack_t::fma(t, dy, pack_t::broadcast(a.y()));
+			}
+		template <typename pack_t>
+		utils_force_inline pack_t minimum_distance(pack_t x, pack_t y) const noexcept
+			{
+			pack_t closest_x, closest_y;
+			closest_point(x, y, closest_x, closest_y);
+			const pack_t dx{x - closest_x};
+			const pack_t dy{y - closest_y};
+			return pack_t::sqrt(pack_t::fma(dx, dx, dy * dy));
+			}
+		template <typename pack_t>
+		utils_force_inline pack_t signed_distance(pack_t x, pack_t y) const noexcept
+			{
+			const pack_t cross{pack_t::fma(x - pack_t::broadcast(a.x()), pack_t::broadcast(delta.y()), pack_t::broadcast(0.f) - (pack_t::broadcast(delta.x()) * (y - pack_t::broadcast(a.y()))))};
+			// Same as side::sign, coincident counts as right.
+			const pack_t sign{pack_t::select_less(cross, pack_t::broadcast(-utils::math::constants::epsilonf), pack_t::broadcast(-1.f), pack_t::broadcast(1.f))};
+			return minimum_distance(x, y) * sign;
+			}
+		};
+
+	/// <summary> Quadratic bezier: the cubic solved for every point only changes in its last two coefficients. </summary>
+	template <typename shape_t>
+		requires(shape::concepts::bezier_ends_aware<shape_t> && shape_t::extent == 3)
+	struct prepared<shape_t>
+		{
+		inline static constexpr ends::ab ends{shape_t::optional_ends.value()};
+
+		prepared(const shape_t& shape) noexcept :
+			v0{shape.vertices[0]}, v1{shape.vertices[1]}, v2{shape.vertices[2]},
+			c2{(v1 * 2.f) - v2 - v0},
+			c3{v0 - v1}
+			{
+			const float t3{vec2f::dot(c2, c2)};
+			inverse_t3 = 1.f / t3;
+			t2         = vec2f::dot(c3, c2) * 3.f * inverse_t3;
+			t1_offset  = 2.f * vec2f::dot(c3, c3);
+			t22        = t2 * t2;
+			}
+		vec2f v0, v1, v2;
+		vec2f c2, c3;
+		float inverse_t3;
+		float t2;
+		float t1_offset;
+		float t22;
+
+		utils_gpu_available constexpr vec2f point_at(float t) const noexcept
+			{
+			if (t == 0.f) { return v0; }
+			if (t == 1.f) { return v2; }
+			const float inverse_t{1.f - t};
+			return v0 * inverse_t * inverse_t + v1 * 2.f * t * inverse_t + v2 * t * t;
+			}
+		utils_gpu_available constexpr vec2f normal_at(float t) const noexcept
+			{
+			if (t == 0.f) { return (v1 - v0).perpendicular_left(); }
+			if (t == 1.f) { return (v2 - v1).perpendicular_left(); }
+			return ((v0 * (t - 1.f)) + (v1 * (1.f - 2.f * t)) + v2 * t).normalize().perpendicular_left();
+			}
+
+		/// <summary> Same as sdf::details::bezier::_3pt::closest_t. </summary>
+		utils_gpu_available constexpr float closest_t(const vec2f& point) const noexcept
+			{
+			const vec2f c1{point - v0};
+			const float t1{(vec2f::dot(c1, c2) + t1_offset) * inverse_t3};
+			const float t0{ vec2f::dot(c1, c3)              * inverse_t3};
+
+			const vec2f pq{t1 - t22 / 3.f, t22 * t2 / 13.5f - t2 * t1 / 3.f + t0};
+			const float ppp{pq.x() * pq.x() * pq.x()};
+			const float qq {pq.y() * pq.y()};
+			const float p2{std::abs(pq.x())};
+			const float r1{1.5f / pq.x() * pq.y()};
+
+			if (qq * 0.25f + ppp / 27.f > 0.f)
+				{
+				const float r2{r1 * std::sqrt(3.f / p2)};
+				float root;
+				if (pq.x() < 0.f) { root = utils::math::sign(pq.y()) * std::cosh(std::acosh(r2 * -utils::math::sign(pq.y())) / 3.f); }
+				else { root = std::sinh(std::asinh(r2) / 3.f); }
+				root = -2.f * std::sqrt(p2 / 3.f) * root - t2 / 3.f;
+				return ends::clamp_t<ends>(root);
+				}
+
+			const float ac{std::acos(r1 * std::sqrt(-3.f / pq.x())) / 3.f};
+			const vec2f roots{(vec2f{float{std::cos(ac)}, float{std::cos(ac - 4.18879020479f)}} * 2.f * float{std::sqrt(-pq.x() / 3.f)}) - t2 / 3.f};
+			const float root_a{ends::clamp_t<ends>(roots.x())};
+			const float root_b{ends::clamp_t<ends>(roots.y())};
+			return vec2f::distance2(point, point_at(root_a)) < vec2f::distance2(point, point_at(root_b)) ? root_a : root_b;
+			}
+
+		utils_gpu_available constexpr geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const vec2f& point) const noexcept
+			{
+			const float t{closest_t(point)};
+			const vec2f closest{point_at(t)};
+			const geometry::sdf::side side{-vec2f::dot(normal_at(t), point - closest)};
+			return {closest, vec2f::distance(closest, point) * side};
+			}
+
+		utils_gpu_available constexpr vec2f                          closest_point   (const vec2f& point) const noexcept { return point_at(closest_t(point)); }
+		utils_gpu_available constexpr float                          minimum_distance(const vec2f& point) const noexcept { return vec2f::distance(closest_point(point), point); }
+		utils_gpu_available constexpr geometry::sdf::signed_distance signed_distance (const vec2f& point) const noexcept { return closest_with_signed_distance(point).distance; }
+		};
+
+	/// <summary> Cubic bezier: the power basis and the point-independent quintic coefficients are computed once. </summary>
+	template <typename shape_t>
+		requires(shape::concepts::bezier_ends_aware<shape_t> && shape_t::extent == 4)
+	struct prepared<shape_t>
+		{
+		inline static constexpr ends::ab ends{shape_t::optional_ends.value()};
+
+		prepared(const shape_t& shape) noexcept :
+			shape{shape},
+			v0{shape.vertices[0]}, v3{shape.vertices[3]},
+			a{shape.vertices[3] + (shape.vertices[1] - shape.vertices[2]) * 3.f - shape.vertices[0]},
+			b{(shape.vertices[0] - shape.vertices[1] * 2.f + shape.vertices[2]) * 3.f},
+			c{(shape.vertices[1] - shape.vertices[0]) * 3.f},
+			qa{3.f * vec2f::dot(a, a)},
+			qb{5.f * vec2f::dot(a, b)},
+			qc{4.f * vec2f::dot(a, c) + 2.f * vec2f::dot(b, b)},
+			qd_offset{3.f * vec2f::dot(b, c)},
+			qe_offset{vec2f::dot(c, c)}
+			{}
+		/// <summary> Kept by value so prepared pieces can be stored, it's only read for the tangents at the ends and for degenerate curves. </summary>
+		shape_t shape;
+		vec2f v0, v3;
+		/// <summary> Power basis: a t^3 + b t^2 + c t + v0. </summary>
+		vec2f a, b, c;
+		float qa, qb, qc, qd_offset, qe_offset;
+
+		utils_gpu_available constexpr vec2f point_at(float t) const noexcept
+			{
+			if (t == 0.f) { return v0; }
+			if (t == 1.f) { return v3; }
+			return ((a * t + b) * t + c) * t + v0;
+			}
+		utils_gpu_available constexpr vec2f normal_at(float t) const noexcept
+			{
+			if (t == 0.f) { return (shape.vertices[1] - v0).perpendicular_left(); }
+			if (t == 1.f) { return (v3 - shape.vertices[2]).perpendicular_left(); }
+			return ((a * 3.f * t * t) + (b * 2.f * t) + c).perpendicular_left();
+			}
+
+		/// <summary> Same as sdf::details::bezier::_4pt::closest_t. </summary>
+		utils_gpu_available constexpr float closest_t(const vec2f& point) const noexcept
+			{
+			const vec2f d{v0 - point};
+			const float qd{qd_offset + 3.f * vec2f::dot(d, a)};
+			const float qe{qe_offset + 2.f * vec2f::dot(d, b)};
+			const float qf{vec2f::dot(d, c)};
+			const auto ts{sdf::details::bezier::_4pt::solveQuintic(qa, qb, qc, qd, qe, qf)};
+
+			if (ts.size == 0) { return shape.sdf(point).template closest_t<ends>(); }
+
+			float closest_distance{utils::math::constants::finf};
+			float closest_t       {utils::math::constants::fnan};
+			for (size_t i{0}; i < ts.size; i++)
+				{
+				const float candidate_t{ends::clamp_t<ends>(ts.data[i])};
+				const float candidate_distance{vec2f::distance2(point_at(candidate_t), point)};
+				if (candidate_distance < closest_distance)
+					{
+					closest_distance = candidate_distance;
+					closest_t        = candidate_t;
+					}
+				}
+			return closest_t;
+			}
+
+		utils_gpu_available constexpr geometry::sdf::closest_point_with_signed_distance closest_with_signed_distance(const vec2f& point) const noexcept
+			{
+			const float t{closest_t(point)};
+			const vec2f closest{point_at(t)};
+			const geometry::sdf::side side{-vec2f::dot(normal_at(t), point - closest)};
+			return {closest, vec2f::distance(closest, point) * side};
+			}
+
+		utils_gpu_available constexpr vec2f                          closest_point   (const vec2f& point) const noexcept { return point_at(closest_t(point)); }
+		utils_gpu_available constexpr float                          minimum_distance(const vec2f& point) const noexcept { return vec2f::distance(closest_point(point), point); }
+		utils_gpu_available constexpr geometry::sdf::signed_distance signed_distance (const vec2f& point) const noexcept { return closest_with_signed_distance(point).distance; }
+		};
+
+	template <typename shape_t>
+	prepared(const shape_t&) -> prepared<shape_t>;
+#pragma endregion prepared
+
+	namespace details
+		{
+		template <typename prepared_t>
+		concept pack_evaluable = requires(const prepared_t& prepared, simd::details::scalar_pack pack)
+			{
+			{ prepared.signed_distance(pack, pack) } -> std::same_as<simd::details::scalar_pack>;
+			};
+		}
+
+#pragma region array of structures
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void minimum_distance(const shape_t& shape, std::span<const vec2f> points, std::span<float> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.minimum_distance(points[i]); }
+		}
+
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void signed_distance(const shape_t& shape, std::span<const vec2f> points, std::span<geometry::sdf::signed_distance> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.signed_distance(points[i]); }
+		}
+
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void closest_point(const shape_t& shape, std::span<const vec2f> points, std::span<vec2f> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.closest_point(points[i]); }
+		}
+
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void closest_with_signed_distance(const shape_t& shape, std::span<const vec2f> points, std::span<geometry::sdf::closest_point_with_signed_distance> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.closest_with_signed_distance(points[i]); }
+		}
+
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void direction_signed_distance(const shape_t& shape, std::span<const vec2f> points, std::span<geometry::sdf::direction_signed_distance> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		for (size_t i{0}; i < points.size(); i++) { out[i] = geometry::sdf::direction_signed_distance::create(prepared_shape.closest_with_signed_distance(points[i]), points[i]); }
+		}
+#pragma endregion array of structures
+
+#pragma region structure of arrays
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void minimum_distance(const shape_t& shape, const simd::vec2f_batch& points, std::span<float> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		if constexpr (details::pack_evaluable<prepared<shape_t>>)
+			{
+			simd::details::for_each_pack(points.size(), [&]<typename pack_t>(size_t index)
+				{
+				prepared_shape.minimum_distance(pack_t::load(points.x().data() + index), pack_t::load(points.y().data() + index)).store(out.data() + index);
+				});
+			}
+		else
+			{
+			for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.minimum_distance(points[i]); }
+			}
+		}
+
+	/// <summary> out must be at least as big as points. </summary>
+	template <typename shape_t>
+	void signed_distance(const shape_t& shape, const simd::vec2f_batch& points, std::span<float> out) noexcept
+		{
+		assert(out.size() >= points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		if constexpr (details::pack_evaluable<prepared<shape_t>>)
+			{
+			simd::details::for_each_pack(points.size(), [&]<typename pack_t>(size_t index)
+				{
+				prepared_shape.signed_distance(pack_t::load(points.x().data() + index), pack_t::load(points.y().data() + index)).store(out.data() + index);
+				});
+			}
+		else
+			{
+			for (size_t i{0}; i < points.size(); i++) { out[i] = prepared_shape.signed_distance(points[i]).value; }
+			}
+		}
+
+	/// <summary> out is resized to match points. </summary>
+	template <typename shape_t>
+	void closest_point(const shape_t& shape, const simd::vec2f_batch& points, simd::vec2f_batch& out) noexcept
+		{
+		out.resize(points.size());
+		const prepared<shape_t> prepared_shape{shape};
+		if constexpr (details::pack_evaluable<prepared<shape_t>>)
+			{
+			simd::details::for_each_pack(points.size(), [&]<typename pack_t>(size_t index)
+				{
+				pack_t x, y;
+				prepared_shape.closest_point(pack_t::load(points.x().data() + index), pack_t::load(points.y().data() + index), x, y);
+				x.store(out.x().data() + index);
+				y.store(out.y().data() + index);
+				});
+			}
+		else
+			{
+			for (size_t i{0}; i < points.size(); i++) { out.set(i, prepared_shape.closest_point(points[i])); }
+			}
+		}
+#pragma endregion structure of arrays
+	}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+#include "simd/pack.h"
+#include "vec.h"
+#include "transform2.h"
+#include "geometry/transform/point.h"
+
+// Structure of arrays batches of float vectors and kernels working on many vectors at once.
+// Each component lives in its own contiguous array so a kernel processes as many vectors per instruction as the SIMD registers fit
+// (8 with AVX2, 4 with SSE2 and NEON, 1 otherwise). The instruction set is chosen at compile time, see compilation/simd.h.
+// Kernels write into an output batch which is resized to match the input; the output may be one of the inputs.
+
+namespace utils::math::simd
+	{
+	template <size_t EXTENT>
+	class vecf_batch
+		{
+		public:
+			inline static constexpr size_t extent{EXTENT};
+			using value_type = utils::math::vec<float, extent>;
+
+			vecf_batch() = default;
+			explicit vecf_batch(size_t size) { resize(size); }
+			explicit vecf_batch(std::span<const value_type> vecs) { assign(vecs); }
+
+			static vecf_batch from(std::span<const value_type> vecs) { return vecf_batch{vecs}; }
+
+			size_t size () const noexcept { return components[0].size(); }
+			bool   empty() const noexcept { return components[0].empty(); }
+
+			void resize (size_t size) { for (auto& component : components) { component.resize (size); } }
+			void reserve(size_t size) { for (auto& component : components) { component.reserve(size); } }
+			void clear  ()   noexcept { for (auto& component : components) { component.clear  ();     } }
+
+			void assign(std::span<const value_type> vecs)
+				{
+				resize(vecs.size());
+				for (size_t i{0}; i < vecs.size(); i++) { set(i, vecs[i]); }
+				}
+
+			void push_back(const value_type& vec)
+				{
+				for (size_t c{0}; c < extent; c++) { components[c].push_back(vec[c]); }
+				}
+
+			value_type operator[](size_t index) const noexcept
+				{
+				value_type ret;
+				for (size_t c{0}; c < extent; c++) { ret[c] = components[c][index]; }
+				return ret;
+				}
+
+			void set(size_t index, const value_type& vec) noexcept
+				{
+				for (size_t c{0}; c < extent; c++) { components[c][index] = vec[c]; }
+				}
+
+			/// <summary> Writes the vectors back in array of structures layout, out must be at least as big as this batch. </summary>
+			void store(std::span<value_type> out) const noexcept
+				{
+				assert(out.size() >= size());
+				for (size_t i{0}; i < size(); i++) { out[i] = operator[](i); }
+				}
+
+			std::vector<value_type> to_vector() const
+				{
+				std::vector<value_type> ret(size());
+				store(ret);
+				return ret;
+				}
+
+			std::span<      float> component(size_t index)       noexcept { return components[index]; }
+			std::span<const float> component(size_t index) const noexcept { return components[index]; }
+
+			std::span<      float> x()       noexcept                        { return components[0]; }
+			std::span<const float> x() const noexcept                        { return components[0]; }
+			std::span<      float> y()       noexcept requires(extent >= 2) { return components[1]; }
+			std::span<const float> y() const noexcept requires(extent >= 2) { return components[1]; }
+			std::span<      float> z()       noexcept requires(extent >= 3) { return components[2]; }
+			std::span<const float> z() const noexcept requires(extent >= 3) { return components[2]; }
+			std::span<      float> w()       noexcept requires(extent >= 4) { return components[3]; }
+			std::span<const float> w() const noexcept requires(extent >= 4) { return components[3]; }
+
+		private:
+			std::array<std::vector<float>, extent> components;
+		};
+
+	using vec2f_batch = vecf_batch<2>;
+	using vec3f_batch = vecf_batch<3>;
+	using vec4f_batch = vecf_batch<4>;
+
+	namespace details
+		{
+		template <size_t extent, typename operation_t>
+		void component_wise(const vecf_batch<extent>& a, const vecf_batch<extent>& b, vecf_batch<extent>& out, operation_t operation) noexcept
+			{
+			assert(a.size() == b.size());
+			out.resize(a.size());
+			for (size_t c{0}; c < extent; c++)
+				{
+				const float* a_component  {a  .component(c).data()};
+				const float* b_component  {b  .component(c).data()};
+				      float* out_component{out.component(c).data()};
+
+				for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+					{
+					operation(pack_t::load(a_component + index), pack_t::load(b_component + index)).store(out_component + index);
+					});
+				}
+			}
+
+		template <typename pack_t, size_t extent>
+		utils_force_inline inline pack_t length2_at(const vecf_batch<extent>& a, size_t index) noexcept
+			{
+			const pack_t first{pack_t::load(a.component(0).data() + index)};
+			pack_t ret{first * first};
+			for (size_t c{1}; c < extent; c++)
+				{
+				const pack_t value{pack_t::load(a.component(c).data() + index)};
+				ret = pack_t::fma(value, value, ret);
+				}
+			return ret;
+			}
+		}
+
+	template <size_t extent>
+	void add(const vecf_batch<extent>& a, const vecf_batch<extent>& b, vecf_batch<extent>& out) noexcept
+		{
+		details::component_wise(a, b, out, [](auto a, auto b) { return a + b; });
+		}
+
+	template <size_t extent>
+	void sub(const vecf_batch<extent>& a, const vecf_batch<extent>& b, vecf_batch<extent>& out) noexcept
+		{
+		details::component_wise(a, b, out, [](auto a, auto b) { return a - b; });
+		}
+
+	/// <summary> Component-wise product. </summary>
+	template <size_t extent>
+	void mul(const vecf_batch<extent>& a, const vecf_batch<extent>& b, vecf_batch<extent>& out) noexcept
+		{
+		details::component_wise(a, b, out, [](auto a, auto b) { return a * b; });
+		}
+
+	template <size_t extent>
+	void scale(const vecf_batch<extent>& a, float scaling, vecf_batch<extent>& out) noexcept
+		{
+		out.resize(a.size());
+		for (size_t c{0}; c < extent; c++)
+			{
+			const float* a_component  {a  .component(c).data()};
+			      float* out_component{out.component(c).data()};
+
+			details::for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+				{
+				(pack_t::load(a_component + index) * pack_t::broadcast(scaling)).store(out_component + index);
+				});
+			}
+		}
+
+	/// <summary> out must be at least as big as the batches. </summary>
+	template <size_t extent>
+	void dot(const vecf_batch<extent>& a, const vecf_batch<extent>& b, std::span<float> out) noexcept
+		{
+		assert(a.size() == b.size() && out.size() >= a.size());
+		details::for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+			{
+			pack_t ret{pack_t::load(a.component(0).data() + index) * pack_t::load(b.component(0).data() + index)};
+			for (size_t c{1}; c < extent; c++)
+				{
+				ret = pack_t::fma(pack_t::load(a.component(c).data() + index), pack_t::load(b.component(c).data() + index), ret);
+				}
+			ret.store(out.data() + index);
+			});
+		}
+
+	/// <summary> out must be at least as big as the batch. </summary>
+	template <size_t extent>
+	void length(const vecf_batch<extent>& a, std::span<float> out) noexcept
+		{
+		assert(out.size() >= a.size());
+		details::for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+			{
+			pack_t::sqrt(details::length2_at<pack_t>(a, index)).store(out.data() + index);
+			});
+		}
+
+	/// <summary> Same as vec::normalize, zero length vectors are left unchanged. </summary>
+	template <size_t extent>
+	void normalize(const vecf_batch<extent>& a, vecf_batch<extent>& out) noexcept
+		{
+		out.resize(a.size());
+		details::for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+			{
+			const pack_t length {pack_t::sqrt(details::length2_at<pack_t>(a, index))};
+			const pack_t divisor{pack_t::select_zero(length, pack_t::broadcast(1.f), length)};
+			for (size_t c{0}; c < extent; c++)
+				{
+				(pack_t::load(a.component(c).data() + index) / divisor).store(out.component(c).data() + index);
+				}
+			});
+		}
+
+	template <size_t extent>
+	void lerp(const vecf_batch<extent>& a, const vecf_batch<extent>& b, float t, vecf_batch<extent>& out) noexcept
+		{
+		// Same formula as utils::math::lerp so results match the scalar path: a * (1 - t) + b * t.
+		const float one_minus_t{1.f - t};
+		details::component_wise(a, b, out, [one_minus_t, t]<typename pack_t>(pack_t a, pack_t b)
+			{
+			return pack_t::fma(a, pack_t::broadcast(one_minus_t), b * pack_t::broadcast(t));
+			});
+		}
+
+	/// <summary> Same as calling vec2f::transform on every point, evaluated as a single affine map. </summary>
+	inline void transform(const vec2f_batch& a, const utils::math::transform2& transform, vec2f_batch& out) noexcept
+		{
+		const utils::math::vec2f origin{utils::math::vec2f{0.f, 0.f}.transform(transform)};
+		const utils::math::vec2f step_x{utils::math::vec2f{1.f, 0.f}.transform(transform) - origin};
+		const utils::math::vec2f step_y{utils::math::vec2f{0.f, 1.f}.transform(transform) - origin};
+
+		out.resize(a.size());
+		details::for_each_pack(a.size(), [&]<typename pack_t>(size_t index)
+			{
+			const pack_t x{pack_t::load(a.x().data() + index)};
+			const pack_t y{pack_t::load(a.y().data() + index)};
+			pack_t::fma(x, pack_t::broadcast(step_x.x()), pack_t::fma(y, pack_t::broadcast(step_y.x()), pack_t::broadcast(origin.x()))).store(out.x().data() + index);
+			pack_t::fma(x, pack_t::broadcast(step_x.y()), pack_t::fma(y, pack_t::broadcast(step_y.y()), pack_t::broadcast(origin.y()))).store(out.y().data() + index);
+			});
+		}
+
+	template <size_t extent> vecf_batch<extent> operator+(const vecf_batch<extent>& a, const vecf_batch<extent>& b) { vecf_batch<extent> ret; add  (a, b      , ret); return ret; }
+	template <size_t extent> vecf_batch<extent> operator-(const vecf_batch<extent>& a, const vecf_batch<extent>& b) { vecf_batch<extent> ret; sub  (a, b      , ret); return ret; }
+	template <size_t extent> vecf_batch<extent> operator*(const vecf_batch<extent>& a, const vecf_batch<extent>& b) { vecf_batch<extent> ret; mul  (a, b      , ret); return ret; }
+	template <size_t extent> vecf_batch<extent> operator*(const vecf_batch<extent>& a, float scaling              ) { vecf_batch<extent> ret; scale(a, scaling, ret); return ret; }
+	}
\ No newline at end of file
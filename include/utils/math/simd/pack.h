@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#include "../../compilation/simd.h"
+#include "../../compilation/inline.h"
+
+#if defined(utils_compilation_simd_avx2) || defined(utils_compilation_simd_sse2)
+	#include <immintrin.h>
+#elif defined(utils_compilation_simd_neon)
+	#include <arm_neon.h>
+#endif
+
+// Thin wrappers over one SIMD register of floats, the widest available for the compilation target.
+// Kernels are written once against this interface and instantiated both with the native pack and with scalar_pack for the tail elements.
+
+namespace utils::math::simd::details
+	{
+	struct scalar_pack
+		{
+		using native_t = float;
+		inline static constexpr size_t width{1};
+		native_t value;
+
+		utils_force_inline static scalar_pack load     (const float* source) noexcept { return {*source}; }
+		utils_force_inline        void        store    (float* destination) const noexcept { *destination = value; }
+		utils_force_inline static scalar_pack broadcast(float value) noexcept { return {value}; }
+
+		utils_force_inline friend scalar_pack operator+(scalar_pack a, scalar_pack b) noexcept { return {a.value + b.value}; }
+		utils_force_inline friend scalar_pack operator-(scalar_pack a, scalar_pack b) noexcept { return {a.value - b.value}; }
+		utils_force_inline friend scalar_pack operator*(scalar_pack a, scalar_pack b) noexcept { return {a.value * b.value}; }
+		utils_force_inline friend scalar_pack operator/(scalar_pack a, scalar_pack b) noexcept { return {a.value / b.value}; }
+
+		/// <summary> a * b + c </summary>
+		utils_force_inline static scalar_pack fma (scalar_pack a, scalar_pack b, scalar_pack c) noexcept { return {(a.value * b.value) + c.value}; }
+		utils_force_inline static scalar_pack sqrt(scalar_pack a) noexcept { return {std::sqrt(a.value)}; }
+		utils_force_inline static scalar_pack min (scalar_pack a, scalar_pack b) noexcept { return {std::min(a.value, b.value)}; }
+		utils_force_inline static scalar_pack max (scalar_pack a, scalar_pack b) noexcept { return {std::max(a.value, b.value)}; }
+		/// <summary> Per lane, if_zero where condition is 0, otherwise otherwise. </summary>
+		utils_force_inline static scalar_pack select_zero(scalar_pack condition, scalar_pack if_zero, scalar_pack otherwise) noexcept { return {condition.value == 0.f ? if_zero.value : otherwise.value}; }
+		/// <summary> Per lane, if_less where a &lt; b, otherwise otherwise. </summary>
+		utils_force_inline static scalar_pack select_less(scalar_pack a, scalar_pack b, scalar_pack if_less, scalar_pack otherwise) noexcept { return {a.value < b.value ? if_less.value : otherwise.value}; }
+		};
+
+#if defined(utils_compilation_simd_avx2)
+	struct native_pack
+		{
+		using native_t = __m256;
+		inline static constexpr size_t width{8};
+		native_t value;
+
+		utils_force_inline static native_pack load     (const float* source) noexcept { return {_mm256_loadu_ps(source)}; }
+		utils_force_inline        void        store    (float* destination) const noexcept { _mm256_storeu_ps(destination, value); }
+		utils_force_inline static native_pack broadcast(float value) noexcept { return {_mm256_set1_ps(value)}; }
+
+		utils_force_inline friend native_pack operator+(native_pack a, native_pack b) noexcept { return {_mm256_add_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator-(native_pack a, native_pack b) noexcept { return {_mm256_sub_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator*(native_pack a, native_pack b) noexcept { return {_mm256_mul_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator/(native_pack a, native_pack b) noexcept { return {_mm256_div_ps(a.value, b.value)}; }
+
+	#if defined(utils_compilation_simd_fma)
+		utils_force_inline static native_pack fma(native_pack a, native_pack b, native_pack c) noexcept { return {_mm256_fmadd_ps(a.value, b.value, c.value)}; }
+	#else
+		utils_force_inline static native_pack fma(native_pack a, native_pack b, native_pack c) noexcept { return {_mm256_add_ps(_mm256_mul_ps(a.value, b.value), c.value)}; }
+	#endif
+		utils_force_inline static native_pack sqrt(native_pack a) noexcept { return {_mm256_sqrt_ps(a.value)}; }
+		utils_force_inline static native_pack min (native_pack a, native_pack b) noexcept { return {_mm256_min_ps(a.value, b.value)}; }
+		utils_force_inline static native_pack max (native_pack a, native_pack b) noexcept { return {_mm256_max_ps(a.value, b.value)}; }
+		utils_force_inline static native_pack select_zero(native_pack condition, native_pack if_zero, native_pack otherwise) noexcept
+			{
+			const __m256 mask{_mm256_cmp_ps(condition.value, _mm256_setzero_ps(), _CMP_EQ_OQ)};
+			return {_mm256_blendv_ps(otherwise.value, if_zero.value, mask)};
+			}
+		utils_force_inline static native_pack select_less(native_pack a, native_pack b, native_pack if_less, native_pack otherwise) noexcept
+			{
+			const __m256 mask{_mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ)};
+			return {_mm256_blendv_ps(otherwise.value, if_less.value, mask)};
+			}
+		};
+#elif defined(utils_compilation_simd_sse2)
+	struct native_pack
+		{
+		using native_t = __m128;
+		inline static constexpr size_t width{4};
+		native_t value;
+
+		utils_force_inline static native_pack load     (const float* source) noexcept { return {_mm_loadu_ps(source)}; }
+		utils_force_inline        void        store    (float* destination) const noexcept { _mm_storeu_ps(destination, value); }
+		utils_force_inline static native_pack broadcast(float value) noexcept { return {_mm_set1_ps(value)}; }
+
+		utils_force_inline friend native_pack operator+(native_pack a, native_pack b) noexcept { return {_mm_add_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator-(native_pack a, native_pack b) noexcept { return {_mm_sub_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator*(native_pack a, native_pack b) noexcept { return {_mm_mul_ps(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator/(native_pack a, native_pack b) noexcept { return {_mm_div_ps(a.value, b.value)}; }
+
+		utils_force_inline static native_pack fma (native_pack a, native_pack b, native_pack c) noexcept { return {_mm_add_ps(_mm_mul_ps(a.value, b.value), c.value)}; }
+		utils_force_inline static native_pack sqrt(native_pack a) noexcept { return {_mm_sqrt_ps(a.value)}; }
+		utils_force_inline static native_pack min (native_pack a, native_pack b) noexcept { return {_mm_min_ps(a.value, b.value)}; }
+		utils_force_inline static native_pack max (native_pack a, native_pack b) noexcept { return {_mm_max_ps(a.value, b.value)}; }
+		utils_force_inline static native_pack select_zero(native_pack condition, native_pack if_zero, native_pack otherwise) noexcept
+			{
+			// No blendv before SSE4.1.
+			const __m128 mask{_mm_cmpeq_ps(condition.value, _mm_setzero_ps())};
+			return {_mm_or_ps(_mm_and_ps(mask, if_zero.value), _mm_andnot_ps(mask, otherwise.value))};
+			}
+		utils_force_inline static native_pack select_less(native_pack a, native_pack b, native_pack if_less, native_pack otherwise) noexcept
+			{
+			const __m128 mask{_mm_cmplt_ps(a.value, b.value)};
+			return {_mm_or_ps(_mm_and_ps(mask, if_less.value), _mm_andnot_ps(mask, otherwise.value))};
+			}
+		};
+#elif defined(utils_compilation_simd_neon)
+	struct native_pack
+		{
+		using native_t = float32x4_t;
+		inline static constexpr size_t width{4};
+		native_t value;
+
+		utils_force_inline static native_pack load     (const float* source) noexcept { return {vld1q_f32(source)}; }
+		utils_force_inline        void        store    (float* destination) const noexcept { vst1q_f32(destination, value); }
+		utils_force_inline static native_pack broadcast(float value) noexcept { return {vdupq_n_f32(value)}; }
+
+		utils_force_inline friend native_pack operator+(native_pack a, native_pack b) noexcept { return {vaddq_f32(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator-(native_pack a, native_pack b) noexcept { return {vsubq_f32(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator*(native_pack a, native_pack b) noexcept { return {vmulq_f32(a.value, b.value)}; }
+		utils_force_inline friend native_pack operator/(native_pack a, native_pack b) noexcept { return {vdivq_f32(a.value, b.value)}; }
+
+		utils_force_inline static native_pack fma (native_pack a, native_pack b, native_pack c) noexcept { return {vfmaq_f32(c.value, a.value, b.value)}; }
+		utils_force_inline static native_pack sqrt(native_pack a) noexcept { return {vsqrtq_f32(a.value)}; }
+		utils_force_inline static native_pack min (native_pack a, native_pack b) noexcept { return {vminq_f32(a.value, b.value)}; }
+		utils_force_inline static native_pack max (native_pack a, native_pack b) noexcept { return {vmaxq_f32(a.value, b.value)}; }
+		utils_force_inline static native_pack select_zero(native_pack condition, native_pack if_zero, native_pack otherwise) noexcept
+			{
+			return {vbslq_f32(vceqq_f32(condition.value, vdupq_n_f32(0.f)), if_zero.value, otherwise.value)};
+			}
+		utils_force_inline static native_pack select_less(native_pack a, native_pack b, native_pack if_less, native_pack otherwise) noexcept
+			{
+			return {vbslq_f32(vcltq_f32(a.value, b.value), if_less.value, otherwise.value)};
+			}
+		};
+#else
+	using native_pack = scalar_pack;
+#endif
+
+	/// <summary> Calls kernel.template operator()&lt;pack_t&gt;(index) for every pack_t::width-th index in [0, size), with the native pack first and scalar_pack for the remainder. </summary>
+	template <typename kernel_t>
+	utils_force_inline inline void for_each_pack(size_t size, kernel_t&& kernel) noexcept
+		{
+		size_t index{0};
+		if constexpr (native_pack::width > 1)
+			{
+			for (; index + native_pack::width <= size; index += native_pack::width) { kernel.template operator()<native_pack>(index); }
+			}
+		for (; index < size; index++) { kernel.template operator()<scalar_pack>(index); }
+		}
+	}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <memory_resource>
+
+#include "resource_allocator.h"
+
+// Monotonic bump allocator meant for per-frame scratch data: allocating is a pointer bump, deallocating does nothing,
+// and reset reclaims everything at once. After a reset the arena keeps a single chunk as large as everything the previous frame used,
+// so in steady state a frame never reaches the upstream resource.
+
+namespace utils::memory
+	{
+	/// <summary>
+	/// Not thread safe. Usable as a std::pmr::memory_resource, or through arena_allocator which skips the virtual calls.
+	/// Memory handed out before a reset or release must not be used afterwards, containers using it must be destroyed (or abandoned) first.
+	/// </summary>
+	class arena : public std::pmr::memory_resource
+		{
+		public:
+			inline static constexpr size_t default_chunk_size{64 * 1024};
+
+			arena(size_t initial_chunk_size = default_chunk_size, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept :
+				upstream{upstream}, next_chunk_size{std::max(initial_chunk_size, sizeof(chunk_header) * 2)} {}
+			arena(std::pmr::memory_resource* upstream) noexcept : arena{default_chunk_size, upstream} {}
+
+			arena(const arena&) = delete;
+			arena& operator=(const arena&) = delete;
+			~arena() { release(); }
+
+			[[nodiscard]] void* allocate_bytes(size_t bytes, size_t alignment = alignof(std::max_align_t))
+				{
+				//Strict comparison: an empty arena (both pointers null) always takes the slow path, even for 0 bytes.
+				const uintptr_t aligned{(reinterpret_cast<uintptr_t>(cursor) + (alignment - 1)) & ~(alignment - 1)};
+				const uintptr_t end    {reinterpret_cast<uintptr_t>(chunk_end)};
+				if (aligned < end && bytes < end - aligned) [[likely]]
+					{
+					cursor = reinterpret_cast<std::byte*>(aligned + bytes);
+					return reinterpret_cast<void*>(aligned);
+					}
+				return allocate_from_new_chunk(bytes, alignment);
+				}
+			void deallocate_bytes(void*, size_t, size_t = alignof(std::max_align_t)) noexcept {}
+
+			/// <summary> Reclaims every allocation. If the last frame spilled over several chunks they're merged into one large enough for all of them. </summary>
+			void reset()
+				{
+				if (!chunks) { return; }
+				if (chunks->next)
+					{
+					const size_t total{capacity()};
+					release();
+					next_chunk_size = total + sizeof(chunk_header);
+					allocate_chunk(0, 1);
+					return;
+					}
+				cursor = chunks->data();
+				}
+
+			/// <summary> Reclaims every allocation and gives all the chunks back to the upstream resource. </summary>
+			void release() noexcept
+				{
+				while (chunks)
+					{
+					chunk_header* next{chunks->next};
+					const size_t size{chunks->size};
+					chunks->~chunk_header();
+					upstream->deallocate(chunks, size, alignof(chunk_header));
+					chunks = next;
+					}
+				cursor = chunk_end = nullptr;
+				used_in_previous_chunks = 0;
+				}
+
+			/// <summary> Bytes handed out since the last reset, alignment padding and space left at the end of full chunks included. </summary>
+			size_t used() const noexcept { return used_in_previous_chunks + (chunks ? static_cast<size_t>(cursor - chunks->data()) : 0); }
+			/// <summary> Usable bytes across all the chunks currently owned. </summary>
+			size_t capacity() const noexcept
+				{
+				size_t ret{0};
+				for (const chunk_header* chunk{chunks}; chunk; chunk = chunk->next) { ret += chunk->size - sizeof(chunk_header); }
+				return ret;
+				}
+
+			std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+		protected:
+			void* do_allocate(size_t bytes, size_t alignment) override { return allocate_bytes(bytes, alignment); }
+			void  do_deallocate(void* pointer, size_t bytes, size_t alignment) override { deallocate_bytes(pointer, bytes, alignment); }
+			bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		private:
+			struct alignas(std::max_align_t) chunk_header
+				{
+				chunk_header* next;
+				size_t size;
+
+				std::byte* data() noexcept { return reinterpret_cast<std::byte*>(this + 1); }
+				std::byte* end () noexcept { return reinterpret_cast<std::byte*>(this) + size; }
+				};
+
+			std::pmr::memory_resource* upstream;
+			chunk_header* chunks{nullptr};
+			std::byte* cursor   {nullptr};
+			std::byte* chunk_end{nullptr};
+			size_t next_chunk_size;
+			size_t used_in_previous_chunks{0};
+
+			void* allocate_from_new_chunk(size_t bytes, size_t alignment)
+				{
+				allocate_chunk(bytes, alignment);
+				return allocate_bytes(bytes, alignment);
+				}
+
+			/// <summary> Chunks grow geometrically, and are always large enough for the allocation that asked for them. </summary>
+			void allocate_chunk(size_t bytes, size_t alignment)
+				{
+				const size_t size{std::max(next_chunk_size, sizeof(chunk_header) + bytes + alignment)};
+				chunk_header* chunk{new(upstream->allocate(size, alignof(chunk_header))) chunk_header{chunks, size}};
+
+				// The whole previous chunk counts as used, including the space left at its end which won't be handed out anymore.
+				if (chunks) { used_in_previous_chunks += chunks->size - sizeof(chunk_header); }
+				chunks    = chunk;
+				cursor    = chunk->data();
+				chunk_end = chunk->end();
+				next_chunk_size = size * 2;
+				}
+		};
+
+	template <typename T>
+	using arena_allocator = resource_allocator<T, arena>;
+	}
\ No newline at end of file
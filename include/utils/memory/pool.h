@@ -0,0 +1,130 @@
+#pragma once
+
+#include <new>
+#include <bit>
+#include <array>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+
+#include "resource_allocator.h"
+
+// Size class pool allocator: requests up to max_block_size bytes are rounded up to a power of two and served from that size's free list,
+// refilled with chunks taken from the upstream resource. Freed blocks go back to their free list and are never returned upstream until release.
+// The upstream resource can be an arena, so a frame's node based containers recycle their nodes during the frame and drop everything on the arena's reset.
+
+namespace utils::memory
+	{
+	/// <summary>
+	/// Not thread safe. Usable as a std::pmr::memory_resource, or through pool_allocator which skips the virtual calls.
+	/// Requests larger than max_block_size go straight to the upstream resource.
+	/// </summary>
+	class pool : public std::pmr::memory_resource
+		{
+		public:
+			inline static constexpr size_t min_block_size{sizeof(void*)};
+			inline static constexpr size_t max_block_size{4096};
+			/// <summary> Chunks start with a few blocks and double on each refill of the same size class, up to this size or a single block. </summary>
+			inline static constexpr size_t max_chunk_size{64 * 1024};
+
+			pool(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept : upstream{upstream} {}
+
+			pool(const pool&) = delete;
+			pool& operator=(const pool&) = delete;
+			~pool() { release(); }
+
+			[[nodiscard]] void* allocate_bytes(size_t bytes, size_t alignment = alignof(std::max_align_t))
+				{
+				const size_t size{block_size(bytes, alignment)};
+				if (size > max_block_size) { return upstream->allocate(bytes, alignment); }
+
+				size_class_t& size_class{size_classes[class_index(size)]};
+				if (free_block* block{size_class.free_head}) [[likely]]
+					{
+					size_class.free_head = block->next;
+					return block;
+					}
+				return refill(size_class, size);
+				}
+
+			void deallocate_bytes(void* pointer, size_t bytes, size_t alignment = alignof(std::max_align_t)) noexcept
+				{
+				const size_t size{block_size(bytes, alignment)};
+				if (size > max_block_size) { upstream->deallocate(pointer, bytes, alignment); return; }
+
+				size_class_t& size_class{size_classes[class_index(size)]};
+				size_class.free_head = new(pointer) free_block{size_class.free_head};
+				}
+
+			/// <summary> Gives every chunk back to the upstream resource. Every block handed out so far becomes invalid, allocations larger than max_block_size are not affected. </summary>
+			void release() noexcept
+				{
+				while (chunks)
+					{
+					chunk_record record{*chunks};
+					upstream->deallocate(record.begin, record.size, record.alignment);
+					chunks = record.next;
+					}
+				size_classes = {};
+				}
+
+			std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+		protected:
+			void* do_allocate(size_t bytes, size_t alignment) override { return allocate_bytes(bytes, alignment); }
+			void  do_deallocate(void* pointer, size_t bytes, size_t alignment) override { deallocate_bytes(pointer, bytes, alignment); }
+			bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		private:
+			struct free_block
+				{
+				free_block* next;
+				};
+
+			/// <summary> Stored at the end of each chunk, after its blocks. </summary>
+			struct chunk_record
+				{
+				chunk_record* next;
+				void* begin;
+				size_t size;
+				size_t alignment;
+				};
+
+			struct size_class_t
+				{
+				free_block* free_head{nullptr};
+				size_t next_chunk_blocks{8};
+				};
+
+			inline static constexpr size_t classes_count{std::bit_width(max_block_size / min_block_size)};
+
+			std::pmr::memory_resource* upstream;
+			std::array<size_class_t, classes_count> size_classes{};
+			chunk_record* chunks{nullptr};
+
+			/// <summary> Blocks are aligned to their own size, so rounding up to the alignment is enough to honor it. </summary>
+			static size_t block_size (size_t bytes, size_t alignment) noexcept { return std::bit_ceil(std::max({bytes, alignment, min_block_size})); }
+			static size_t class_index(size_t size) noexcept { return static_cast<size_t>(std::countr_zero(size / min_block_size)); }
+
+			void* refill(size_class_t& size_class, size_t size)
+				{
+				const size_t blocks{std::min(size_class.next_chunk_blocks, std::max<size_t>(max_chunk_size / size, 1))};
+				const size_t blocks_bytes{blocks * size};
+				const size_t alignment{std::max(size, alignof(chunk_record))};
+				const size_t chunk_size{blocks_bytes + sizeof(chunk_record)};
+
+				std::byte* begin{static_cast<std::byte*>(upstream->allocate(chunk_size, alignment))};
+				chunks = new(begin + blocks_bytes) chunk_record{chunks, begin, chunk_size, alignment};
+				size_class.next_chunk_blocks = blocks * 2;
+
+				//The first block is returned, the others are chained in address order.
+				free_block* head{size_class.free_head};
+				for (size_t i{blocks}; i-- > 1;) { head = new(begin + i * size) free_block{head}; }
+				size_class.free_head = head;
+				return begin;
+				}
+		};
+
+	template <typename T>
+	using pool_allocator = resource_allocator<T, pool>;
+	}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <new>
+#include <limits>
+#include <cstddef>
+
+// Standard allocator over a utils::memory resource (arena, pool). Holds a plain pointer to the resource and calls its allocate_bytes and deallocate_bytes directly,
+// which the compiler can inline, where std::pmr::polymorphic_allocator goes through the virtual memory_resource interface.
+
+namespace utils::memory
+	{
+	/// <summary> The resource must outlive every container using the allocator. Allocators compare equal when they share the same resource. </summary>
+	template <typename T, typename resource_t>
+	class resource_allocator
+		{
+		template <typename U, typename other_resource_t>
+		friend class resource_allocator;
+
+		public:
+			using value_type = T;
+
+			resource_allocator(resource_t& resource) noexcept : resource{&resource} {}
+
+			template <typename U>
+			resource_allocator(const resource_allocator<U, resource_t>& other) noexcept : resource{other.resource} {}
+
+			[[nodiscard]] T* allocate(size_t count)
+				{
+				if (count > std::numeric_limits<size_t>::max() / sizeof(T)) { throw std::bad_array_new_length{}; }
+				return static_cast<T*>(resource->allocate_bytes(count * sizeof(T), alignof(T)));
+				}
+
+			void deallocate(T* pointer, size_t count) noexcept { resource->deallocate_bytes(pointer, count * sizeof(T), alignof(T)); }
+
+			resource_t& get_resource() const noexcept { return *resource; }
+
+			template <typename U>
+			bool operator==(const resource_allocator<U, resource_t>& other) const noexcept { return resource == other.resource; }
+
+		private:
+			resource_t* resource;
+		};
+	}
\ No newline at end of file
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <cstddef>
+#include <concepts>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
+#include <condition_variable>
+
+#include "thread_pool.h"
+#include "math/rect.h"
+#include "logging/progress_bar.h"
+
+// Adaptive grain parallel loops over a utils::thread_pool, by lazy binary splitting: a task walks its range one grain at a time,
+// and before each grain it splits the rest of its range in half and pushes the upper half, but only if its own deque is empty.
+// A non-empty deque means the previous half wasn't stolen yet, so nobody is idle and splitting further would only add overhead.
+// Ranges whose elements take wildly different times keep splitting where the work is, instead of leaving threads idle after static blocks.
+// The calling thread works on the loop as well, then helps with any queued task of the pool until the loop completed.
+
+namespace utils
+	{
+	namespace details::parallel_for
+		{
+		struct range_1d
+			{
+			size_t begin;
+			size_t end;
+
+			size_t size() const noexcept { return end - begin; }
+
+			std::pair<range_1d, range_1d> split() const noexcept
+				{
+				const size_t middle{begin + size() / 2};
+				return {range_1d{begin, middle}, range_1d{middle, end}};
+				}
+
+			/// <summary> First grain elements and the rest. </summary>
+			std::pair<range_1d, range_1d> take(size_t grain) const noexcept
+				{
+				const size_t first_end{begin + std::min(grain, size())};
+				return {range_1d{begin, first_end}, range_1d{first_end, end}};
+				}
+			};
+
+		struct range_2d
+			{
+			utils::math::rect<size_t> rect;
+
+			size_t width () const noexcept { return rect.rr() > rect.ll() ? rect.rr() - rect.ll() : 0; }
+			size_t height() const noexcept { return rect.dw() > rect.up() ? rect.dw() - rect.up() : 0; }
+			size_t size  () const noexcept { return width() * height(); }
+
+			/// <summary> Halves the longer side, keeps the pieces close to square. </summary>
+			std::pair<range_2d, range_2d> split() const noexcept
+				{
+				if (width() > height())
+					{
+					const size_t middle{rect.ll() + width() / 2};
+					return {range_2d{{rect.ll(), rect.up(), middle   , rect.dw()}}, range_2d{{middle, rect.up(), rect.rr(), rect.dw()}}};
+					}
+				const size_t middle{rect.up() + height() / 2};
+				return {range_2d{{rect.ll(), rect.up(), rect.rr(), middle   }}, range_2d{{rect.ll(), middle, rect.rr(), rect.dw()}}};
+				}
+
+			/// <summary> Whole rows totaling about grain elements, or part of the row if the rect is a single row. </summary>
+			std::pair<range_2d, range_2d> take(size_t grain) const noexcept
+				{
+				if (height() > 1)
+					{
+					const size_t rows{std::clamp<size_t>(grain / std::max<size_t>(width(), 1), 1, height())};
+					return {range_2d{{rect.ll(), rect.up(), rect.rr(), rect.up() + rows}}, range_2d{{rect.ll(), rect.up() + rows, rect.rr(), rect.dw()}}};
+					}
+				const size_t columns{std::min(grain, width())};
+				return {range_2d{{rect.ll(), rect.up(), rect.ll() + columns, rect.dw()}}, range_2d{{rect.ll() + columns, rect.up(), rect.rr(), rect.dw()}}};
+				}
+			};
+
+		/// <summary> Default grain: a few hundred grains per thread, small enough to balance uneven work, large enough that the per grain check doesn't matter. </summary>
+		inline size_t automatic_grain(size_t size, concurrency_t thread_count) noexcept { return std::max<size_t>(1, size / (static_cast<size_t>(thread_count) * 256)); }
+
+		/// <summary> Forwards completed elements to a progress bar. Only one thread at a time advances the bar, the others leave their count behind for it. </summary>
+		template <typename progress_bar_t>
+		class progress_reporter
+			{
+			public:
+				progress_reporter(progress_bar_t& partial_progress, size_t elements_count, size_t steps_count) :
+					elements_count{std::max<size_t>(elements_count, 1)}, steps_count{steps_count}, progress{partial_progress.split(steps_count)} {}
+
+				void completed(size_t elements) noexcept
+					{
+					const size_t done{elements_done.fetch_add(elements, std::memory_order_relaxed) + elements};
+					if (!mutex.try_lock()) { return; }
+					advance_to(done * steps_count / elements_count);
+					mutex.unlock();
+					}
+
+				/// <summary> Called once every element completed, there's no concurrent completed left by then. </summary>
+				void finish() noexcept
+					{
+					std::scoped_lock lock{mutex};
+					advance_to(steps_count);
+					}
+
+			private:
+				const size_t elements_count;
+				const size_t steps_count;
+				std::atomic<size_t> elements_done{0};
+				std::mutex mutex;
+				size_t steps_done{0};
+				progress_bar_t progress;
+
+				void advance_to(size_t steps) noexcept { for (; steps_done < steps; steps_done++) { progress.advance(); } }
+			};
+
+		struct no_progress
+			{
+			void completed(size_t) const noexcept {}
+			void finish() const noexcept {}
+			};
+
+		template <typename range_t, typename body_t, typename progress_t>
+		class loop
+			{
+			public:
+				loop(thread_pool& pool, body_t& body, progress_t& progress, size_t grain) noexcept : pool{pool}, body{body}, progress{progress}, grain{grain} {}
+
+				void run(range_t range)
+					{
+					run_piece(range);
+
+					while (pending.load(std::memory_order_acquire) != 0 && pool.run_pending_task()) {}
+					if (true)
+						{
+						std::unique_lock lock{completion_mutex};
+						completion_cv.wait(lock, [this] { return completed; });
+						}
+
+					if (exception) { std::rethrow_exception(exception); }
+					progress.finish();
+					}
+
+			private:
+				thread_pool& pool;
+				body_t& body;
+				progress_t& progress;
+				const size_t grain;
+
+				// The caller's own piece counts as the first pending one.
+				std::atomic<size_t> pending{1};
+				std::atomic<bool> failed{false};
+				std::exception_ptr exception;
+
+				std::mutex completion_mutex;
+				std::condition_variable completion_cv;
+				bool completed{false};
+
+				/// <summary> Workers split when their own deque is empty. Other threads can't see a deque of theirs, they split when the whole pool has no queued task. </summary>
+				bool should_split() const noexcept { return pool.is_worker_thread() ? !pool.has_local_tasks() : pool.get_tasks_queued() == 0; }
+
+				void run_piece(range_t range) noexcept
+					{
+					try
+						{
+						while (range.size() > grain && !failed.load(std::memory_order_relaxed))
+							{
+							if (should_split())
+								{
+								auto [lower, upper]{range.split()};
+								pending.fetch_add(1, std::memory_order_relaxed);
+								try { pool.push_task([this, upper]() { run_piece(upper); }); }
+								catch (...) { pending.fetch_sub(1, std::memory_order_relaxed); throw; }
+								range = lower;
+								continue;
+								}
+							auto [chunk, rest]{range.take(grain)};
+							run_body(chunk);
+							range = rest;
+							}
+						if (!failed.load(std::memory_order_relaxed)) { run_body(range); }
+						}
+					catch (...)
+						{
+						if (!failed.exchange(true, std::memory_order_relaxed)) { exception = std::current_exception(); }
+						}
+
+					if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+						{
+						// Notified under the lock: once the caller observes completed it returns and destroys the loop, nothing here touches it after the unlock.
+						std::scoped_lock lock{completion_mutex};
+						completed = true;
+						completion_cv.notify_all();
+						}
+					}
+
+				void run_body(const range_t& range)
+					{
+					if constexpr (std::same_as<range_t, range_1d>)
+						{
+						if constexpr (std::invocable<body_t&, size_t, size_t>) { body(range.begin, range.end); }
+						else { for (size_t i{range.begin}; i < range.end; i++) { body(i); } }
+						}
+					else
+						{
+						if constexpr (std::invocable<body_t&, const utils::math::rect<size_t>&>) { body(range.rect); }
+						else
+							{
+							for (size_t y{range.rect.up()}; y < range.rect.dw(); y++)
+								{
+								for (size_t x{range.rect.ll()}; x < range.rect.rr(); x++) { body(x, y); }
+								}
+							}
+						}
+					progress.completed(range.size());
+					}
+			};
+
+		template <typename range_t, typename F, typename progress_t>
+		void run(thread_pool& pool, range_t range, F& body, progress_t& progress, size_t grain)
+			{
+			if (range.size() == 0) { progress.finish(); return; }
+			loop<range_t, F, progress_t> loop{pool, body, progress, grain ? grain : automatic_grain(range.size(), pool.get_thread_count())};
+			loop.run(range);
+			}
+
+		template <typename F>
+		concept body_1d = std::invocable<F&, size_t, size_t> || std::invocable<F&, size_t>;
+		template <typename F>
+		concept body_2d = std::invocable<F&, const utils::math::rect<size_t>&> || std::invocable<F&, size_t, size_t>;
+		}
+
+	/// <summary>
+	/// Calls body for every index in [begin, end) on the pool's workers and the calling thread, blocks until done and rethrows the first exception thrown by body.
+	/// body is called either as body(index), or as body(range_begin, range_end) on consecutive sub-ranges. grain is the amount of indices processed between two splitting checks, 0 picks one automatically.
+	/// Can be called from inside a pool task.
+	/// </summary>
+	template <details::parallel_for::body_1d F>
+	void parallel_for(thread_pool& pool, size_t begin, size_t end, F&& body, size_t grain = 0)
+		{
+		details::parallel_for::no_progress progress;
+		details::parallel_for::run(pool, details::parallel_for::range_1d{begin, std::max(begin, end)}, body, progress, grain);
+		}
+
+	/// <summary> Same as parallel_for, and advances a child of partial_progress with steps_count steps as indices complete. </summary>
+	template <logging::bar_parameters bar, details::parallel_for::body_1d F>
+	void parallel_for(thread_pool& pool, size_t begin, size_t end, F&& body, logging::progress_bar<bar>& partial_progress, size_t steps_count = 100, size_t grain = 0)
+		{
+		details::parallel_for::progress_reporter<logging::progress_bar<bar>> progress{partial_progress, end > begin ? end - begin : 0, steps_count};
+		details::parallel_for::run(pool, details::parallel_for::range_1d{begin, std::max(begin, end)}, body, progress, grain);
+		}
+
+	/// <summary>
+	/// Calls body for every coordinate in rect on the pool's workers and the calling thread, blocks until done and rethrows the first exception thrown by body.
+	/// body is called either as body(x, y), or as body(sub_rect) on sub-rects covering rect. Sub-rects split along their longer side, and are walked a few rows at a time.
+	/// grain is the amount of elements processed between two splitting checks, 0 picks one automatically.
+	/// </summary>
+	template <details::parallel_for::body_2d F>
+	void parallel_for(thread_pool& pool, const utils::math::rect<size_t>& rect, F&& body, size_t grain = 0)
+		{
+		details::parallel_for::no_progress progress;
+		details::parallel_for::run(pool, details::parallel_for::range_2d{rect}, body, progress, grain);
+		}
+
+	/// <summary> Same as the 2D parallel_for, and advances a child of partial_progress with steps_count steps as elements complete. </summary>
+	template <logging::bar_parameters bar, details::parallel_for::body_2d F>
+	void parallel_for(thread_pool& pool, const utils::math::rect<size_t>& rect, F&& body, logging::progress_bar<bar>& partial_progress, size_t steps_count = 100, size_t grain = 0)
+		{
+		const details::parallel_for::range_2d range{rect};
+		details::parallel_for::progress_reporter<logging::progress_bar<bar>> progress{partial_progress, range.size(), steps_count};
+		details::parallel_for::run(pool, range, body, progress, grain);
+		}
+	}
\ No newline at end of file
@@ -0,0 +1,433 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <variant>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <concepts>
+#include <exception>
+#include <stdexcept>
+#include <coroutine>
+#include <type_traits>
+#include <condition_variable>
+
+#include "thread_pool.h"
+
+// C++20 coroutine tasks. A utils::task<T> is lazy: it starts when awaited, and resumes its awaiter through symmetric transfer when it completes,
+// so long chains of awaits don't grow the stack. The value or exception lives in the coroutine frame, there's no separate shared state like std::promise has.
+// co_await utils::resume_on(pool) moves the rest of a coroutine to a thread_pool worker; that's the only way work leaves the current thread.
+// when_all/when_any start several tasks at once and resume the awaiter when all of them, or the first one, completed.
+// sync_wait is the blocking bridge for code outside of coroutines.
+
+namespace utils
+	{
+	template <typename T = void>
+	class task;
+
+	namespace details
+		{
+		class task_promise_base
+			{
+			public:
+				struct final_awaiter
+					{
+					bool await_ready() const noexcept { return false; }
+
+					template <typename promise_t>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_t> handle) noexcept { return handle.promise().continuation; }
+
+					void await_resume() const noexcept {}
+					};
+
+				std::suspend_always initial_suspend() const noexcept { return {}; }
+				final_awaiter       final_suspend  () const noexcept { return {}; }
+
+				void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+				void set_continuation(std::coroutine_handle<> handle) noexcept { continuation = handle; }
+
+			protected:
+				std::coroutine_handle<> continuation{std::noop_coroutine()};
+				std::exception_ptr exception;
+
+				void rethrow_if_failed() const { if (exception) { std::rethrow_exception(exception); } }
+			};
+
+		template <typename T>
+		class task_promise : public task_promise_base
+			{
+			static_assert(!std::is_reference_v<T>, "utils::task can't return references, return a pointer or a std::reference_wrapper instead.");
+
+			public:
+				task<T> get_return_object() noexcept;
+
+				template <typename U = T>
+					requires std::constructible_from<T, U&&>
+				void return_value(U&& value) noexcept(std::is_nothrow_constructible_v<T, U&&>) { this->value.emplace(std::forward<U>(value)); }
+
+				T& result() &  { rethrow_if_failed(); return *value; }
+				T  result() && { rethrow_if_failed(); return std::move(*value); }
+
+			private:
+				std::optional<T> value;
+			};
+
+		template <>
+		class task_promise<void> : public task_promise_base
+			{
+			public:
+				task<void> get_return_object() noexcept;
+
+				void return_void() const noexcept {}
+
+				void result() const { rethrow_if_failed(); }
+			};
+		}
+
+	/// <summary>
+	/// Lazily started coroutine: the body runs when the task is awaited, on the thread that awaits it, until it awaits something else.
+	/// Owns its coroutine frame, destroying a task which was started but didn't complete yet is undefined behaviour.
+	/// </summary>
+	template <typename T>
+	class [[nodiscard]] task
+		{
+		public:
+			using promise_type = details::task_promise<T>;
+			using value_type   = T;
+
+			task() noexcept = default;
+			task(const task& copy) = delete;
+			task& operator=(const task& copy) = delete;
+			task(task&& move) noexcept : handle{std::exchange(move.handle, nullptr)} {}
+			task& operator=(task&& move) noexcept
+				{
+				if (this != &move)
+					{
+					if (handle) { handle.destroy(); }
+					handle = std::exchange(move.handle, nullptr);
+					}
+				return *this;
+				}
+			~task() { if (handle) { handle.destroy(); } }
+
+			[[nodiscard]] bool valid   () const noexcept { return static_cast<bool>(handle); }
+			[[nodiscard]] bool is_ready() const noexcept { return !handle || handle.done(); }
+
+			/// <summary> Starts the task and suspends the awaiter until it completed. Results in the task's value, or rethrows its exception. </summary>
+			auto operator co_await() & noexcept
+				{
+				struct awaiter : awaiter_base { decltype(auto) await_resume() { return this->handle.promise().result(); } };
+				return awaiter{handle};
+				}
+			auto operator co_await() && noexcept
+				{
+				struct awaiter : awaiter_base { decltype(auto) await_resume() { return std::move(this->handle.promise()).result(); } };
+				return awaiter{handle};
+				}
+
+			/// <summary> Same as co_await, except it results in nothing and never throws. The outcome is retrieved afterwards with result. </summary>
+			auto when_ready() noexcept
+				{
+				struct awaiter : awaiter_base { void await_resume() const noexcept {} };
+				return awaiter{handle};
+				}
+
+			/// <summary> Value of a completed task, or rethrows its exception. </summary>
+			decltype(auto) result() &  { return handle.promise().result(); }
+			decltype(auto) result() && { return std::move(handle.promise()).result(); }
+
+		private:
+			friend class details::task_promise<T>;
+			explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle{handle} {}
+
+			std::coroutine_handle<promise_type> handle{nullptr};
+
+			struct awaiter_base
+				{
+				std::coroutine_handle<promise_type> handle;
+
+				bool await_ready() const noexcept { return !handle || handle.done(); }
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+					{
+					handle.promise().set_continuation(awaiting);
+					return handle;
+					}
+				};
+		};
+
+	namespace details
+		{
+		template <typename T>
+		task<T> task_promise<T>::get_return_object() noexcept { return task<T>{std::coroutine_handle<task_promise<T>>::from_promise(*this)}; }
+		inline task<void> task_promise<void>::get_return_object() noexcept { return task<void>{std::coroutine_handle<task_promise<void>>::from_promise(*this)}; }
+
+		template <typename T>
+		using non_void_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+		template <typename T>
+		non_void_t<T> take_result(task<T>& task)
+			{
+			if constexpr (std::is_void_v<T>) { task.result(); return {}; }
+			else { return std::move(task).result(); }
+			}
+
+		/// <summary>
+		/// Helper coroutine that starts when resumed and, once the task it awaits completed, lets its promise decide what runs next.
+		/// The frame is destroyed by whoever owns the handle (when_all, sync_wait) or by itself at the end (when_any).
+		/// </summary>
+		template <typename on_completion_t>
+		class notifier
+			{
+			public:
+				struct promise_type
+					{
+					on_completion_t on_completion;
+
+					template <typename... Args>
+					promise_type(on_completion_t on_completion, Args&...) noexcept : on_completion{std::move(on_completion)} {}
+
+					notifier get_return_object() noexcept { return notifier{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+
+					std::suspend_always initial_suspend() const noexcept { return {}; }
+					auto final_suspend() noexcept
+						{
+						struct awaiter
+							{
+							bool await_ready() const noexcept { return false; }
+							std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept { return handle.promise().on_completion(handle); }
+							void await_resume() const noexcept {}
+							};
+						return awaiter{};
+						}
+
+					void return_void() const noexcept {}
+					// Only awaits when_ready, which never throws.
+					void unhandled_exception() const noexcept { std::terminate(); }
+					};
+
+				notifier() noexcept = default;
+				notifier(const notifier& copy) = delete;
+				notifier& operator=(const notifier& copy) = delete;
+				notifier(notifier&& move) noexcept : handle{std::exchange(move.handle, nullptr)} {}
+				notifier& operator=(notifier&& move) noexcept { std::swap(handle, move.handle); return *this; }
+				~notifier() { if (handle) { handle.destroy(); } }
+
+				void start() noexcept { handle.resume(); }
+
+				/// <summary> Ownership of the frame goes to the frame itself, its on_completion must destroy it. </summary>
+				void detach_and_start() noexcept { std::exchange(handle, nullptr).resume(); }
+
+			private:
+				explicit notifier(std::coroutine_handle<promise_type> handle) noexcept : handle{handle} {}
+				std::coroutine_handle<promise_type> handle{nullptr};
+			};
+
+		template <typename on_completion_t, typename T>
+		notifier<on_completion_t> make_notifier(on_completion_t, task<T>& task) { co_await task.when_ready(); }
+
+		/// <summary> Counts the started tasks plus the awaiter: whoever arrives last resumes the awaiter. </summary>
+		struct when_all_latch
+			{
+			std::atomic<size_t> remaining;
+			std::coroutine_handle<> awaiting{nullptr};
+
+			std::coroutine_handle<> arrive() noexcept { return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 ? awaiting : std::noop_coroutine(); }
+			};
+
+		struct when_all_on_completion
+			{
+			when_all_latch* latch;
+			std::coroutine_handle<> operator()(std::coroutine_handle<>) const noexcept { return latch->arrive(); }
+			};
+
+		/// <summary> Starts every notifier, then suspends unless all of them already completed synchronously. </summary>
+		template <typename notifiers_t>
+		struct when_all_awaiter
+			{
+			when_all_latch& latch;
+			notifiers_t& notifiers;
+
+			bool await_ready() const noexcept { return false; }
+			bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+				latch.awaiting = awaiting;
+				for (auto& notifier : notifiers) { notifier.start(); }
+				return latch.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+				}
+			void await_resume() const noexcept {}
+			};
+
+		template <typename T>
+		struct when_any_state
+			{
+			when_any_state(std::vector<task<T>>&& tasks) noexcept : tasks{std::move(tasks)} {}
+
+			std::vector<task<T>> tasks;
+			std::atomic<bool> done{false};
+			size_t winner{0};
+			// The awaiter and the winner both arrive, the second one to arrive resumes the awaiter.
+			std::atomic<size_t> arrivals{0};
+			std::coroutine_handle<> awaiting{nullptr};
+			};
+
+		template <typename T>
+		struct when_any_on_completion
+			{
+			std::shared_ptr<when_any_state<T>> state;
+			size_t index;
+
+			std::coroutine_handle<> operator()(std::coroutine_handle<> handle) noexcept
+				{
+				std::coroutine_handle<> next{std::noop_coroutine()};
+				if (!state->done.exchange(true, std::memory_order_acq_rel))
+					{
+					state->winner = index;
+					if (state->arrivals.fetch_add(1, std::memory_order_acq_rel) == 1) { next = state->awaiting; }
+					}
+				// Detached frame: destroying it releases this notifier's reference to the state, this object must not be used afterwards.
+				handle.destroy();
+				return next;
+				}
+			};
+
+		struct sync_wait_state
+			{
+			std::mutex mutex;
+			std::condition_variable cv;
+			bool done{false};
+			};
+
+		struct sync_wait_on_completion
+			{
+			sync_wait_state* state;
+
+			std::coroutine_handle<> operator()(std::coroutine_handle<>) const noexcept
+				{
+				// Notified under the lock: sync_wait can't return and destroy the state before this is done with it.
+				std::scoped_lock lock{state->mutex};
+				state->done = true;
+				state->cv.notify_all();
+				return std::noop_coroutine();
+				}
+			};
+		}
+
+	template <typename T>
+	struct when_any_result
+		{
+		size_t index;
+		T value;
+		};
+	template <>
+	struct when_any_result<void>
+		{
+		size_t index;
+		};
+
+#pragma region awaitables
+	/// <summary> co_await resume_on(pool) suspends the coroutine and resumes it on one of the pool's workers. It's counted as a task of the pool while queued. </summary>
+	inline auto resume_on(thread_pool& pool) noexcept
+		{
+		struct awaiter
+			{
+			thread_pool& pool;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { pool.push_task([handle]() { handle.resume(); }); }
+			void await_resume() const noexcept {}
+			};
+		return awaiter{pool};
+		}
+
+	/// <summary> Starts every task and completes once all of them completed. Results in a tuple of their values, void tasks contribute a std::monostate. Rethrows the first exception in argument order. </summary>
+	template <typename... Ts>
+	task<std::tuple<details::non_void_t<Ts>...>> when_all(task<Ts>... tasks)
+		{
+		details::when_all_latch latch{sizeof...(Ts) + 1};
+		std::array<details::notifier<details::when_all_on_completion>, sizeof...(Ts)> notifiers{details::make_notifier(details::when_all_on_completion{&latch}, tasks)...};
+		co_await details::when_all_awaiter<decltype(notifiers)>{latch, notifiers};
+		co_return std::tuple<details::non_void_t<Ts>...>{details::take_result(tasks)...};
+		}
+
+	/// <summary> Starts every task and completes once all of them completed. Results in their values in the same order, rethrows the first exception in order. </summary>
+	template <typename T>
+	task<std::conditional_t<std::is_void_v<T>, void, std::vector<details::non_void_t<T>>>> when_all(std::vector<task<T>> tasks)
+		{
+		details::when_all_latch latch{tasks.size() + 1};
+		std::vector<details::notifier<details::when_all_on_completion>> notifiers;
+		notifiers.reserve(tasks.size());
+		for (auto& task : tasks) { notifiers.emplace_back(details::make_notifier(details::when_all_on_completion{&latch}, task)); }
+		co_await details::when_all_awaiter<decltype(notifiers)>{latch, notifiers};
+
+		if constexpr (std::is_void_v<T>)
+			{
+			for (auto& task : tasks) { task.result(); }
+			}
+		else
+			{
+			std::vector<T> ret;
+			ret.reserve(tasks.size());
+			for (auto& task : tasks) { ret.emplace_back(std::move(task).result()); }
+			co_return ret;
+			}
+		}
+
+	/// <summary>
+	/// Starts every task and completes as soon as one of them completed, with its index and value, or rethrows its exception.
+	/// The other tasks keep running to completion, their results are discarded. They share one allocated block with the awaiter, freed by whoever finishes last.
+	/// Throws std::invalid_argument if tasks is empty.
+	/// </summary>
+	template <typename T>
+	task<when_any_result<T>> when_any(std::vector<task<T>> tasks)
+		{
+		if (tasks.empty()) { throw std::invalid_argument{"when_any needs at least one task."}; }
+
+		auto state{std::make_shared<details::when_any_state<T>>(std::move(tasks))};
+
+		struct awaiter
+			{
+			details::when_any_state<T>& state;
+			std::vector<details::notifier<details::when_any_on_completion<T>>> notifiers;
+
+			bool await_ready() const noexcept { return false; }
+			bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+				state.awaiting = awaiting;
+				for (auto& notifier : notifiers) { notifier.detach_and_start(); }
+				return state.arrivals.fetch_add(1, std::memory_order_acq_rel) == 0;
+				}
+			void await_resume() const noexcept {}
+			};
+
+		// Notifiers are created before anything starts, so that allocating them can still fail safely.
+		awaiter start_all{*state};
+		start_all.notifiers.reserve(state->tasks.size());
+		for (size_t i = 0; i < state->tasks.size(); i++) { start_all.notifiers.emplace_back(details::make_notifier(details::when_any_on_completion<T>{state, i}, state->tasks[i])); }
+		co_await start_all;
+
+		task<T>& winner{state->tasks[state->winner]};
+		if constexpr (std::is_void_v<T>) { winner.result(); co_return when_any_result<T>{state->winner}; }
+		else { co_return when_any_result<T>{state->winner, std::move(winner).result()}; }
+		}
+#pragma endregion awaitables
+
+	/// <summary> Starts the task on the calling thread and blocks until it completed. Must not be called from a thread pool worker the task needs to make progress. </summary>
+	template <typename T>
+	details::non_void_t<T> sync_wait(task<T> task)
+		{
+		details::sync_wait_state state;
+		auto notifier{details::make_notifier(details::sync_wait_on_completion{&state}, task)};
+		notifier.start();
+
+		std::unique_lock lock{state.mutex};
+		state.cv.wait(lock, [&state] { return state.done; });
+		return details::take_result(task);
+		}
+	}
\ No newline at end of file
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <concepts>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <condition_variable>
+
+#include "thread_pool.h"
+#include "inplace_function.h"
+
+// Dependency graph of tasks executed on a utils::thread_pool: each task is submitted as soon as all of its predecessors completed,
+// there's no barrier between "phases". Completing a task releases its successors; one of the released successors runs right away on the same worker,
+// the others are pushed to that worker's deque where idle workers can steal them.
+// The graph is built once and can be executed again and again (i.e. once per frame): executing it resets the dependency counters in place and doesn't allocate.
+// Every execution also records when each task started and finished, critical_path reports the longest dependency chain of the last execution.
+
+namespace utils
+	{
+	class task_graph
+		{
+		public:
+			using clock_t    = std::chrono::steady_clock;
+			using duration_t = clock_t::duration;
+
+			class task
+				{
+				friend class task_graph;
+				public:
+					/// <summary> The given tasks start only after this one completed. </summary>
+					template <std::same_as<task>... tasks_t>
+					task& precede(tasks_t... others) { (graph->add_edge(index, others.index), ...); return *this; }
+
+					/// <summary> This task starts only after all the given ones completed. </summary>
+					template <std::same_as<task>... tasks_t>
+					task& succeed(tasks_t... others) { (graph->add_edge(others.index, index), ...); return *this; }
+
+					task& name(std::string name) { graph->nodes[index].name = std::move(name); return *this; }
+					const std::string& name() const noexcept { return graph->nodes[index].name; }
+
+					/// <summary> Time spent running this task during the last execution of the graph. </summary>
+					duration_t duration() const noexcept { return graph->nodes[index].duration(); }
+
+					size_t get_index() const noexcept { return index; }
+
+					bool operator==(const task& other) const noexcept = default;
+
+				private:
+					task(task_graph* graph, size_t index) noexcept : graph{graph}, index{index} {}
+
+					task_graph* graph;
+					size_t index;
+				};
+
+			struct critical_path_report
+				{
+				/// <summary> Longest chain of dependent tasks of the last execution, in execution order. </summary>
+				std::vector<task> tasks;
+				/// <summary> Sum of the durations of the tasks in the chain: no amount of threads can complete the graph faster than this. </summary>
+				duration_t length   {0};
+				/// <summary> Sum of the durations of all the tasks. </summary>
+				duration_t work     {0};
+				/// <summary> From the call to execute to the completion of the last task. </summary>
+				duration_t wall_time{0};
+
+				/// <summary> Average amount of tasks that could run concurrently, work / length. </summary>
+				double parallelism() const noexcept { return length.count() ? static_cast<double>(work.count()) / static_cast<double>(length.count()) : 0.0; }
+				};
+
+			task_graph() = default;
+			task_graph(const task_graph& copy) = delete;
+			task_graph& operator=(const task_graph& copy) = delete;
+
+			/// <summary> Waits for a running execution to complete. </summary>
+			~task_graph() { wait_for_completion(); }
+
+#pragma region building
+			/// <summary> Adds a task with no dependencies. Use the returned task's precede/succeed to connect it. </summary>
+			template <typename F>
+				requires std::is_invocable_v<std::decay_t<F>&>
+			task emplace(F&& function)
+				{
+				check_not_running();
+				nodes.emplace_back();
+				try { assign(nodes.back().function, std::forward<F>(function)); }
+				catch (...) { nodes.pop_back(); throw; }
+				topology_changed = true;
+				return task{this, nodes.size() - 1};
+				}
+
+			/// <summary> Adds a task that starts only after all the given ones completed. </summary>
+			template <typename F, std::same_as<task>... tasks_t>
+				requires std::is_invocable_v<std::decay_t<F>&>
+			task emplace(F&& function, tasks_t... dependencies)
+				{
+				task ret{emplace(std::forward<F>(function))};
+				ret.succeed(dependencies...);
+				return ret;
+				}
+
+			/// <summary> Removes every task. </summary>
+			void clear()
+				{
+				check_not_running();
+				nodes.clear();
+				topology_changed = true;
+				}
+
+			[[nodiscard]] size_t size () const noexcept { return nodes.size(); }
+			[[nodiscard]] bool   empty() const noexcept { return nodes.empty(); }
+#pragma endregion building
+
+#pragma region execution
+			/// <summary>
+			/// Submits the tasks without dependencies to the thread pool and returns right away. Once every task completed, on_completion is called by the worker which completed the last one.
+			/// The graph counts as running until on_completion returns: it can't be modified or executed again from inside on_completion.
+			/// If a task throws, tasks which didn't start yet are skipped, the exception is available from get_exception and rethrown by wait.
+			/// Throws std::logic_error if the graph is already running or contains a cycle.
+			/// </summary>
+			template <typename F>
+				requires std::is_invocable_v<std::decay_t<F>&>
+			void execute(thread_pool& pool, F&& on_completion)
+				{
+				check_not_running();
+				if (topology_changed) { prepare(); }
+
+				assign(completion, std::forward<F>(on_completion));
+
+				executing_pool = &pool;
+				exception      = nullptr;
+				failed.store(false, std::memory_order_relaxed);
+				for (size_t i = 0; i < nodes.size(); i++) { pending_dependencies[i].store(nodes[i].dependencies_count, std::memory_order_relaxed); }
+				// One extra count held while the roots are being submitted: the graph can't complete, and be destroyed by a waiter, before this function stops reading it.
+				tasks_remaining.store(nodes.size() + 1, std::memory_order_relaxed);
+
+				running.store(true, std::memory_order_relaxed);
+				execution_begin = clock_t::now();
+
+				// Pushing to the pool synchronizes with the workers that pick the tasks up, the relaxed stores above are visible to them.
+				for (size_t root : roots) { pool.push_task([this, root]() { run_from(root); }); }
+				if (tasks_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) { complete(); }
+				}
+
+			void execute(thread_pool& pool) { execute(pool, [] {}); }
+
+			/// <summary> Blocks until the current execution, if any, completed. Must not be called from one of the thread pool's workers. </summary>
+			void wait_for_completion()
+				{
+				std::unique_lock lock{completion_mutex};
+				completion_cv.wait(lock, [this] { return !running.load(std::memory_order_acquire); });
+				}
+
+			/// <summary> Blocks until the current execution, if any, completed, then rethrows the exception thrown by a task, if any. Must not be called from one of the thread pool's workers. </summary>
+			void wait()
+				{
+				wait_for_completion();
+				if (exception) { std::rethrow_exception(exception); }
+				}
+
+			/// <summary> Executes the graph and blocks until it completed. Must not be called from one of the thread pool's workers. </summary>
+			void run(thread_pool& pool)
+				{
+				execute(pool);
+				wait();
+				}
+
+			[[nodiscard]] bool is_running() const noexcept { return running.load(std::memory_order_acquire); }
+
+			/// <summary> The first exception thrown by a task during the last completed execution, or nullptr. </summary>
+			[[nodiscard]] std::exception_ptr get_exception() const noexcept { return exception; }
+#pragma endregion execution
+
+#pragma region profiling
+			/// <summary> Longest chain of dependent tasks of the last completed execution, weighted by the tasks' measured durations. </summary>
+			[[nodiscard]] critical_path_report critical_path()
+				{
+				check_not_running();
+				critical_path_report ret;
+				if (nodes.empty() || topology_changed) { return ret; }
+				ret.wall_time = execution_end - execution_begin;
+
+				// Longest path ending at each task, tasks are visited in topological order so every predecessor is final by the time its successors are visited.
+				constexpr size_t none{static_cast<size_t>(-1)};
+				std::vector<duration_t> path_length(nodes.size(), duration_t{0});
+				std::vector<size_t    > predecessor(nodes.size(), none);
+
+				size_t last{none};
+				for (size_t index : topological_order)
+					{
+					const duration_t duration{nodes[index].duration()};
+					ret.work += duration;
+					path_length[index] += duration;
+					if (last == none || path_length[index] > path_length[last]) { last = index; }
+
+					for (size_t successor : nodes[index].successors)
+						{
+						if (predecessor[successor] == none || path_length[index] > path_length[successor])
+							{
+							path_length[successor] = path_length[index];
+							predecessor[successor] = index;
+							}
+						}
+					}
+
+				ret.length = path_length[last];
+				for (size_t index{last}; index != none; index = predecessor[index]) { ret.tasks.push_back(task{this, index}); }
+				std::reverse(ret.tasks.begin(), ret.tasks.end());
+				return ret;
+				}
+#pragma endregion profiling
+
+		private:
+			/// <summary> Move-only, so tasks and on_completion can capture move-only state. </summary>
+			using function_t = utils::inplace_function<void(), 64>;
+
+			/// <summary> Callables too large for the inline storage are boxed on the heap. </summary>
+			template <typename F>
+			static void assign(function_t& function, F&& callable)
+				{
+				if constexpr (function_t::fits<std::decay_t<F>>) { function.emplace(std::forward<F>(callable)); }
+				else { function.emplace([boxed{std::make_unique<std::decay_t<F>>(std::forward<F>(callable))}]() { (*boxed)(); }); }
+				}
+
+			struct node_t
+				{
+				function_t function;
+				std::vector<size_t> successors;
+				size_t dependencies_count{0};
+				std::string name;
+
+				clock_t::time_point begin;
+				clock_t::time_point end;
+
+				duration_t duration() const noexcept { return end - begin; }
+				};
+
+			std::vector<node_t> nodes;
+
+			// Derived from the nodes by prepare, only rebuilt after the graph is modified.
+			bool topology_changed{false};
+			std::vector<size_t> roots;
+			std::vector<size_t> topological_order;
+			std::unique_ptr<std::atomic<size_t>[]> pending_dependencies;
+
+			thread_pool* executing_pool{nullptr};
+			function_t completion;
+			std::exception_ptr exception;
+			clock_t::time_point execution_begin;
+			clock_t::time_point execution_end;
+
+			alignas(64) std::atomic<size_t> tasks_remaining{0};
+			std::atomic<bool> failed {false};
+			std::atomic<bool> running{false};
+
+			std::mutex completion_mutex;
+			std::condition_variable completion_cv;
+
+			void check_not_running() const
+				{
+				if (running.load(std::memory_order_acquire)) { throw std::logic_error{"task_graph can't be modified or executed while it's running."}; }
+				}
+
+			void add_edge(size_t from, size_t to)
+				{
+				check_not_running();
+				nodes[from].successors.push_back(to);
+				nodes[to].dependencies_count++;
+				topology_changed = true;
+				}
+
+			/// <summary> Kahn's algorithm: finds the roots and a topological order, which only exists if the graph has no cycles. </summary>
+			void prepare()
+				{
+				roots.clear();
+				topological_order.clear();
+				topological_order.reserve(nodes.size());
+				pending_dependencies = std::make_unique<std::atomic<size_t>[]>(nodes.size());
+
+				for (size_t i = 0; i < nodes.size(); i++)
+					{
+					pending_dependencies[i].store(nodes[i].dependencies_count, std::memory_order_relaxed);
+					if (nodes[i].dependencies_count == 0) { roots.push_back(i); topological_order.push_back(i); }
+					}
+
+				for (size_t i = 0; i < topological_order.size(); i++)
+					{
+					for (size_t successor : nodes[topological_order[i]].successors)
+						{
+						if (pending_dependencies[successor].fetch_sub(1, std::memory_order_relaxed) == 1) { topological_order.push_back(successor); }
+						}
+					}
+
+				if (topological_order.size() != nodes.size()) { throw std::logic_error{"task_graph contains a cycle."}; }
+				topology_changed = false;
+				}
+
+			void run_from(size_t index)
+				{
+				// Runs the given task, then keeps running one of the successors it released on the same worker, until a task releases none.
+				static constexpr size_t none{static_cast<size_t>(-1)};
+				while (index != none)
+					{
+					node_t& node{nodes[index]};
+					node.begin = clock_t::now();
+					if (!failed.load(std::memory_order_relaxed))
+						{
+						try { node.function(); }
+						catch (...)
+							{
+							if (!failed.exchange(true, std::memory_order_relaxed)) { exception = std::current_exception(); }
+							}
+						}
+					node.end = clock_t::now();
+
+					size_t next{none};
+					for (size_t successor : node.successors)
+						{
+						if (pending_dependencies[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) { continue; }
+						if (next == none) { next = successor; }
+						else { executing_pool->push_task([this, successor]() { run_from(successor); }); }
+						}
+
+					if (tasks_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) { complete(); return; }
+					index = next;
+					}
+				}
+
+			void complete()
+				{
+				execution_end = clock_t::now();
+				if (completion)
+					{
+					completion();
+					completion.reset();
+					}
+
+				// Notified under the lock: once a waiter observes running == false it may destroy the graph, nothing here touches it after the unlock.
+				std::scoped_lock lock{completion_mutex};
+				running.store(false, std::memory_order_release);
+				completion_cv.notify_all();
+				}
+		};
+	}
\ No newline at end of file
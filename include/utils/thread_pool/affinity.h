@@ -0,0 +1,78 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <thread>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <system_error>
+
+// Pinning threads to a set of logical CPUs. pthread_setaffinity_np on Linux, SetThreadAffinityMask on Windows (which only reaches the first 64 CPUs, the calling thread's processor group).
+// On other platforms pinning isn't supported and set throws.
+// Header only: thread_pool.h uses it. Checks _WIN32/__linux__ directly rather than compilation/OS.h, which refuses to compile on other platforms.
+
+#if defined(_WIN32)
+// No sense pulling in Windows.h in a header, same as concurrentqueue.h the two functions used are declared manually, with the exact types Windows.h uses.
+extern "C" __declspec(dllimport) std::conditional_t<sizeof(void*) == 8, unsigned long long, unsigned long> __stdcall SetThreadAffinityMask(void* thread, std::conditional_t<sizeof(void*) == 8, unsigned long long, unsigned long> mask);
+extern "C" __declspec(dllimport) unsigned long __stdcall GetLastError(void);
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+namespace utils::thread_affinity
+	{
+	inline constexpr bool supported
+#if defined(_WIN32) || defined(__linux__)
+		{true};
+#else
+		{false};
+#endif
+
+	/// <summary> Highest CPU index + 1 that set accepts on this platform. </summary>
+	inline constexpr size_t max_cpus() noexcept
+		{
+#if defined(_WIN32)
+		return sizeof(void*) * 8;
+#elif defined(__linux__)
+		return CPU_SETSIZE;
+#else
+		return 64;
+#endif
+		}
+
+	/// <summary>
+	/// Restricts thread to run only on the given logical CPUs. Throws std::invalid_argument if cpus is empty or contains an index not below max_cpus,
+	/// std::system_error if the OS refuses (i.e. none of the CPUs is available to the process) or the platform doesn't support pinning.
+	/// </summary>
+	inline void set(std::thread& thread, std::span<const size_t> cpus)
+		{
+		if (cpus.empty()) { throw std::invalid_argument{"Thread affinity requires at least one CPU."}; }
+		for (size_t cpu : cpus)
+			{
+			if (cpu >= max_cpus()) { throw std::invalid_argument{"CPU index " + std::to_string(cpu) + " is out of the range supported for thread affinity."}; }
+			}
+
+#if defined(_WIN32)
+		using mask_t = std::conditional_t<sizeof(void*) == 8, unsigned long long, unsigned long>;
+		mask_t mask{0};
+		for (size_t cpu : cpus) { mask |= mask_t{1} << cpu; }
+		if (!::SetThreadAffinityMask(static_cast<void*>(thread.native_handle()), mask))
+			{
+			throw std::system_error{static_cast<int>(::GetLastError()), std::system_category(), "SetThreadAffinityMask failed"};
+			}
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t cpu : cpus) { CPU_SET(cpu, &set); }
+		if (const int error{pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set)})
+			{
+			throw std::system_error{error, std::system_category(), "pthread_setaffinity_np failed"};
+			}
+#else
+		(void)thread;
+		throw std::system_error{std::make_error_code(std::errc::function_not_supported), "Thread affinity is not supported on this platform"};
+#endif
+		}
+	}
\ No newline at end of file
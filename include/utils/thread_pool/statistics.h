@@ -0,0 +1,328 @@
+#pragma once
+
+#include <bit>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+// Optional thread_pool instrumentation, enabled by defining utils_thread_pool_statistics before including thread_pool.h.
+// When disabled the pool's hooks are overloads on empty types which do nothing: no timestamps, no counters, no extra bytes in the task nodes.
+// When enabled each worker records, in its own counters:
+// - the time each task waited in queue (enqueue to start) and the time it ran (start to finish), in log-linear histograms;
+// - the amount of queued tasks right after each enqueue, in a log-linear histogram;
+// - its busy time, the tasks it executed, stole from other workers and took from the injection queue.
+// Threads which aren't workers (submitting from outside, run_pending_task) share one more set of counters.
+// thread_pool::get_statistics merges everything into a snapshot; snapshots can be subtracted to get the statistics of an interval.
+
+namespace utils::thread_pool_statistics
+	{
+	inline constexpr bool enabled
+#ifdef utils_thread_pool_statistics
+		{true};
+#else
+		{false};
+#endif
+
+	using clock_t = std::chrono::steady_clock;
+
+	/// <summary>
+	/// Lock-free log-linear histogram of 64 bits values: values below sub_buckets are counted exactly,
+	/// every power of two above is split in sub_buckets linear buckets, so a bucket is at most 1/sub_buckets of its values wide.
+	/// </summary>
+	class histogram
+		{
+		public:
+			inline static constexpr size_t sub_bucket_bits{4};
+			inline static constexpr size_t sub_buckets    {size_t{1} << sub_bucket_bits};
+			inline static constexpr size_t buckets_count  {(64 - sub_bucket_bits + 1) * sub_buckets};
+
+			static constexpr size_t bucket_index(std::uint64_t value) noexcept
+				{
+				if (value < sub_buckets) { return static_cast<size_t>(value); }
+				const size_t shift{static_cast<size_t>(std::bit_width(value)) - 1 - sub_bucket_bits};
+				return (shift + 1) * sub_buckets + static_cast<size_t>((value >> shift) - sub_buckets);
+				}
+			static constexpr std::uint64_t bucket_lower_bound(size_t index) noexcept
+				{
+				if (index < sub_buckets) { return index; }
+				const size_t shift{index / sub_buckets - 1};
+				return (sub_buckets + index % sub_buckets) << shift;
+				}
+			static constexpr std::uint64_t bucket_upper_bound(size_t index) noexcept
+				{
+				if (index < sub_buckets) { return index; }
+				const size_t shift{index / sub_buckets - 1};
+				return bucket_lower_bound(index) + ((std::uint64_t{1} << shift) - 1);
+				}
+
+			void record(std::uint64_t value) noexcept
+				{
+				buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+				sum.fetch_add(value, std::memory_order_relaxed);
+				std::uint64_t previous_max{max.load(std::memory_order_relaxed)};
+				while (value > previous_max && !max.compare_exchange_weak(previous_max, value, std::memory_order_relaxed)) {}
+				}
+
+		private:
+			friend struct histogram_snapshot;
+			std::array<std::atomic<std::uint64_t>, buckets_count> buckets{};
+			std::atomic<std::uint64_t> sum{0};
+			std::atomic<std::uint64_t> max{0};
+		};
+
+	/// <summary> Plain copy of a histogram. Taken while the histogram is being recorded to, it's consistent per bucket but not across buckets. </summary>
+	struct histogram_snapshot
+		{
+		std::array<std::uint64_t, histogram::buckets_count> counts{};
+		std::uint64_t count{0};
+		std::uint64_t sum  {0};
+		std::uint64_t max  {0};
+
+		histogram_snapshot() noexcept = default;
+		histogram_snapshot(const histogram& histogram) noexcept :
+			sum{histogram.sum.load(std::memory_order_relaxed)},
+			max{histogram.max.load(std::memory_order_relaxed)}
+			{
+			for (size_t i = 0; i < counts.size(); i++)
+				{
+				counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+				count += counts[i];
+				}
+			}
+
+		double mean() const noexcept { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+		/// <summary> Upper bound of the bucket containing the value at the given fraction (0 to 1) of the recorded values, never above max. </summary>
+		std::uint64_t percentile(double fraction) const noexcept
+			{
+			if (!count) { return 0; }
+			const std::uint64_t rank{std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(count) + .5))};
+			std::uint64_t seen{0};
+			for (size_t i = 0; i < counts.size(); i++)
+				{
+				seen += counts[i];
+				if (seen >= rank) { return std::min(histogram::bucket_upper_bound(i), max); }
+				}
+			return max;
+			}
+
+		histogram_snapshot& operator+=(const histogram_snapshot& other) noexcept
+			{
+			for (size_t i = 0; i < counts.size(); i++) { counts[i] += other.counts[i]; }
+			count += other.count;
+			sum   += other.sum;
+			max    = std::max(max, other.max);
+			return *this;
+			}
+
+		/// <summary> Values recorded since an older snapshot of the same histogram. max can't be subtracted, it stays the overall max. </summary>
+		histogram_snapshot& operator-=(const histogram_snapshot& older) noexcept
+			{
+			for (size_t i = 0; i < counts.size(); i++) { counts[i] -= older.counts[i]; }
+			count -= older.count;
+			sum   -= older.sum;
+			return *this;
+			}
+		};
+
+	/// <summary> Counters owned by a single worker, or shared by every thread which isn't a worker. </summary>
+	struct counters
+		{
+		histogram wait_time;
+		histogram run_time;
+		histogram queue_depth;
+
+		std::atomic<std::uint64_t> busy_nanoseconds    {0};
+		std::atomic<std::uint64_t> tasks_executed      {0};
+		std::atomic<std::uint64_t> tasks_stolen        {0};
+		std::atomic<std::uint64_t> tasks_from_injection{0};
+
+		clock_t::time_point started{clock_t::now()};
+		};
+
+	struct disabled_counters {};
+	using counters_t = std::conditional_t<enabled, counters, disabled_counters>;
+
+	/// <summary> Base of the pool's task nodes, empty when disabled so the nodes keep their size. </summary>
+	struct task_timestamp
+		{
+		clock_t::time_point enqueued;
+		};
+	struct disabled_task_timestamp {};
+	using task_timestamp_t = std::conditional_t<enabled, task_timestamp, disabled_task_timestamp>;
+
+#pragma region hooks
+	// Called by the pool, the overloads for the disabled types do nothing and compile away.
+
+	inline void on_enqueue(counters& counters, task_timestamp& task, size_t tasks_queued) noexcept
+		{
+		task.enqueued = clock_t::now();
+		counters.queue_depth.record(tasks_queued);
+		}
+	inline void on_enqueue(disabled_counters&, disabled_task_timestamp&, size_t) noexcept {}
+
+	inline void on_steal         (counters& counters) noexcept { counters.tasks_stolen        .fetch_add(1, std::memory_order_relaxed); }
+	inline void on_steal         (disabled_counters&) noexcept {}
+	inline void on_injected_task (counters& counters) noexcept { counters.tasks_from_injection.fetch_add(1, std::memory_order_relaxed); }
+	inline void on_injected_task (disabled_counters&) noexcept {}
+
+	template <typename F>
+	void execute(counters& counters, const task_timestamp& task, F&& function)
+		{
+		const auto begin{clock_t::now()};
+		function();
+		const auto end{clock_t::now()};
+
+		const auto nanoseconds{[](auto duration) { return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()); }};
+		const std::uint64_t run_time{nanoseconds(end - begin)};
+		counters.wait_time.record(nanoseconds(begin - task.enqueued));
+		counters.run_time .record(run_time);
+		counters.busy_nanoseconds.fetch_add(run_time, std::memory_order_relaxed);
+		counters.tasks_executed  .fetch_add(1       , std::memory_order_relaxed);
+		}
+	template <typename F>
+	void execute(disabled_counters&, const disabled_task_timestamp&, F&& function) { function(); }
+#pragma endregion hooks
+
+	struct worker_snapshot
+		{
+		std::chrono::nanoseconds busy{0};
+		std::chrono::nanoseconds idle{0};
+		std::uint64_t tasks_executed      {0};
+		std::uint64_t tasks_stolen        {0};
+		std::uint64_t tasks_from_injection{0};
+		/// <summary> Tasks in the worker's own deque when the snapshot was taken. </summary>
+		size_t local_queue_size{0};
+
+		double utilization() const noexcept
+			{
+			const auto total{busy + idle};
+			return total.count() ? static_cast<double>(busy.count()) / static_cast<double>(total.count()) : 0.0;
+			}
+
+		worker_snapshot& operator-=(const worker_snapshot& older) noexcept
+			{
+			busy                 -= older.busy;
+			idle                 -= older.idle;
+			tasks_executed       -= older.tasks_executed;
+			tasks_stolen         -= older.tasks_stolen;
+			tasks_from_injection -= older.tasks_from_injection;
+			return *this;
+			}
+		};
+
+	struct snapshot
+		{
+		/// <summary> False if the pool was compiled without statistics, every other field is then zero or empty. </summary>
+		bool enabled{false};
+		size_t tasks_queued {0};
+		size_t tasks_running{0};
+
+		/// <summary> Enqueue to start, in nanoseconds. </summary>
+		histogram_snapshot wait_time;
+		/// <summary> Start to finish, in nanoseconds. </summary>
+		histogram_snapshot run_time;
+		/// <summary> Queued tasks right after each enqueue. </summary>
+		histogram_snapshot queue_depth;
+
+		std::vector<worker_snapshot> workers;
+		/// <summary> Tasks executed by threads which aren't workers through run_pending_task. </summary>
+		std::uint64_t tasks_executed_externally{0};
+
+		/// <summary> Statistics of the interval between an older snapshot of the same pool and this one. Current values (queued, running, queue sizes) stay as in this snapshot. </summary>
+		snapshot& operator-=(const snapshot& older) noexcept
+			{
+			wait_time   -= older.wait_time;
+			run_time    -= older.run_time;
+			queue_depth -= older.queue_depth;
+			// Workers are recreated by thread_pool::reset, their counters start over.
+			if (workers.size() == older.workers.size())
+				{
+				for (size_t i = 0; i < workers.size(); i++) { workers[i] -= older.workers[i]; }
+				}
+			tasks_executed_externally -= older.tasks_executed_externally;
+			return *this;
+			}
+		friend snapshot operator-(snapshot newer, const snapshot& older) noexcept { newer -= older; return newer; }
+
+		/// <summary> Multi-line human readable summary. </summary>
+		std::string to_string() const
+			{
+			if (!enabled) { return "thread pool statistics disabled, define utils_thread_pool_statistics to enable them.\n"; }
+
+			std::string ret{"thread pool: " + std::to_string(tasks_queued) + " queued, " + std::to_string(tasks_running) + " running\n"};
+			ret += "    wait time   " + histogram_to_string(wait_time  , true ) + "\n";
+			ret += "    run time    " + histogram_to_string(run_time   , true ) + "\n";
+			ret += "    queue depth " + histogram_to_string(queue_depth, false) + "\n";
+			for (size_t i = 0; i < workers.size(); i++)
+				{
+				const worker_snapshot& worker{workers[i]};
+				ret += "    worker " + std::to_string(i) + ": busy " + std::to_string(static_cast<int>(worker.utilization() * 100.0 + .5)) + "%"
+					", executed "       + std::to_string(worker.tasks_executed      ) +
+					", stolen "         + std::to_string(worker.tasks_stolen        ) +
+					", from injection " + std::to_string(worker.tasks_from_injection) +
+					", in deque "       + std::to_string(worker.local_queue_size    ) + "\n";
+				}
+			if (tasks_executed_externally) { ret += "    executed outside of workers: " + std::to_string(tasks_executed_externally) + "\n"; }
+			return ret;
+			}
+
+		private:
+			static std::string duration_to_string(std::uint64_t nanoseconds)
+				{
+				if (nanoseconds < 10'000    ) { return std::to_string(nanoseconds             ) + "ns"; }
+				if (nanoseconds < 10'000'000) { return std::to_string(nanoseconds / 1'000     ) + "us"; }
+				return                                 std::to_string(nanoseconds / 1'000'000) + "ms";
+				}
+			static std::string histogram_to_string(const histogram_snapshot& histogram, bool is_duration)
+				{
+				const auto value_to_string{[is_duration](std::uint64_t value) { return is_duration ? duration_to_string(value) : std::to_string(value); }};
+				return "count " + std::to_string(histogram.count) +
+					", mean " + value_to_string(static_cast<std::uint64_t>(histogram.mean())) +
+					", p50 "  + value_to_string(histogram.percentile(.50 )) +
+					", p90 "  + value_to_string(histogram.percentile(.90 )) +
+					", p99 "  + value_to_string(histogram.percentile(.99 )) +
+					", max "  + value_to_string(histogram.max);
+				}
+		};
+
+	inline void add_to_snapshot(snapshot& snapshot, const counters& counters) noexcept
+		{
+		snapshot.enabled = true;
+		snapshot.wait_time   += histogram_snapshot{counters.wait_time  };
+		snapshot.run_time    += histogram_snapshot{counters.run_time   };
+		snapshot.queue_depth += histogram_snapshot{counters.queue_depth};
+		}
+	inline void add_to_snapshot(snapshot&, const disabled_counters&) noexcept {}
+
+	inline void add_worker_to_snapshot(snapshot& snapshot, const counters& counters, size_t local_queue_size)
+		{
+		add_to_snapshot(snapshot, counters);
+
+		const std::chrono::nanoseconds busy {counters.busy_nanoseconds.load(std::memory_order_relaxed)};
+		const std::chrono::nanoseconds alive{std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - counters.started)};
+		snapshot.workers.push_back(worker_snapshot
+			{
+			.busy                {busy},
+			.idle                {alive > busy ? alive - busy : std::chrono::nanoseconds{0}},
+			.tasks_executed      {counters.tasks_executed      .load(std::memory_order_relaxed)},
+			.tasks_stolen        {counters.tasks_stolen        .load(std::memory_order_relaxed)},
+			.tasks_from_injection{counters.tasks_from_injection.load(std::memory_order_relaxed)},
+			.local_queue_size    {local_queue_size}
+			});
+		}
+	inline void add_worker_to_snapshot(snapshot&, const disabled_counters&, size_t) noexcept {}
+
+	inline void add_external_to_snapshot(snapshot& snapshot, const counters& counters) noexcept
+		{
+		add_to_snapshot(snapshot, counters);
+		snapshot.tasks_executed_externally = counters.tasks_executed.load(std::memory_order_relaxed);
+		}
+	inline void add_external_to_snapshot(snapshot&, const disabled_counters&) noexcept {}
+	}
\ No newline at end of file
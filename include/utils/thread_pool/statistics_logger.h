@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <stop_token>
+#include <condition_variable>
+
+#include "../thread_pool.h"
+
+// Dumps thread_pool statistics through a utils::logging logger, once or periodically from a background thread.
+// Works with both logger<message<...>> and async_logger.
+
+namespace utils::thread_pool_statistics
+	{
+	template <typename logger_t>
+	void log(logger_t& logger, const snapshot& snapshot)
+		{
+		const std::string string{snapshot.to_string()};
+		if constexpr (requires { logger.inf("{}", string); }) { logger.inf("{}", string); }
+		else { logger.inf(string); }
+		}
+
+	template <typename logger_t>
+	void log(logger_t& logger, const thread_pool& pool) { log(logger, pool.get_statistics()); }
+
+	/// <summary>
+	/// Every interval, logs the statistics of the pool for the interval that just ended. The pool and the logger must outlive this object.
+	/// Does nothing when the pool was compiled without utils_thread_pool_statistics.
+	/// </summary>
+	template <typename logger_t>
+	class periodic_logger
+		{
+		public:
+			periodic_logger(const thread_pool& pool, logger_t& logger, std::chrono::milliseconds interval = std::chrono::seconds{10})
+				{
+				if constexpr (!enabled) { return; }
+				thread = std::jthread{[&pool, &logger, interval, this](std::stop_token stop_token)
+					{
+					snapshot previous{pool.get_statistics()};
+					std::unique_lock lock{mutex};
+					while (!stop_requested_cv.wait_for(lock, stop_token, interval, [] { return false; }) && !stop_token.stop_requested())
+						{
+						snapshot current{pool.get_statistics()};
+						log(logger, current - previous);
+						previous = std::move(current);
+						}
+					}};
+				}
+
+			periodic_logger(const periodic_logger& copy) = delete;
+			periodic_logger& operator=(const periodic_logger& copy) = delete;
+
+		private:
+			std::mutex mutex;
+			std::condition_variable_any stop_requested_cv;
+			// Last: stopped and joined before the members it uses are destroyed.
+			std::jthread thread;
+		};
+	}
\ No newline at end of file
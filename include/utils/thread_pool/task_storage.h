@@ -0,0 +1,188 @@
+#pragma once
+
+#include <new>
+#include <array>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "../inplace_function.h"
+#include "../third_party/concurrentqueue.h"
+#include "statistics.h"
+
+// Recycled storage for thread_pool tasks:
+// task_node_pool hands out fixed size task nodes whose callable lives inline. Nodes come in chunks, are never freed until the pool is destroyed,
+// and are recycled through a per-worker cache that spills into a shared lock-free free list.
+// shared_state_arena backs the allocator passed to std::promise, so the future/promise shared state is recycled as well.
+
+namespace utils::details
+	{
+	/// <summary> With statistics enabled the enqueue timestamp takes its space from the inline storage, nodes stay two cache lines either way. </summary>
+	struct task_node : thread_pool_statistics::task_timestamp_t
+		{
+		// Two cache lines per node including the vtable pointer.
+		inline static constexpr size_t inline_capacity{128 - alignof(std::max_align_t) - (thread_pool_statistics::enabled ? alignof(std::max_align_t) : 0)};
+		using function_t = utils::inplace_function<void(), inline_capacity>;
+
+		function_t function;
+		};
+
+	class task_node_pool
+		{
+		public:
+			class local_cache
+				{
+				friend class task_node_pool;
+				public:
+					local_cache() { nodes.reserve(capacity); }
+
+				private:
+					inline static constexpr size_t capacity{256};
+					std::vector<task_node*> nodes;
+				};
+
+			task_node_pool() = default;
+			task_node_pool(const task_node_pool& copy) = delete;
+			task_node_pool& operator=(const task_node_pool& copy) = delete;
+
+			/// <summary> cache must belong to the calling thread, or be nullptr. </summary>
+			task_node* acquire(local_cache* cache)
+				{
+				if (cache && !cache->nodes.empty())
+					{
+					task_node* ret{cache->nodes.back()};
+					cache->nodes.pop_back();
+					return ret;
+					}
+
+				task_node* ret{nullptr};
+				if (free_nodes.try_dequeue(ret)) { return ret; }
+				return allocate_chunk();
+				}
+
+			/// <summary> cache must belong to the calling thread, or be nullptr. </summary>
+			void release(task_node* node, local_cache* cache) noexcept
+				{
+				node->function.reset();
+
+				if (cache)
+					{
+					if (cache->nodes.size() == local_cache::capacity)
+						{
+						// Spill half the cache at once, keeps the shared free list traffic low for workers that mostly release nodes allocated elsewhere.
+						constexpr size_t spill{local_cache::capacity / 2};
+						if (free_nodes.enqueue_bulk(cache->nodes.end() - spill, spill)) { cache->nodes.resize(cache->nodes.size() - spill); }
+						}
+					if (cache->nodes.size() < local_cache::capacity) { cache->nodes.push_back(node); return; }
+					}
+
+				// A node that can't enter the free list just stays in its chunk until the pool is destroyed.
+				free_nodes.enqueue(node);
+				}
+
+			/// <summary> Moves every node of a cache whose owner is going away to the shared free list. No thread may use the cache concurrently. </summary>
+			void drain(local_cache& cache) noexcept
+				{
+				if (!cache.nodes.empty() && free_nodes.enqueue_bulk(cache.nodes.begin(), cache.nodes.size())) { cache.nodes.clear(); }
+				}
+
+		private:
+			inline static constexpr size_t chunk_size{64};
+
+			std::mutex chunks_mutex;
+			std::vector<std::unique_ptr<task_node[]>> chunks;
+			moodycamel::ConcurrentQueue<task_node*> free_nodes;
+
+			task_node* allocate_chunk()
+				{
+				task_node* chunk{nullptr};
+				if (true)
+					{
+					std::scoped_lock lock{chunks_mutex};
+					chunks.emplace_back(std::make_unique<task_node[]>(chunk_size));
+					chunk = chunks.back().get();
+					}
+
+				std::array<task_node*, chunk_size - 1> spare;
+				for (size_t i = 0; i < spare.size(); i++) { spare[i] = chunk + i + 1; }
+				free_nodes.enqueue_bulk(spare.begin(), spare.size());
+				return chunk;
+				}
+		};
+
+	class shared_state_arena
+		{
+		public:
+			shared_state_arena() = default;
+			shared_state_arena(const shared_state_arena& copy) = delete;
+			shared_state_arena& operator=(const shared_state_arena& copy) = delete;
+
+			~shared_state_arena()
+				{
+				for (auto& size_class : free_blocks)
+					{
+					void* block{nullptr};
+					while (size_class.try_dequeue(block)) { ::operator delete(block); }
+					}
+				}
+
+			void* allocate(size_t bytes)
+				{
+				if (bytes > max_recycled_size) { return ::operator new(bytes); }
+
+				void* ret{nullptr};
+				if (free_blocks[class_index(bytes)].try_dequeue(ret)) { return ret; }
+				return ::operator new(class_size(bytes));
+				}
+
+			void deallocate(void* block, size_t bytes) noexcept
+				{
+				if (bytes > max_recycled_size || !free_blocks[class_index(bytes)].enqueue(block)) { ::operator delete(block); }
+				}
+
+		private:
+			inline static constexpr size_t granularity      {64};
+			inline static constexpr size_t classes_count    {4};
+			inline static constexpr size_t max_recycled_size{granularity * classes_count};
+
+			static constexpr size_t class_index(size_t bytes) noexcept { return (bytes - 1) / granularity; }
+			static constexpr size_t class_size (size_t bytes) noexcept { return (class_index(bytes) + 1) * granularity; }
+
+			std::array<moodycamel::ConcurrentQueue<void*>, classes_count> free_blocks;
+		};
+
+	/// <summary> Keeps the arena alive, the shared state of a future may outlive the thread_pool that created it. </summary>
+	template <typename T>
+	class shared_state_allocator
+		{
+		template <typename U>
+		friend class shared_state_allocator;
+
+		public:
+			using value_type = T;
+
+			shared_state_allocator(std::shared_ptr<shared_state_arena> arena) noexcept : arena{std::move(arena)} {}
+
+			template <typename U>
+			shared_state_allocator(const shared_state_allocator<U>& other) noexcept : arena{other.arena} {}
+
+			T* allocate(size_t count)
+				{
+				if constexpr (alignof(T) > alignof(std::max_align_t)) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{alignof(T)})); }
+				else { return static_cast<T*>(arena->allocate(count * sizeof(T))); }
+				}
+
+			void deallocate(T* pointer, size_t count) noexcept
+				{
+				if constexpr (alignof(T) > alignof(std::max_align_t)) { ::operator delete(pointer, std::align_val_t{alignof(T)}); }
+				else { arena->deallocate(pointer, count * sizeof(T)); }
+				}
+
+			template <typename U>
+			bool operator==(const shared_state_allocator<U>& other) const noexcept { return arena == other.arena; }
+
+		private:
+			std::shared_ptr<shared_state_arena> arena;
+		};
+	}
\ No newline at end of file